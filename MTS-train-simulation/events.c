@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "events.h"
+
+static SimEvent*     g_events;
+static int           g_eventCount = 0;
+static unsigned long g_pushed = 0;
+
+static int eventBefore(const SimEvent* a, const SimEvent* b)
+{
+    if (a->time != b->time) return a->time < b->time;
+    if (a->type != b->type) return a->type < b->type;
+    return a->seq < b->seq;
+}
+
+void eventsInit(int capacity)
+{
+    g_events = malloc((capacity + 1) * sizeof(SimEvent));
+    if (!g_events) {
+        fprintf(stderr, "Out of memory for the event queue.\n");
+        exit(1);
+    }
+    g_eventCount = 0;
+    g_pushed = 0;
+}
+
+void eventsFree()
+{
+    free(g_events);
+    g_events = NULL;
+}
+
+void pushEvent(int time, SimEventType type, int train)
+{
+    SimEvent ev = { time, type, train, g_pushed++ };
+    int i = g_eventCount++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!eventBefore(&ev, &g_events[parent])) {
+            break;
+        }
+        g_events[i] = g_events[parent];
+        i = parent;
+    }
+    g_events[i] = ev;
+}
+
+SimEvent popEvent()
+{
+    SimEvent top = g_events[0];
+    SimEvent last = g_events[--g_eventCount];
+    int i = 0;
+    while (2 * i + 1 < g_eventCount) {
+        int child = 2 * i + 1;
+        if (child + 1 < g_eventCount && eventBefore(&g_events[child + 1], &g_events[child])) {
+            child++;
+        }
+        if (!eventBefore(&g_events[child], &last)) {
+            break;
+        }
+        g_events[i] = g_events[child];
+        i = child;
+    }
+    g_events[i] = last;
+    return top;
+}
+
+int eventCount()
+{
+    return g_eventCount;
+}
+
+//time of the earliest pending event; there must be one
+int nextEventTime()
+{
+    return g_events[0].time;
+}
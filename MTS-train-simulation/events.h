@@ -0,0 +1,31 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+/*
+ * The pending events of a virtual-time run, in a min-heap: earliest
+ * time first, then trains finishing loading before trains coming OFF
+ * a track, then in the order they were pushed. A train has at most one
+ * event pending, and a run at most one SIM_HEADWAY, so a heap sized
+ * for the trains never fills.
+ */
+typedef enum {
+    SIM_LOADED,
+    SIM_CROSSED,
+    SIM_HEADWAY                    // the track may take a following train
+} SimEventType;
+
+typedef struct {
+    int             time;          // in tenths of a second
+    SimEventType    type;
+    int             train;         // -1 for SIM_HEADWAY
+    unsigned long   seq;
+} SimEvent;
+
+void     eventsInit(int capacity);
+void     eventsFree();
+void     pushEvent(int time, SimEventType type, int train);
+SimEvent popEvent();
+int      eventCount();
+int      nextEventTime();
+
+#endif
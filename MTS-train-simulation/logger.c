@@ -0,0 +1,204 @@
+#define _GNU_SOURCE   // sem_clockwait
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <time.h>
+#include "logger.h"
+
+#define LOG_CAPACITY   (1 << 16)   // records, a power of two
+#define LOG_FLUSH_MS   100         // the log's own resolution
+#define LOG_BUFFER     (64 * 1024)
+
+//A slot is free for ticket t when seq == t, and holds its record once
+//seq == t + 1; writing it out frees it for ticket t + LOG_CAPACITY.
+typedef struct {
+    atomic_ulong    seq;
+    double          time;
+    int             train;
+    int             segment;       // of a network, -1 => the main track
+    unsigned char   event;
+    unsigned char   direction;
+} LogRecord;
+
+static LogRecord*    g_ring;
+static atomic_ulong  g_tail;       // next ticket
+static atomic_ulong  g_head;       // next record to write out
+static atomic_int    g_writerParked;
+static atomic_int    g_stopping;
+static sem_t         g_writerWake;
+static pthread_t     g_writer;
+
+
+static void formatSimTime(char* buffer, size_t bufSize, double simTime)
+{
+    int hours   = (int)(simTime / 3600);
+    int minutes = (int)((int)simTime % 3600 / 60);
+    double secs = simTime - (hours * 3600) - (minutes * 60);
+
+    snprintf(buffer, bufSize, "%02d:%02d:%04.1f", hours, minutes, secs);
+}
+
+// formats one line of the simulation log, prefixed by the simulation time
+static int formatRecord(char* out, size_t size, const LogRecord* r)
+{
+    char buf[16];
+    const char* dir = (r->direction == EAST) ? "East" : "West";
+
+    formatSimTime(buf, sizeof(buf), r->time);
+    if (r->segment >= 0) {
+        switch (r->event) {
+            case LOG_READY:
+                return snprintf(out, size, "%s Train %2d is ready to go %4s on segment %d\n", buf, r->train, dir, r->segment);
+            case LOG_ON:
+                return snprintf(out, size, "%s Train %2d is ON segment %d going %4s\n", buf, r->train, r->segment, dir);
+            default:
+                return snprintf(out, size, "%s Train %2d is OFF segment %d after going %4s\n", buf, r->train, r->segment, dir);
+        }
+    }
+    switch (r->event) {
+        case LOG_READY:
+            return snprintf(out, size, "%s Train %2d is ready to go %4s\n", buf, r->train, dir);
+        case LOG_ON:
+            return snprintf(out, size, "%s Train %2d is ON the main track going %4s\n", buf, r->train, dir);
+        default:
+            return snprintf(out, size, "%s Train %2d is OFF the main track after going %4s\n", buf, r->train, dir);
+    }
+}
+
+static void wakeWriter()
+{
+    int expected = 1;
+    if (atomic_compare_exchange_strong(&g_writerParked, &expected, 0)) {
+        sem_post(&g_writerWake);
+    }
+}
+
+//Writer Thread --------------------
+
+//writes out the records ready so far
+static void writeRecords(char* buffer)
+{
+    unsigned long head = atomic_load(&g_head);
+    unsigned long written = 0;
+    size_t used = 0;
+
+    for (;;) {
+        LogRecord* r = &g_ring[head & (LOG_CAPACITY - 1)];
+        if (atomic_load_explicit(&r->seq, memory_order_acquire) != head + 1) {
+            break;
+        }
+        if (used + 128 > LOG_BUFFER) {
+            fwrite(buffer, 1, used, stdout);
+            used = 0;
+        }
+        used += formatRecord(buffer + used, LOG_BUFFER - used, r);
+        atomic_store_explicit(&r->seq, head + LOG_CAPACITY, memory_order_release);
+        head++;
+        written++;
+        atomic_store(&g_head, head);
+    }
+    if (used > 0) {
+        fwrite(buffer, 1, used, stdout);
+    }
+    if (written > 0) {
+        fflush(stdout);
+    }
+}
+
+static void* writerThread(void* arg)
+{
+    char* buffer = malloc(LOG_BUFFER);
+    if (!buffer) {
+        fprintf(stderr, "Out of memory for the log buffer.\n");
+        exit(1);
+    }
+
+    for (;;) {
+        writeRecords(buffer);
+        if (atomic_load(&g_stopping) && atomic_load(&g_head) == atomic_load(&g_tail)) {
+            break;
+        }
+
+        // park until the next batch is due, or a producer needs room
+        struct timespec until;
+        clock_gettime(CLOCK_MONOTONIC, &until);
+        until.tv_nsec += LOG_FLUSH_MS * 1000000L;
+        if (until.tv_nsec >= 1000000000L) {
+            until.tv_sec++;
+            until.tv_nsec -= 1000000000L;
+        }
+        atomic_store(&g_writerParked, 1);
+        while (sem_clockwait(&g_writerWake, CLOCK_MONOTONIC, &until) != 0 && errno == EINTR) {
+            // retry
+        }
+        atomic_store(&g_writerParked, 0);
+    }
+
+    free(buffer);
+    return NULL;
+}
+
+void logStart()
+{
+    g_ring = malloc(LOG_CAPACITY * sizeof(LogRecord));
+    if (!g_ring) {
+        fprintf(stderr, "Out of memory for the log.\n");
+        exit(1);
+    }
+    for (unsigned long i = 0; i < LOG_CAPACITY; i++) {
+        atomic_init(&g_ring[i].seq, i);
+    }
+    atomic_init(&g_tail, 0);
+    atomic_init(&g_head, 0);
+    atomic_init(&g_writerParked, 0);
+    atomic_init(&g_stopping, 0);
+    sem_init(&g_writerWake, 0, 0);
+
+    if (pthread_create(&g_writer, NULL, writerThread, NULL) != 0) {
+        fprintf(stderr, "Failed to create log writer thread.\n");
+        exit(1);
+    }
+}
+
+//any thread; waits only if the ring is full
+void logTrainEvent(double simTime, const TrainInfo* train, LogEvent event)
+{
+    logSegmentEvent(simTime, train, event, -1);
+}
+
+//an event on segment `segment` of a network
+void logSegmentEvent(double simTime, const TrainInfo* train, LogEvent event, int segment)
+{
+    unsigned long ticket = atomic_fetch_add(&g_tail, 1);
+    LogRecord* r = &g_ring[ticket & (LOG_CAPACITY - 1)];
+
+    while (atomic_load_explicit(&r->seq, memory_order_acquire) != ticket) {
+        wakeWriter();
+        sched_yield();
+    }
+    r->time      = simTime;
+    r->train     = train->id;
+    r->segment   = segment;
+    r->event     = (unsigned char) event;
+    r->direction = (unsigned char) train->direction;
+    atomic_store_explicit(&r->seq, ticket + 1, memory_order_release);
+
+    if (ticket - atomic_load(&g_head) >= LOG_CAPACITY / 2) {
+        wakeWriter();
+    }
+}
+
+//writes out everything logged, then stops the writer
+void logStop()
+{
+    atomic_store(&g_stopping, 1);
+    sem_post(&g_writerWake);
+    pthread_join(g_writer, NULL);
+    sem_destroy(&g_writerWake);
+    free(g_ring);
+}
@@ -0,0 +1,26 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include "train.h"
+
+/*
+ * The simulation log, written by its own thread. logTrainEvent() only
+ * records (time, train, event) in a ring buffer: each call takes a
+ * ticket with one atomic add, so lines come out in the order of the
+ * calls, as printf would have written them. The writer thread formats
+ * the records and writes them in batches, every LOG_FLUSH_MS or when
+ * the ring is half full; loggers never wake it otherwise, so logging
+ * costs them no system call.
+ */
+typedef enum {
+    LOG_READY,
+    LOG_ON,
+    LOG_OFF
+} LogEvent;
+
+void logStart();
+void logTrainEvent(double simTime, const TrainInfo* train, LogEvent event);
+void logSegmentEvent(double simTime, const TrainInfo* train, LogEvent event, int segment);
+void logStop();
+
+#endif
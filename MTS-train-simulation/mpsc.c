@@ -0,0 +1,56 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "mpsc.h"
+
+void mpscInit(MpscQueue* q, int capacity)
+{
+    atomic_init(&q->head, -1);
+    q->next = malloc((capacity > 0 ? capacity : 1) * sizeof(int));
+    if (!q->next) {
+        fprintf(stderr, "Out of memory for the ready queue.\n");
+        exit(1);
+    }
+}
+
+void mpscFree(MpscQueue* q)
+{
+    free(q->next);
+}
+
+//any thread; the release makes what the producer wrote before visible
+//to the consumer that takes the id
+void mpscPush(MpscQueue* q, int id)
+{
+    int head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    do {
+        q->next[id] = head;
+    } while (!atomic_compare_exchange_weak_explicit(&q->head, &head, id,
+                                                    memory_order_seq_cst,
+                                                    memory_order_relaxed));
+}
+
+int mpscEmpty(MpscQueue* q)
+{
+    return atomic_load(&q->head) < 0;
+}
+
+//consumer only: takes every id pushed so far and returns the first in
+//push order (-1 if none); mpscNext() walks the rest
+int mpscTakeAll(MpscQueue* q)
+{
+    int id = atomic_exchange(&q->head, -1);
+    int first = -1;
+
+    while (id >= 0) {
+        int older = q->next[id];
+        q->next[id] = first;
+        first = id;
+        id = older;
+    }
+    return first;
+}
+
+int mpscNext(const MpscQueue* q, int id)
+{
+    return q->next[id];
+}
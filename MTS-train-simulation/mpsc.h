@@ -0,0 +1,25 @@
+#ifndef MPSC_H
+#define MPSC_H
+
+#include <stdatomic.h>
+
+/*
+ * A lock-free multi-producer, single-consumer queue of ids. Producers
+ * push with a compare-and-swap on the head of an intrusive list (one
+ * link per id, so an id may only be queued once at a time); the
+ * consumer takes the whole list with one exchange and reverses it into
+ * push order. No producer ever waits for another or for the consumer.
+ */
+typedef struct {
+    atomic_int      head;          // last id pushed, -1 => empty
+    int*            next;          // per id: the id pushed before it
+} MpscQueue;
+
+void mpscInit(MpscQueue* q, int capacity);
+void mpscFree(MpscQueue* q);
+void mpscPush(MpscQueue* q, int id);
+int  mpscEmpty(MpscQueue* q);
+int  mpscTakeAll(MpscQueue* q);
+int  mpscNext(const MpscQueue* q, int id);
+
+#endif
@@ -0,0 +1,248 @@
+/*
+ * mpscbench: ready-to-dispatch latency when hundreds of trains become
+ * ready at the same instant, publishing through the lock-free MPSC
+ * queue against a mutex-protected ready list.
+ *
+ *   mpscbench [--trains=<n>] [--rounds=<n>]
+ *
+ * Each train is a thread; a barrier releases them all at once every
+ * round. A train stamps the time and publishes its id; the consumer,
+ * parked like the scheduler when there is nothing to take, stamps the
+ * time it takes the id. Latency is the difference; publish is the time
+ * a train spends publishing.
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <time.h>
+#include "mpsc.h"
+
+typedef enum {
+    MODE_MUTEX,
+    MODE_MPSC
+} Mode;
+
+static Mode      g_mode;
+static int       g_trainCount = 400;
+static int       g_rounds = 20;
+
+static pthread_barrier_t g_start;
+static double*   g_stamp;          // per train: when it published
+static double*   g_publish;        // per train and round: time spent publishing
+static double*   g_latency;        // per train and round
+static int       g_round;
+
+//mutex mode: the ready list before the queue
+static pthread_mutex_t g_listMutex = PTHREAD_MUTEX_INITIALIZER;
+static int*      g_list;
+static int       g_listCount = 0;
+static int       g_listWaiting = 0;
+
+//mpsc mode
+static MpscQueue g_queue;
+static atomic_int g_queueWaiting = 0;
+
+static sem_t     g_consumerWake;
+
+static double nowSec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void semWait(sem_t* sem)
+{
+    while (sem_wait(sem) != 0 && errno == EINTR) {
+        // retry
+    }
+}
+
+static void publish(int id)
+{
+    if (g_mode == MODE_MUTEX) {
+        pthread_mutex_lock(&g_listMutex);
+        g_list[g_listCount++] = id;
+        int wake = g_listWaiting;
+        g_listWaiting = 0;
+        pthread_mutex_unlock(&g_listMutex);
+        if (wake) {
+            sem_post(&g_consumerWake);
+        }
+    } else {
+        mpscPush(&g_queue, id);
+        int expected = 1;
+        if (atomic_compare_exchange_strong(&g_queueWaiting, &expected, 0)) {
+            sem_post(&g_consumerWake);
+        }
+    }
+}
+
+//takes what was published into `out`, parking while there is nothing
+static int take(int* out)
+{
+    int n = 0;
+
+    if (g_mode == MODE_MUTEX) {
+        pthread_mutex_lock(&g_listMutex);
+        while (g_listCount == 0) {
+            g_listWaiting = 1;
+            pthread_mutex_unlock(&g_listMutex);
+            semWait(&g_consumerWake);
+            pthread_mutex_lock(&g_listMutex);
+        }
+        for (n = 0; n < g_listCount; n++) {
+            out[n] = g_list[n];
+        }
+        g_listCount = 0;
+        pthread_mutex_unlock(&g_listMutex);
+        return n;
+    }
+
+    for (;;) {
+        for (int id = mpscTakeAll(&g_queue); id >= 0; id = mpscNext(&g_queue, id)) {
+            out[n++] = id;
+        }
+        if (n > 0) {
+            return n;
+        }
+        atomic_store(&g_queueWaiting, 1);
+        if (!mpscEmpty(&g_queue)) {
+            int expected = 1;
+            if (atomic_compare_exchange_strong(&g_queueWaiting, &expected, 0)) {
+                continue;
+            }
+        }
+        semWait(&g_consumerWake);
+    }
+}
+
+static void* trainThread(void* arg)
+{
+    int id = (int)(long)arg;
+
+    for (int r = 0; r < g_rounds; r++) {
+        pthread_barrier_wait(&g_start);
+        double start = nowSec();
+        g_stamp[id] = start;
+        publish(id);
+        g_publish[r * g_trainCount + id] = nowSec() - start;
+        pthread_barrier_wait(&g_start);    // round over
+    }
+    return NULL;
+}
+
+static int compareDouble(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double* sorted, int n, double p)
+{
+    int i = (int)(p * (n - 1) + 0.5);
+    return sorted[i];
+}
+
+static void runMode(Mode mode, const char* name)
+{
+    int total = g_trainCount * g_rounds;
+    int* taken = malloc(g_trainCount * sizeof(int));
+    pthread_t* threads = malloc(g_trainCount * sizeof(pthread_t));
+
+    g_mode = mode;
+    for (int i = 0; i < g_trainCount; i++) {
+        if (pthread_create(&threads[i], NULL, trainThread, (void*)(long)i) != 0) {
+            fprintf(stderr, "Failed to create train thread %d.\n", i);
+            exit(1);
+        }
+    }
+
+    for (g_round = 0; g_round < g_rounds; g_round++) {
+        pthread_barrier_wait(&g_start);
+        for (int got = 0; got < g_trainCount; ) {
+            int n = take(taken);
+            double now = nowSec();
+            for (int i = 0; i < n; i++) {
+                g_latency[g_round * g_trainCount + taken[i]] = now - g_stamp[taken[i]];
+            }
+            got += n;
+        }
+        pthread_barrier_wait(&g_start);
+    }
+    for (int i = 0; i < g_trainCount; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    double sum = 0.0, publishSum = 0.0;
+    for (int i = 0; i < total; i++) {
+        sum += g_latency[i];
+        publishSum += g_publish[i];
+    }
+    qsort(g_latency, total, sizeof(double), compareDouble);
+    qsort(g_publish, total, sizeof(double), compareDouble);
+    printf("%-6s latency: mean %8.1f  p50 %8.1f  p99 %8.1f  max %8.1f us; "
+           "publish: mean %6.2f  p99 %7.2f us\n",
+           name, sum / total * 1e6,
+           percentile(g_latency, total, 0.5) * 1e6,
+           percentile(g_latency, total, 0.99) * 1e6,
+           g_latency[total - 1] * 1e6,
+           publishSum / total * 1e6,
+           percentile(g_publish, total, 0.99) * 1e6);
+
+    free(threads);
+    free(taken);
+}
+
+int main(int argc, char* argv[])
+{
+    static struct option longOptions[] = {
+        { "trains", required_argument, NULL, 'n' },
+        { "rounds", required_argument, NULL, 'r' },
+        { NULL,     0,                 NULL, 0   }
+    };
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "n:r:", longOptions, NULL)) != -1) {
+        switch (opt) {
+            case 'n': g_trainCount = atoi(optarg); break;
+            case 'r': g_rounds = atoi(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [--trains=<n>] [--rounds=<n>]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (g_trainCount < 1 || g_rounds < 1) {
+        fprintf(stderr, "--trains and --rounds must be positive.\n");
+        return 1;
+    }
+
+    g_stamp   = malloc(g_trainCount * sizeof(double));
+    g_publish = malloc(g_trainCount * g_rounds * sizeof(double));
+    g_latency = malloc(g_trainCount * g_rounds * sizeof(double));
+    g_list    = malloc(g_trainCount * sizeof(int));
+    if (!g_stamp || !g_publish || !g_latency || !g_list) {
+        fprintf(stderr, "Out of memory.\n");
+        return 1;
+    }
+    pthread_barrier_init(&g_start, NULL, g_trainCount + 1);
+    sem_init(&g_consumerWake, 0, 0);
+    mpscInit(&g_queue, g_trainCount);
+
+    printf("trains=%d rounds=%d\n", g_trainCount, g_rounds);
+    runMode(MODE_MUTEX, "mutex");
+    runMode(MODE_MPSC, "mpsc");
+
+    mpscFree(&g_queue);
+    sem_destroy(&g_consumerWake);
+    pthread_barrier_destroy(&g_start);
+    free(g_list);
+    free(g_latency);
+    free(g_publish);
+    free(g_stamp);
+    return 0;
+}
@@ -1,358 +1,792 @@
+#define _GNU_SOURCE   // sem_clockwait
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <limits.h>
 #include <pthread.h>
-#include <sys/time.h>
+#include <semaphore.h>
+#include <sys/resource.h>
+#include <time.h>
 #include <unistd.h>
+#include "events.h"
+#include "logger.h"
+#include "mpsc.h"
+#include "network.h"
+#include "pool.h"
+#include "ready.h"
+#include "stats.h"
+#include "train.h"
+#include "wheel.h"
+
+#define DEFAULT_WORKERS 4
+#define WHEEL_SLOTS     128        // tenths of a second per turn of the wheel
+#define NANOS_PER_TENTH 100000000LL
+
+
+//All trains input, grown as the file is read
+static TrainInfo* g_trains = NULL;
+static int       g_trainCount = 0;
+static int       g_trainCapacity = 0;
 
-#define MAX_TRAINS 75
+//trains that have finished loading but not yet crossed; the scheduler
+//owns it and takes in the trains published on g_published
+static ReadySet  g_ready;
+static MpscQueue g_published;
 
+//finished crossing. Once it equals g_trainCount
+static int       g_trainsDone = 0;
 
-typedef enum {
-    LOW_PRIORITY,
-    HIGH_PRIORITY
-} Priority;
 
-typedef enum {
-    EAST,
-    WEST
-} Direction;
-
-/*
- *   - id:        train number (0-based)
- *   - direction: E, e or W, w
- *   - priority:  low priority or high priority
- *   - loadingTime, crossingTime in tenths of second
- *   - readyTime: when the train finished loading
- *   - canCrossCond: condition var for scheduler
- *   - isCrossing: set to 1 by the scheduler when its train's turn
- *   - doneCrossing: set to 1 by the train when it has finished crossing
- */
-typedef struct {
-    int             id;
-    Direction       direction;
-    Priority        priority;
-    int             loadingTime;   // in tenths of a second
-    int             crossingTime;  // in tenths of a second
-    double          readyTime;     // when loading finished
-    pthread_cond_t  canCrossCond;
-    int             isCrossing;    // set by scheduler
-    int             doneCrossing;  // set by the train once off track
-} TrainInfo;
-
-
-//All trains input
-static TrainInfo g_trains[MAX_TRAINS];
-static int       g_trainCount = 0;
+static TrackState g_track;
 
-//ready list of indices into g_trains[] for trains that have finished loading but not yet crossed
-static int       g_readyTrains[MAX_TRAINS];
-static int       g_readyCount = 0;
+//headway mode: a train may follow one going its way onto the track once
+//that one has been ON for g_headway tenths; 0 => one train at a time
+static int       g_headway = 0;
 
-//finished crossing. Once it equals g_trainCount
-static int       g_trainsDone = 0;
+//real time: the trains on the track, in the order they went ON; each
+//goes ON once, so the array never wraps
+static int*      g_onTrack;
+static int       g_onTrackHead = 0;
+static int       g_onTrackTail = 0;
 
+//real time, headway mode: per train, posted once it is OFF the track,
+//for the train behind it
+static sem_t*    g_offTrack = NULL;
 
-static int       g_anyTrainCrossed = 0;
-static Direction g_lastDirectionUsed;
-static int       g_consecutiveDirectionCount = 0;
+//real time: the loading times, sorted, and how many trains the
+//scheduler has taken in, so it can tell when all loads due are in
+static int*      g_loadTimes;
+static int       g_trainsTaken = 0;
 
 
-//start time so we can for computing elapsed time
-static struct timeval simulationStartTime;
+//--stats: how promptly trains get the track. A train could go once it
+//was ready and the track was free; its dispatch latency runs from then
+//until it is ON the track.
+typedef struct {
+    long            crossings;
+    double          latencySum;    // in seconds
+    double          latencyMax;
+    double          trackFreeTime; // when the last train came OFF the track
+    double          lastOnTime;    // when it went ON
+    double          busyTime;      // with a train ON the track
+    long            switches;      // context switches during the run
+} RunStats;
+
+static RunStats  g_stats;
 
-//how many real seconds have elapsed
-double getSimulationTime()
-{
-    struct timeval current;
-    gettimeofday(&current, NULL);
 
-    double startSec = (double)simulationStartTime.tv_sec +
-                      (double)simulationStartTime.tv_usec / 1000000.0;
-    double nowSec   = (double)current.tv_sec +
-                      (double)current.tv_usec / 1000000.0;
+//start time so we can for computing elapsed time, on the monotonic
+//clock: the wall clock can step
+static struct timespec simulationStartTime;
 
-    return nowSec - startSec;
+//how many nanoseconds have elapsed
+long long getSimulationNanos()
+{
+    struct timespec current;
+    clock_gettime(CLOCK_MONOTONIC, &current);
+
+    return (current.tv_sec - simulationStartTime.tv_sec) * 1000000000LL
+         + (current.tv_nsec - simulationStartTime.tv_nsec);
 }
 
+//how many real seconds have elapsed
+double getSimulationTime()
+{
+    return getSimulationNanos() / 1e9;
+}
 
-void formatSimTime(char* buffer, size_t bufSize, double simTime)
+//the monotonic clock reading `nanos` into the simulation
+static struct timespec simulationClock(long long nanos)
 {
-    int hours   = (int)(simTime / 3600);
-    int minutes = (int)((int)simTime % 3600 / 60);
-    double secs = simTime - (hours * 3600) - (minutes * 60);
+    struct timespec at = simulationStartTime;
+    at.tv_sec  += nanos / 1000000000LL;
+    at.tv_nsec += nanos % 1000000000LL;
+    if (at.tv_nsec >= 1000000000L) {
+        at.tv_sec++;
+        at.tv_nsec -= 1000000000L;
+    }
+    return at;
+}
 
-    snprintf(buffer, bufSize, "%02d:%02d:%04.1f", hours, minutes, secs);
+//sleeps until `nanos` into the simulation: deadlines, unlike relative
+//sleeps, do not add up the lateness of each wakeup
+void sleepUntil(long long nanos)
+{
+    struct timespec until = simulationClock(nanos);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) == EINTR) {
+        // retry
+    }
 }
 
 
 // Synchornization
+//
+//No lock: trains publish readiness on g_published and crossings on
+//their doneCrossing flag. The scheduler parks on its own semaphore,
+//saying what it waits for; a train wakes it only for that, and nobody
+//else ever does. Parking announces the wait and then checks again, and
+//trains publish before they look for a wait to end, so one of the two
+//always sees the other. In headway mode the scheduler may wait for
+//either, and until the headway is up.
 
-static pthread_mutex_t g_schedulerMutex = PTHREAD_MUTEX_INITIALIZER;
-
+typedef enum {
+    RUNNING           = 0,
+    WAITING_FOR_READY = 1,         // flags: it may wait for both
+    WAITING_FOR_DONE  = 2
+} SchedulerWait;
 
-static pthread_cond_t  g_trainReadyCond = PTHREAD_COND_INITIALIZER;
+static sem_t      g_schedulerWake;
+static atomic_int g_schedulerWait = RUNNING;
 
-// -------------------- pickNextTrain() --------------------
+static int waitOver(int reasons, TrainInfo* crossing)
+{
+    if ((reasons & WAITING_FOR_READY) && !mpscEmpty(&g_published)) {
+        return 1;
+    }
+    return (reasons & WAITING_FOR_DONE) && atomic_load(&crossing->doneCrossing);
+}
 
-int pickNextTrain()
+//parks until a train ends one of the waits in `reasons`, or, if
+//`deadline` is not 0, until `deadline` nanoseconds into the simulation
+static void parkScheduler(int reasons, TrainInfo* crossing, long long deadline)
 {
-    //Check if there's at least one high-priority train
-    int haveHigh = 0;
-    for (int i = 0; i < g_readyCount; i++) {
-        TrainInfo* t = &g_trains[g_readyTrains[i]];
-        if (t->priority == HIGH_PRIORITY) {
-            haveHigh = 1;
-            break;
+    atomic_store(&g_schedulerWait, reasons);
+    if (waitOver(reasons, crossing) || (deadline > 0 && getSimulationNanos() >= deadline)) {
+        int expected = reasons;
+        if (atomic_compare_exchange_strong(&g_schedulerWait, &expected, RUNNING)) {
+            return;
         }
+        // a train has ended the wait already: take its post
+        deadline = 0;
     }
-    Priority pickPriority = haveHigh ? HIGH_PRIORITY : LOW_PRIORITY;
-
-    //candidate list of trains with priority = pickPriority
-    int candidate[MAX_TRAINS];
-    int ccount = 0;
-    for (int i = 0; i < g_readyCount; i++) {
-        TrainInfo* t = &g_trains[g_readyTrains[i]];
-        if (t->priority == pickPriority) {
-            candidate[ccount++] = g_readyTrains[i];
+    if (deadline > 0) {
+        struct timespec until = simulationClock(deadline);
+        int woken;
+        while ((woken = sem_clockwait(&g_schedulerWake, CLOCK_MONOTONIC, &until)) != 0 && errno == EINTR) {
+            // retry
         }
+        if (woken == 0) {
+            return;
+        }
+        int expected = reasons;
+        if (atomic_compare_exchange_strong(&g_schedulerWait, &expected, RUNNING)) {
+            return;
+        }
+        // a train ended the wait as it timed out: take its post
     }
-    if (ccount == 0) {
-        return -1;
+    while (sem_wait(&g_schedulerWake) != 0 && errno == EINTR) {
+        // retry
     }
+}
 
-    //Starvation if 2 consecutive trains in the same direction,
-    //see if there's a candidate in the opposite direction.
- 
-    if (g_consecutiveDirectionCount >= 2) {
-        Direction opp = (g_lastDirectionUsed == EAST) ? WEST : EAST;
-        int foundOpposite = 0;
-        for (int i = 0; i < ccount; i++) {
-            TrainInfo* t = &g_trains[candidate[i]];
-            if (t->direction == opp) {
-                foundOpposite = 1;
-                break;
-            }
-        }
-        if (foundOpposite) {
-            //NOT in the opposite direction
-            int tmpList[MAX_TRAINS];
-            int tmpCount = 0;
-            for (int i = 0; i < ccount; i++) {
-                TrainInfo* t = &g_trains[candidate[i]];
-                if (t->direction == opp) {
-                    tmpList[tmpCount++] = candidate[i];
-                }
-            }
-            memcpy(candidate, tmpList, tmpCount * sizeof(int));
-            ccount = tmpCount;
+//ends the scheduler's wait if it waits for `reason`
+static void wakeScheduler(SchedulerWait reason)
+{
+    int waiting = atomic_load(&g_schedulerWait);
+    while (waiting & reason) {
+        if (atomic_compare_exchange_weak(&g_schedulerWait, &waiting, RUNNING)) {
+            sem_post(&g_schedulerWake);
+            return;
         }
     }
+}
 
-     
-    //If multiple remain with the same priority, but different directions,
-    //pick the direction opposite the last used (or West).
-     
-    if (ccount > 1) {
-        int eastCount = 0, westCount = 0;
-        for (int i = 0; i < ccount; i++) {
-            if (g_trains[candidate[i]].direction == EAST) eastCount++;
-            else westCount++;
-        }
-        if (eastCount > 0 && westCount > 0) {
-            Direction desiredDir;
-            if (!g_anyTrainCrossed) {
-                desiredDir = WEST; // If no train crossed, West
-            } else {
-                desiredDir = (g_lastDirectionUsed == EAST) ? WEST : EAST;
-            }
-            
-            int tmpList[MAX_TRAINS];
-            int tmpCount = 0;
-            for (int i = 0; i < ccount; i++) {
-                if (g_trains[candidate[i]].direction == desiredDir) {
-                    tmpList[tmpCount++] = candidate[i];
-                }
-            }
-            if (tmpCount > 0) {
-                memcpy(candidate, tmpList, tmpCount * sizeof(int));
-                ccount = tmpCount;
-            }
-        }
+//a train came OFF the track; called by the scheduler, in crossing order
+void recordCrossing(const TrainInfo* train)
+{
+    //a train following another onto the track in headway mode could go
+    //once that one had been ON for the headway
+    double free = g_stats.trackFreeTime;
+    if (train->onTime < free) {
+        free = g_stats.lastOnTime + g_headway / 10.0;
     }
+    double from = train->readyTime > free ? train->readyTime : free;
+    double latency = train->onTime - from;
 
-   
-    //If multiple trains remain (same direction), pick earliest readyTime 
-    //(tie for lower ID).
-  
-    if (ccount > 1) {
-        for (int i = 0; i < ccount - 1; i++) {
-            for (int j = i + 1; j < ccount; j++) {
-                TrainInfo* A = &g_trains[candidate[i]];
-                TrainInfo* B = &g_trains[candidate[j]];
-                if (A->readyTime > B->readyTime) {
-                    int tmp = candidate[i];
-                    candidate[i] = candidate[j];
-                    candidate[j] = tmp;
-                } else if (A->readyTime == B->readyTime) {
-                    // tie => compare ID
-                    if (A->id < B->id) {
-                        int tmp = candidate[i];
-                        candidate[i] = candidate[j];
-                        candidate[j] = tmp;
-                    }
-                }
-            }
+    g_stats.crossings++;
+    g_stats.latencySum += latency;
+    if (latency > g_stats.latencyMax) {
+        g_stats.latencyMax = latency;
+    }
+    g_stats.busyTime += train->offTime - (train->onTime > g_stats.trackFreeTime ? train->onTime : g_stats.trackFreeTime);
+    g_stats.trackFreeTime = train->offTime;
+    g_stats.lastOnTime = train->onTime;
+}
+
+static long contextSwitches()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_nvcsw + usage.ru_nivcsw;
+}
+
+//the summary of --stats: how far the run drifted from the model, which
+//has trains ready exactly at their loading time and crossings lasting
+//exactly their crossing time
+void printStats()
+{
+    double mean = g_stats.crossings ? g_stats.latencySum / g_stats.crossings : 0.0;
+    double end = g_stats.trackFreeTime;
+    double* loads = malloc((g_trainCount + 1) * sizeof(double));
+    double* waits = malloc((g_trainCount + 1) * sizeof(double));
+    double* crossings = malloc((g_trainCount + 1) * sizeof(double));
+    int n = 0;
+
+    if (!loads || !waits || !crossings) {
+        fprintf(stderr, "Out of memory for the statistics.\n");
+        exit(1);
+    }
+    for (int i = 0; i < g_trainCount; i++) {
+        const TrainInfo* t = &g_trains[i];
+        if (!atomic_load(&t->doneCrossing)) {
+            continue;
         }
+        loads[n]     = t->readyTime - t->loadingTime / 10.0;
+        waits[n]     = t->onTime - t->readyTime;
+        crossings[n] = (t->offTime - t->onTime) - t->crossingTime / 10.0;
+        n++;
     }
 
-    return candidate[0];
+    fprintf(stderr, "Dispatch latency: mean %.1f us, max %.1f us over %ld crossings\n",
+            mean * 1e6, g_stats.latencyMax * 1e6, g_stats.crossings);
+    fprintf(stderr, "Context switches: %ld (%.2f per crossing)\n",
+            g_stats.switches,
+            g_stats.crossings ? (double) g_stats.switches / g_stats.crossings : 0.0);
+    printDistribution("Load overshoot:", loads, n);
+    printDistribution("Platform wait:", waits, n);
+    printDistribution("Crossing overshoot:", crossings, n);
+    fprintf(stderr, "Track utilization: %.1f%% over %.3f s\n",
+            end > 0 ? g_stats.busyTime / end * 100.0 : 0.0, end);
+    fprintf(stderr, "Throughput: %.2f trains/minute\n",
+            end > 0 ? g_stats.crossings / (end / 60.0) : 0.0);
+
+    free(crossings);
+    free(waits);
+    free(loads);
 }
 
+//headway mode: the throughput of the run against crossing one at a time
+void printHeadwayGain(double strictEnd)
+{
+    double end = g_stats.trackFreeTime;
+
+    if (end <= 0 || strictEnd <= 0) {
+        return;
+    }
+    fprintf(stderr, "Headway %.1f s: %ld trains in %.1f s, %.2f trains/minute\n",
+            g_headway / 10.0, g_stats.crossings, end, g_stats.crossings / (end / 60.0));
+    fprintf(stderr, "One at a time: %d trains in %.1f s, %.2f trains/minute\n",
+            g_trainCount, strictEnd, g_trainCount / (strictEnd / 60.0));
+    fprintf(stderr, "Throughput gain: %+.1f%%\n", (strictEnd / end - 1.0) * 100.0);
+}
+
+// -------------------- dispatchTrain() --------------------
+
+//takes the chosen train off the ready set and gives it the main track
+TrainInfo* dispatchTrain(int chosen)
+{
+    readyRemove(&g_ready, chosen);
+
+    // isCrossing = 1, update last direction usag
+    TrainInfo* t = &g_trains[chosen];
+    t->isCrossing = 1;
+    trackUse(&g_track, t->direction);
+    return t;
+}
+
+//jobs a train hands to the worker pool
+typedef enum {
+    JOB_READY,
+    JOB_CROSS
+} JobKind;
+
 // Scheduler --------------------
 
+//takes in the trains published since the last call
+void takeReadyTrains()
+{
+    for (int id = mpscTakeAll(&g_published); id >= 0; id = mpscNext(&g_published, id)) {
+        readyInsert(&g_ready, id);
+        g_trainsTaken++;
+    }
+}
+
+//how many trains are due to have loaded by `tenth`
+static int loadsDueBy(int tenth)
+{
+    int lo = 0, hi = g_trainCount;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (g_loadTimes[mid] <= tenth) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static int compareInt(const void* a, const void* b)
+{
+    return *(const int*)a - *(const int*)b;
+}
+
+//takes off the trains that came OFF the track, in the order they went ON
+void takeCrossedTrains()
+{
+    while (g_onTrackHead < g_onTrackTail) {
+        TrainInfo* t = &g_trains[g_onTrack[g_onTrackHead]];
+        if (!atomic_load(&t->doneCrossing)) {
+            break;
+        }
+        recordCrossing(t);
+        g_trainsDone++;
+        g_onTrackHead++;
+    }
+}
+
 void runScheduler()
 {
-    pthread_mutex_lock(&g_schedulerMutex);
+    long long lastDispatch = 0;
 
-    while (g_trainsDone < g_trainCount) {
-        // if no trains ready
-        while (g_readyCount == 0 && g_trainsDone < g_trainCount) {
-            pthread_cond_wait(&g_trainReadyCond, &g_schedulerMutex);
+    // with the track taken, only headway mode can use new ready trains
+    int busyWait = g_headway > 0 ? WAITING_FOR_READY | WAITING_FOR_DONE : WAITING_FOR_DONE;
+
+    for (;;) {
+        takeCrossedTrains();
+        if (g_trainsDone == g_trainCount) {
+            break;
         }
+        takeReadyTrains();
 
-        if (g_trainsDone >= g_trainCount) {
-            break; 
+        // the first train to come OFF, if the track is taken
+        TrainInfo* front = NULL;
+        if (g_onTrackHead < g_onTrackTail) {
+            front = &g_trains[g_onTrack[g_onTrackHead]];
         }
 
-        int chosen = pickNextTrain();
-        if (chosen < 0) {
-        
+        // if no trains ready
+        if (g_ready.count == 0) {
+            parkScheduler(front ? busyWait : WAITING_FOR_READY, front, 0);
             continue;
         }
 
-        // Remove from g_readyTrains 
-        int removePos = -1;
-        for (int i = 0; i < g_readyCount; i++) {
-            if (g_readyTrains[i] == chosen) {
-                removePos = i;
-                break;
-            }
+        // events at the same tenth as in virtual time: the trains that
+        // finish loading then are in before the pick
+        if (g_trainsTaken < loadsDueBy(getSimulationNanos() / NANOS_PER_TENTH)) {
+            parkScheduler(WAITING_FOR_READY, NULL, 0);
+            continue;
         }
-        if (removePos >= 0) {
-            for (int i = removePos; i < g_readyCount - 1; i++) {
-                g_readyTrains[i] = g_readyTrains[i + 1];
+
+        int chosen = pickNextTrain(&g_ready, &g_track);
+        int ahead = -1;
+        if (front) {
+            // a change of direction waits for the track to clear
+            if (g_headway == 0 || g_trains[chosen].direction != g_track.lastDirectionUsed) {
+                parkScheduler(busyWait, front, 0);
+                continue;
+            }
+            // a train going the same way follows once the headway is up
+            ahead = g_onTrack[g_onTrackTail - 1];
+            long long on = atomic_load(&g_trains[ahead].onNanos);
+            long long due = (on > 0 ? on : lastDispatch) + g_headway * NANOS_PER_TENTH;
+            if (getSimulationNanos() < due) {
+                parkScheduler(busyWait, front, due);
+                continue;
             }
-            g_readyCount--;
         }
 
-        // isCrossing = 1, update last direction usag
-        TrainInfo* t = &g_trains[chosen];
-        t->isCrossing = 1;
+        TrainInfo* t = dispatchTrain(chosen);
+        t->ahead = ahead;
+        g_onTrack[g_onTrackTail++] = t->id;
+        lastDispatch = getSimulationNanos();
 
-        if (!g_anyTrainCrossed) {
-            g_lastDirectionUsed = t->direction;
-            g_consecutiveDirectionCount = 1;
-            g_anyTrainCrossed = 1;
-        } else {
-            if (t->direction == g_lastDirectionUsed) {
-                g_consecutiveDirectionCount++;
+        // A worker takes the train across
+        poolSubmit(t->id, JOB_CROSS);
+    }
+}
+
+//Train jobs --------------------
+//
+//A train has no thread of its own: the timer thread fires its load
+//completion from the timer wheel, and the worker pool runs its two
+//steps, getting ready and crossing, as jobs.
+
+void trainReady(TrainInfo* train)
+{
+    // readyTime
+    double simTime = getSimulationTime();
+    train->readyTime = simTime;
+    logTrainEvent(simTime, train, LOG_READY);
+
+    // Publish to the scheduler
+    mpscPush(&g_published, train->id);
+    wakeScheduler(WAITING_FOR_READY);
+}
+
+void trainCross(TrainInfo* train)
+{
+    // ON main track
+    long long onNanos = getSimulationNanos();
+    train->onTime = onNanos / 1e9;
+    atomic_store(&train->onNanos, onNanos);
+    logTrainEvent(train->onTime, train, LOG_ON);
+
+    // headway mode: no overtaking, it comes OFF after the train ahead
+    long long due = onNanos + train->crossingTime * NANOS_PER_TENTH;
+    TrainInfo* ahead = train->ahead >= 0 ? &g_trains[train->ahead] : NULL;
+    if (ahead && atomic_load(&ahead->offDue) > due) {
+        due = atomic_load(&ahead->offDue);
+    }
+    atomic_store(&train->offDue, due);
+
+    sleepUntil(due);
+    if (ahead) {
+        // due OFF at the same time, or late
+        while (sem_wait(&g_offTrack[ahead->id]) == -1 && errno == EINTR) {
+            // retry
+        }
+    }
+
+    // OFF main track
+    train->offTime = getSimulationTime();
+    logTrainEvent(train->offTime, train, LOG_OFF);
+
+    atomic_store(&train->doneCrossing, 1);
+    if (g_offTrack) {
+        sem_post(&g_offTrack[train->id]);
+    }
+    wakeScheduler(WAITING_FOR_DONE);
+}
+
+void runTrainJob(int id, int kind)
+{
+    if (kind == JOB_READY) {
+        trainReady(&g_trains[id]);
+    } else {
+        trainCross(&g_trains[id]);
+    }
+}
+
+void trainLoaded(int id)
+{
+    poolSubmit(id, JOB_READY);
+}
+
+//Timer Thread --------------------
+//fires the load completions, a tick every tenth of a second
+void* timerThread(void* arg)
+{
+    for (int tick = 0; wheelPending() > 0; tick++) {
+        sleepUntil(tick * NANOS_PER_TENTH);
+        wheelExpire(tick, trainLoaded);
+    }
+    return NULL;
+}
+
+// Virtual time --------------------
+//
+//A single-threaded discrete-event run: time jumps from one event to the
+//next, in tenths of a second, so a run is instant and its log is that
+//of an ideal real-time run. Events at the same tenth are handled trains
+//finishing loading first, in train order, then trains coming OFF the
+//track (a real run reaches them a little late, after the scheduler's
+//handoffs); then the scheduler picks the next train with the same
+//pickNextTrain() rules, among all trains ready by then. `logged` = 0
+//runs without a log, for the one-at-a-time run headway mode is
+//measured against.
+
+void runVirtualTime(int logged)
+{
+    int onTrack = 0;               // trains on the track
+    int lastOn = 0;                // when the last of them went ON
+    int lastOff = 0;               // and is due OFF
+    int headwayPending = 0;
+
+    eventsInit(g_trainCount);
+    for (int i = 0; i < g_trainCount; i++) {
+        pushEvent(g_trains[i].loadingTime, SIM_LOADED, i);
+    }
+
+    while (eventCount() > 0) {
+        int now = nextEventTime();
+
+        while (eventCount() > 0 && nextEventTime() == now) {
+            SimEvent ev = popEvent();
+            if (ev.type == SIM_HEADWAY) {
+                headwayPending = 0;
+                continue;
+            }
+            TrainInfo* t = &g_trains[ev.train];
+
+            if (ev.type == SIM_CROSSED) {
+                t->offTime = now / 10.0;
+                if (logged) {
+                    logTrainEvent(t->offTime, t, LOG_OFF);
+                }
+                recordCrossing(t);
+                t->doneCrossing = 1;
+                g_trainsDone++;
+                onTrack--;
             } else {
-                g_lastDirectionUsed = t->direction;
-                g_consecutiveDirectionCount = 1;
+                t->readyTime = now / 10.0;
+                if (logged) {
+                    logTrainEvent(t->readyTime, t, LOG_READY);
+                }
+                readyInsert(&g_ready, t->id);
             }
         }
 
-        // Signaling the train so it can proceed to cross
-        pthread_cond_signal(&t->canCrossCond);
+        // until the next train has to wait
+        while (g_ready.count > 0) {
+            TrainInfo* t = &g_trains[pickNextTrain(&g_ready, &g_track)];
+            if (onTrack > 0) {
+                // a change of direction waits for the track to clear
+                if (g_headway == 0 || t->direction != g_track.lastDirectionUsed) {
+                    break;
+                }
+                // a train going the same way follows once the headway is up
+                if (now < lastOn + g_headway) {
+                    if (!headwayPending) {
+                        pushEvent(lastOn + g_headway, SIM_HEADWAY, -1);
+                        headwayPending = 1;
+                    }
+                    break;
+                }
+            }
 
-        while (!t->doneCrossing && g_trainsDone < g_trainCount) {
-            pthread_cond_wait(&g_trainReadyCond, &g_schedulerMutex);
+            dispatchTrain(t->id);
+            t->onTime = now / 10.0;
+            if (logged) {
+                logTrainEvent(t->onTime, t, LOG_ON);
+            }
+            // no overtaking: it comes OFF after the train ahead
+            int off = now + t->crossingTime;
+            if (onTrack > 0 && off < lastOff) {
+                off = lastOff;
+            }
+            pushEvent(off, SIM_CROSSED, t->id);
+            onTrack++;
+            lastOn = now;
+            lastOff = off;
         }
     }
+    eventsFree();
+}
 
-    pthread_mutex_unlock(&g_schedulerMutex);
+//sets the trains and the run back to before any train loaded
+void resetRun()
+{
+    for (int i = 0; i < g_trainCount; i++) {
+        TrainInfo* t = &g_trains[i];
+        t->readyTime  = 0.0;
+        t->readyIndex = -1;
+        t->onTime     = 0.0;
+        t->offTime    = 0.0;
+        t->isCrossing = 0;
+        t->ahead      = -1;
+        atomic_init(&t->doneCrossing, 0);
+        atomic_init(&t->onNanos, 0);
+        atomic_init(&t->offDue, 0);
+    }
+    memset(&g_stats, 0, sizeof(g_stats));
+    g_trainsDone = 0;
 }
 
-//Train Thread --------------------
-void* trainThread(void* arg)
+//when the last train comes OFF, in seconds, crossing one at a time:
+//a virtual run without headway, which headway mode is measured against
+double strictMakespan(int starvationLimit)
 {
-    TrainInfo* train = (TrainInfo*)arg;
+    int headway = g_headway;
 
-    usleep(train->loadingTime * 100000); // to microseconds
+    g_headway = 0;
+    trackInit(&g_track, starvationLimit, 0);
+    runVirtualTime(0);
+    double end = g_stats.trackFreeTime;
 
-    // readyTime
-    double simTime = getSimulationTime();
-    train->readyTime = simTime;
+    g_headway = headway;
+    resetRun();
+    return end;
+}
 
-    {
-        char buf[16];
-        formatSimTime(buf, sizeof(buf), simTime);
-        printf("%s Train %2d is ready to go %4s\n",
-               buf,
-               train->id,
-               (train->direction == EAST) ? "East" : "West");
-        fflush(stdout);
+//Real time --------------------
+//A bounded number of threads whatever the number of trains: the
+//scheduler (the main thread), the timer thread and the workers.
+void runRealTime(int workers)
+{
+    pthread_t timer;
+
+    // a crossing holds a worker. In headway mode trains go ON at least
+    // the headway apart and all those still on the track went ON within
+    // the longest crossing, so the pool takes them all, and a load.
+    if (g_headway > 0) {
+        int longest = 0;
+        for (int i = 0; i < g_trainCount; i++) {
+            if (g_trains[i].crossingTime > longest) {
+                longest = g_trains[i].crossingTime;
+            }
+        }
+        if (workers < longest / g_headway + 2) {
+            workers = longest / g_headway + 2;
+        }
     }
 
-    // Add to ready list
-    pthread_mutex_lock(&g_schedulerMutex);
-    g_readyTrains[g_readyCount++] = train->id;
-    pthread_cond_broadcast(&g_trainReadyCond);
-
-    // Wait until the scheduler picks train
-    while (!train->isCrossing) {
-        pthread_cond_wait(&train->canCrossCond, &g_schedulerMutex);
+    g_onTrack = malloc((g_trainCount + 1) * sizeof(int));
+    g_loadTimes = malloc((g_trainCount + 1) * sizeof(int));
+    if (!g_onTrack || !g_loadTimes) {
+        fprintf(stderr, "Out of memory for the track.\n");
+        exit(1);
     }
-    pthread_mutex_unlock(&g_schedulerMutex);
-
-    // ON main track
-    simTime = getSimulationTime();
-    {
-        char buf[16];
-        formatSimTime(buf, sizeof(buf), simTime);
-        printf("%s Train %2d is ON the main track going %4s\n",
-               buf,
-               train->id,
-               (train->direction == EAST) ? "East" : "West");
-        fflush(stdout);
+    for (int i = 0; i < g_trainCount; i++) {
+        g_loadTimes[i] = g_trains[i].loadingTime;
+    }
+    qsort(g_loadTimes, g_trainCount, sizeof(int), compareInt);
+    if (g_headway > 0) {
+        g_offTrack = malloc((g_trainCount + 1) * sizeof(sem_t));
+        if (!g_offTrack) {
+            fprintf(stderr, "Out of memory for the track.\n");
+            exit(1);
+        }
+        for (int i = 0; i < g_trainCount; i++) {
+            sem_init(&g_offTrack[i], 0, 0);
+        }
+    }
+    sem_init(&g_schedulerWake, 0, 0);
+    mpscInit(&g_published, g_trainCount);
+    wheelInit(WHEEL_SLOTS, g_trainCount);
+    for (int i = 0; i < g_trainCount; i++) {
+        wheelAdd(i, g_trains[i].loadingTime);
+    }
+    poolStart(workers, g_trainCount, runTrainJob);
+    if (pthread_create(&timer, NULL, timerThread, NULL) != 0) {
+        fprintf(stderr, "Failed to create timer thread.\n");
+        exit(1);
     }
 
+    runScheduler();
 
-    usleep(train->crossingTime * 100000);
+    pthread_join(timer, NULL);
+    poolStop();
+    wheelFree();
+    mpscFree(&g_published);
+    sem_destroy(&g_schedulerWake);
+    if (g_offTrack) {
+        for (int i = 0; i < g_trainCount; i++) {
+            sem_destroy(&g_offTrack[i]);
+        }
+        free(g_offTrack);
+        g_offTrack = NULL;
+    }
+    free(g_loadTimes);
+    free(g_onTrack);
+}
 
-    // OFF main track
-    simTime = getSimulationTime();
-    {
-        char buf[16];
-        formatSimTime(buf, sizeof(buf), simTime);
-        printf("%s Train %2d is OFF the main track after going %4s\n",
-               buf,
-               train->id,
-               (train->direction == EAST) ? "East" : "West");
-        fflush(stdout);
-    }
-
-    pthread_mutex_lock(&g_schedulerMutex);
-    train->doneCrossing = 1;
-    g_trainsDone++;
-    pthread_cond_broadcast(&g_trainReadyCond);
-    pthread_mutex_unlock(&g_schedulerMutex);
+//parses a whole decimal option value into `number`; 0 if it is not one
+static int parseOptionNumber(const char* value, int* number)
+{
+    char* end;
+    errno = 0;
+    long n = strtol(value, &end, 10);
+    if (end == value || *end != '\0' || errno == ERANGE || n < INT_MIN || n > INT_MAX) {
+        return 0;
+    }
+    *number = (int) n;
+    return 1;
+}
 
-    return NULL;
+static void usage(const char* prog)
+{
+    fprintf(stderr, "Usage: %s [--virtual-time] [--workers=<n>] [--stats]\n"
+                    "          [--headway=<tenths>] [--starvation=<n>] <input_file>\n", prog);
+    fprintf(stderr, "       %s --network <network_file>\n", prog);
 }
 
 int main(int argc, char* argv[])
 {
-    if (argc < 2) {
-        fprintf(stderr, "Usage: %s <input_file>\n", argv[0]);
+    static struct option longOptions[] = {
+        { "virtual-time", no_argument,       NULL, 'v' },
+        { "workers",      required_argument, NULL, 'w' },
+        { "stats",        no_argument,       NULL, 's' },
+        { "network",      no_argument,       NULL, 'n' },
+        { "headway",      required_argument, NULL, 'H' },
+        { "starvation",   required_argument, NULL, 'S' },
+        { NULL,           0,                 NULL, 0   }
+    };
+    int virtualTime = 0;
+    int workers = DEFAULT_WORKERS;
+    int stats = 0;
+    int network = 0;
+    int starvationLimit = DEFAULT_STARVATION_LIMIT;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "vw:snH:S:", longOptions, NULL)) != -1) {
+        switch (opt) {
+            case 'v':
+                virtualTime = 1;
+                break;
+            case 's':
+                stats = 1;
+                break;
+            case 'n':
+                network = 1;
+                break;
+            case 'H':
+                if (!parseOptionNumber(optarg, &g_headway)) {
+                    fprintf(stderr, "Invalid --headway: %s\n", optarg);
+                    return 1;
+                }
+                if (g_headway < 0) {
+                    fprintf(stderr, "--headway must not be negative.\n");
+                    return 1;
+                }
+                break;
+            case 'S':
+                // trains in a row one way while others wait, 0 => no limit
+                if (!parseOptionNumber(optarg, &starvationLimit)) {
+                    fprintf(stderr, "Invalid --starvation: %s\n", optarg);
+                    return 1;
+                }
+                if (starvationLimit < 0) {
+                    fprintf(stderr, "--starvation must not be negative.\n");
+                    return 1;
+                }
+                break;
+            case 'w':
+                // a crossing holds a worker, so loads need another one
+                if (!parseOptionNumber(optarg, &workers)) {
+                    fprintf(stderr, "Invalid --workers: %s\n", optarg);
+                    return 1;
+                }
+                if (workers < 2) {
+                    fprintf(stderr, "--workers must be at least 2.\n");
+                    return 1;
+                }
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (optind != argc - 1) {
+        usage(argv[0]);
         return 1;
     }
 
-    gettimeofday(&simulationStartTime, NULL);
+    //a network runs in virtual time, and reports when it is done
+    if (network) {
+        Network* net = networkLoad(argv[optind]);
+        logStart();
+        int stuck = networkRun(net);
+        logStop();
+        networkReport(net);
+        networkFree(net);
+        return stuck > 0 ? 1 : 0;
+    }
 
-    
-    FILE* fp = fopen(argv[1], "r");
+    FILE* fp = fopen(argv[optind], "r");
     if (!fp) {
         perror("Failed to open file");
         return 1;
@@ -364,12 +798,17 @@ int main(int argc, char* argv[])
         
         int itemsRead = fscanf(fp, " %c %d %d", &directionChar, &loadT, &crossT);
         if (itemsRead == 3) {
+            if (g_trainCount == g_trainCapacity) {
+                g_trainCapacity = g_trainCapacity ? 2 * g_trainCapacity : 64;
+                g_trains = realloc(g_trains, g_trainCapacity * sizeof(TrainInfo));
+                if (!g_trains) {
+                    fprintf(stderr, "Out of memory reading trains.\n");
+                    fclose(fp);
+                    return 1;
+                }
+            }
             TrainInfo* t = &g_trains[g_trainCount];
             t->id             = g_trainCount;
-            t->readyTime      = 0.0;
-            t->isCrossing     = 0;
-            t->doneCrossing   = 0;
-            pthread_cond_init(&t->canCrossCond, NULL);
 
             switch (directionChar) {
                 case 'e':
@@ -393,14 +832,15 @@ int main(int argc, char* argv[])
                     fclose(fp);
                     return 1;
             }
+            if (loadT < 0 || crossT < 0) {
+                fprintf(stderr, "Negative loading or crossing time for train %d.\n", g_trainCount);
+                fclose(fp);
+                return 1;
+            }
             t->loadingTime  = loadT;
             t->crossingTime = crossT;
 
             g_trainCount++;
-            if (g_trainCount >= MAX_TRAINS) {
-                fprintf(stderr, "Reached max train limit.\n");
-                break;
-            }
         } 
         else if (itemsRead == EOF) {
             break; 
@@ -413,24 +853,35 @@ int main(int argc, char* argv[])
     }
     fclose(fp);
 
-    // Create threads
-    pthread_t threads[MAX_TRAINS];
-    for (int i = 0; i < g_trainCount; i++) {
-        pthread_create(&threads[i], NULL, trainThread, &g_trains[i]);
-    }
-
-    runScheduler();
+    readyInit(&g_ready, g_trains);
+    resetRun();
 
-    for (int i = 0; i < g_trainCount; i++) {
-        pthread_join(threads[i], NULL);
+    double strictEnd = 0.0;
+    if (g_headway > 0) {
+        strictEnd = strictMakespan(starvationLimit);
+    }
+    trackInit(&g_track, starvationLimit, g_headway > 0);
+
+    long switches = contextSwitches();
+    clock_gettime(CLOCK_MONOTONIC, &simulationStartTime);
+    logStart();
+    if (virtualTime) {
+        runVirtualTime(1);
+    } else {
+        runRealTime(workers);
+    }
+    logStop();
+    g_stats.switches = contextSwitches() - switches;
+    if (stats) {
+        printStats();
+    }
+    if (g_headway > 0) {
+        printHeadwayGain(strictEnd);
     }
 
     // Cleanup
-    for (int i = 0; i < g_trainCount; i++) {
-        pthread_cond_destroy(&g_trains[i].canCrossCond);
-    }
-    pthread_mutex_destroy(&g_schedulerMutex);
-    pthread_cond_destroy(&g_trainReadyCond);
+    free(g_trains);
+    readyFree(&g_ready);
 
     return 0;
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -0,0 +1,594 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "events.h"
+#include "logger.h"
+#include "network.h"
+#include "ready.h"
+#include "stats.h"
+
+#define BUSIEST_SEGMENTS 5         // listed by networkReport()
+
+typedef struct {
+    int             capacity;      // trains that can wait here
+    int             used;          // places held, by trains here or on their way
+    int*            segments;      // that end here
+    int             segmentCount;
+    int             segmentCapacity;
+} Node;
+
+typedef struct {
+    int             ends[2];       // EAST runs from ends[0] to ends[1]
+    int             crossingTime;  // in tenths of a second
+    ReadySet        ready;         // trains holding a place beyond it
+    TrackState      track;
+    int             busy;
+    int             queued;        // in the dispatch queue
+    long            crossings;
+    long            busyTime;      // in tenths of a second
+} Segment;
+
+//a train's way through the network: legs[firstLeg .. firstLeg + legCount)
+typedef struct {
+    int             firstLeg;
+    int             legCount;
+    int             leg;           // the one it is on or waiting for
+    int             nextWaiter;    // in the wait list of its onward leg
+    long            waitOrder;     // when it joined that list
+    double          startTime;     // ready at its first node
+    double          endTime;       // OFF its last segment
+} Journey;
+
+struct Network {
+    Node*           nodes;
+    int             nodeCount;
+    int             nodeCapacity;
+    Segment*        segments;
+    int             segmentCount;
+    int             segmentCapacity;
+    TrainInfo*      trains;        // the ready sets index these
+    Journey*        journeys;
+    int             trainCount;
+    int             trainCapacity;
+    int*            legs;          // segment * 2 + direction
+    int             legCount;
+    int             legCapacity;
+    int*            held;          // per leg: places held at its start by trains to take it
+    int*            waitHead;      // per leg: trains waiting for a place to take it, -1 => none
+    int*            waitTail;
+    long            waits;         // trains that have had to wait
+    int*            dispatchQueue; // segments that may dispatch now
+    int             dispatchCount;
+    int             arrived;
+    int             endTime;       // in tenths of a second
+};
+
+//makes room for one more item in a growing array
+static void* grow(void* items, int count, int* capacity, size_t size)
+{
+    if (count < *capacity) {
+        return items;
+    }
+    *capacity = *capacity ? 2 * *capacity : 16;
+    items = realloc(items, *capacity * size);
+    if (!items) {
+        fprintf(stderr, "Out of memory reading the network.\n");
+        exit(1);
+    }
+    return items;
+}
+
+// -------------------- networkLoad() --------------------
+
+static void endOfLine(char** save, int lineNo)
+{
+    if (strtok_r(NULL, " \t\r\n", save) != NULL) {
+        fprintf(stderr, "Line %d: too many fields.\n", lineNo);
+        exit(1);
+    }
+}
+
+static int parseNumber(const char* token, int lineNo, const char* what, int min, int max)
+{
+    char* end;
+    long value;
+
+    if (!token) {
+        fprintf(stderr, "Line %d: missing %s.\n", lineNo, what);
+        exit(1);
+    }
+    value = strtol(token, &end, 10);
+    if (*end != '\0' || value < min || value > max) {
+        fprintf(stderr, "Line %d: bad %s '%s'.\n", lineNo, what, token);
+        exit(1);
+    }
+    return (int) value;
+}
+
+static void addNode(Network* net, char** save, int lineNo)
+{
+    net->nodes = grow(net->nodes, net->nodeCount, &net->nodeCapacity, sizeof(Node));
+
+    Node* n = &net->nodes[net->nodeCount++];
+    memset(n, 0, sizeof(Node));
+    n->capacity = parseNumber(strtok_r(NULL, " \t\r\n", save), lineNo, "capacity", 0, 1 << 30);
+    endOfLine(save, lineNo);
+}
+
+static void addSegment(Network* net, char** save, int lineNo)
+{
+    int id = net->segmentCount;
+    net->segments = grow(net->segments, net->segmentCount, &net->segmentCapacity, sizeof(Segment));
+
+    Segment* s = &net->segments[net->segmentCount++];
+    memset(s, 0, sizeof(Segment));
+    for (int e = 0; e < 2; e++) {
+        s->ends[e] = parseNumber(strtok_r(NULL, " \t\r\n", save), lineNo, "node", 0, net->nodeCount - 1);
+    }
+    if (s->ends[0] == s->ends[1]) {
+        fprintf(stderr, "Line %d: a segment must join two nodes.\n", lineNo);
+        exit(1);
+    }
+    s->crossingTime = parseNumber(strtok_r(NULL, " \t\r\n", save), lineNo, "crossing time", 1, 1 << 30);
+    endOfLine(save, lineNo);
+    trackInit(&s->track, DEFAULT_STARVATION_LIMIT, 0);
+    readyInit(&s->ready, NULL);    // the trains are known once all are read
+
+    for (int e = 0; e < 2; e++) {
+        Node* n = &net->nodes[s->ends[e]];
+        n->segments = grow(n->segments, n->segmentCount, &n->segmentCapacity, sizeof(int));
+        n->segments[n->segmentCount++] = id;
+    }
+}
+
+//the leg from node `from` to node `to`, -1 if no segment joins them
+static int findLeg(const Network* net, int from, int to)
+{
+    const Node* n = &net->nodes[from];
+    for (int i = 0; i < n->segmentCount; i++) {
+        const Segment* s = &net->segments[n->segments[i]];
+        if (s->ends[0] == from && s->ends[1] == to) {
+            return n->segments[i] * 2 + EAST;
+        }
+        if (s->ends[1] == from && s->ends[0] == to) {
+            return n->segments[i] * 2 + WEST;
+        }
+    }
+    return -1;
+}
+
+static void addTrain(Network* net, char** save, int lineNo)
+{
+    int id = net->trainCount;
+    int capacity = net->trainCapacity;
+    net->trains = grow(net->trains, net->trainCount, &net->trainCapacity, sizeof(TrainInfo));
+    if (net->trainCapacity != capacity) {
+        net->journeys = realloc(net->journeys, net->trainCapacity * sizeof(Journey));
+        if (!net->journeys) {
+            fprintf(stderr, "Out of memory reading the network.\n");
+            exit(1);
+        }
+    }
+    net->trainCount++;
+
+    TrainInfo* t = &net->trains[id];
+    memset(t, 0, sizeof(TrainInfo));
+    t->id         = id;
+    t->readyIndex = -1;
+    t->ahead      = -1;
+    atomic_init(&t->doneCrossing, 0);
+
+    const char* priority = strtok_r(NULL, " \t\r\n", save);
+    if (!priority || (strcmp(priority, "H") != 0 && strcmp(priority, "L") != 0)) {
+        fprintf(stderr, "Line %d: the priority must be H or L.\n", lineNo);
+        exit(1);
+    }
+    t->priority    = (priority[0] == 'H') ? HIGH_PRIORITY : LOW_PRIORITY;
+    t->loadingTime = parseNumber(strtok_r(NULL, " \t\r\n", save), lineNo, "loading time", 0, 1 << 30);
+
+    Journey* j = &net->journeys[id];
+    memset(j, 0, sizeof(Journey));
+    j->firstLeg   = net->legCount;
+    j->nextWaiter = -1;
+
+    int from = parseNumber(strtok_r(NULL, " \t\r\n", save), lineNo, "node", 0, net->nodeCount - 1);
+    const char* token;
+    while ((token = strtok_r(NULL, " \t\r\n", save)) != NULL) {
+        int to = parseNumber(token, lineNo, "node", 0, net->nodeCount - 1);
+        int leg = findLeg(net, from, to);
+        if (leg < 0) {
+            fprintf(stderr, "Line %d: no segment joins nodes %d and %d.\n", lineNo, from, to);
+            exit(1);
+        }
+        if (j->legCount > 0 && net->nodes[from].capacity == 0) {
+            fprintf(stderr, "Line %d: train %d cannot stop at node %d, which has no room.\n",
+                    lineNo, id, from);
+            exit(1);
+        }
+        net->legs = grow(net->legs, net->legCount, &net->legCapacity, sizeof(int));
+        net->legs[net->legCount++] = leg;
+        j->legCount++;
+        from = to;
+    }
+    if (j->legCount == 0) {
+        fprintf(stderr, "Line %d: a route needs at least two nodes.\n", lineNo);
+        exit(1);
+    }
+}
+
+Network* networkLoad(const char* path)
+{
+    FILE* fp = fopen(path, "r");
+    if (!fp) {
+        perror("Failed to open file");
+        exit(1);
+    }
+
+    Network* net = calloc(1, sizeof(Network));
+    if (!net) {
+        fprintf(stderr, "Out of memory reading the network.\n");
+        exit(1);
+    }
+
+    char* line = NULL;
+    size_t lineSize = 0;
+    int lineNo = 0;
+    while (getline(&line, &lineSize, fp) != -1) {
+        char* save;
+        char* hash = strchr(line, '#');
+        lineNo++;
+        if (hash) {
+            *hash = '\0';
+        }
+
+        char* kind = strtok_r(line, " \t\r\n", &save);
+        if (!kind) {
+            continue;
+        }
+        if (strcmp(kind, "node") == 0) {
+            addNode(net, &save, lineNo);
+        } else if (strcmp(kind, "segment") == 0) {
+            addSegment(net, &save, lineNo);
+        } else if (strcmp(kind, "train") == 0) {
+            addTrain(net, &save, lineNo);
+        } else {
+            fprintf(stderr, "Line %d: unknown item '%s'.\n", lineNo, kind);
+            exit(1);
+        }
+    }
+    free(line);
+    fclose(fp);
+
+    for (int i = 0; i < net->segmentCount; i++) {
+        net->segments[i].ready.trains = net->trains;
+    }
+    net->dispatchQueue = malloc((net->segmentCount + 1) * sizeof(int));
+    net->held = calloc(2 * net->segmentCount + 1, sizeof(int));
+    net->waitHead = malloc((2 * net->segmentCount + 1) * sizeof(int));
+    net->waitTail = malloc((2 * net->segmentCount + 1) * sizeof(int));
+    if (!net->dispatchQueue || !net->held || !net->waitHead || !net->waitTail) {
+        fprintf(stderr, "Out of memory reading the network.\n");
+        exit(1);
+    }
+    for (int i = 0; i < 2 * net->segmentCount; i++) {
+        net->waitHead[i] = -1;
+        net->waitTail[i] = -1;
+    }
+    return net;
+}
+
+// -------------------- networkRun() --------------------
+
+static int legSegment(int leg)
+{
+    return leg / 2;
+}
+
+static Direction legDirection(int leg)
+{
+    return (Direction)(leg % 2);
+}
+
+//the node a leg starts from
+static int legStart(const Network* net, int leg)
+{
+    return net->segments[legSegment(leg)].ends[legDirection(leg) == EAST ? 0 : 1];
+}
+
+//the leg that leaves `node` by `segment`
+static int legFrom(const Network* net, int segment, int node)
+{
+    return segment * 2 + (net->segments[segment].ends[0] == node ? EAST : WEST);
+}
+
+//queues a segment to dispatch on at the current tenth
+static void markSegment(Network* net, int segment)
+{
+    Segment* s = &net->segments[segment];
+    if (!s->queued && !s->busy && s->ready.count > 0) {
+        s->queued = 1;
+        net->dispatchQueue[net->dispatchCount++] = segment;
+    }
+}
+
+//the train holds a place beyond its next segment: it waits for it
+static void enterSegment(Network* net, int id, int now)
+{
+    TrainInfo* t = &net->trains[id];
+    int leg = net->legs[net->journeys[id].firstLeg + net->journeys[id].leg];
+    Segment* s = &net->segments[legSegment(leg)];
+
+    t->direction    = legDirection(leg);
+    t->crossingTime = s->crossingTime;
+    logSegmentEvent(now / 10.0, t, LOG_READY, legSegment(leg));
+    readyInsert(&s->ready, id);
+    markSegment(net, legSegment(leg));
+}
+
+//the leg after the one the train is on or waiting for
+static int onwardLeg(const Network* net, int id)
+{
+    const Journey* j = &net->journeys[id];
+    return net->legs[j->firstLeg + j->leg + 1];
+}
+
+//whether a train that will leave by `onward` can take a place at its
+//start. The last place is kept for a train leaving another way than
+//those already there: two nodes full of trains bound for each other
+//would wait on each other for ever.
+static int hasRoom(const Network* net, int onward)
+{
+    const Node* n = &net->nodes[legStart(net, onward)];
+
+    if (n->used == n->capacity) {
+        return 0;
+    }
+    return n->used < n->capacity - 1 || net->held[onward] == 0;
+}
+
+static void takePlace(Network* net, int id, int now)
+{
+    int onward = onwardLeg(net, id);
+
+    net->nodes[legStart(net, onward)].used++;
+    net->held[onward]++;
+    enterSegment(net, id, now);
+}
+
+//the train is at the start of its next leg: it takes a place beyond it,
+//or waits for one
+static void requestLeg(Network* net, int id, int now)
+{
+    Journey* j = &net->journeys[id];
+
+    if (j->leg == j->legCount - 1) {
+        enterSegment(net, id, now);
+        return;
+    }
+
+    int onward = onwardLeg(net, id);
+    if (hasRoom(net, onward)) {
+        takePlace(net, id, now);
+        return;
+    }
+    j->waitOrder = net->waits++;
+    if (net->waitHead[onward] < 0) {
+        net->waitHead[onward] = id;
+    } else {
+        net->journeys[net->waitTail[onward]].nextWaiter = id;
+    }
+    net->waitTail[onward] = id;
+}
+
+//a train left the node by `leg`: the trains waiting for a place there
+//take the places they may, in the order they came. Trains bound the
+//same way have room or not alike, so only the head of each onward
+//leg's wait list is looked at.
+static void releasePlace(Network* net, int leg, int now)
+{
+    int node = legStart(net, leg);
+    Node* n = &net->nodes[node];
+
+    n->used--;
+    net->held[leg]--;
+    while (n->used < n->capacity) {
+        int first = -1;
+        int firstLeg = -1;
+        for (int i = 0; i < n->segmentCount; i++) {
+            int onward = legFrom(net, n->segments[i], node);
+            int id = net->waitHead[onward];
+            if (id >= 0 && hasRoom(net, onward)
+                && (first < 0 || net->journeys[id].waitOrder < net->journeys[first].waitOrder)) {
+                first = id;
+                firstLeg = onward;
+            }
+        }
+        if (first < 0) {
+            return;
+        }
+        net->waitHead[firstLeg] = net->journeys[first].nextWaiter;
+        net->journeys[first].nextWaiter = -1;
+        takePlace(net, first, now);
+    }
+}
+
+static void dispatchSegment(Network* net, int segment, int now)
+{
+    Segment* s = &net->segments[segment];
+    int id = pickNextTrain(&s->ready, &s->track);
+    TrainInfo* t = &net->trains[id];
+    Journey* j = &net->journeys[id];
+
+    readyRemove(&s->ready, id);
+    trackUse(&s->track, t->direction);
+    s->busy = 1;
+    t->onTime = now / 10.0;
+    logSegmentEvent(t->onTime, t, LOG_ON, segment);
+    pushEvent(now + s->crossingTime, SIM_CROSSED, id);
+
+    if (j->leg > 0) {
+        releasePlace(net, net->legs[j->firstLeg + j->leg], now);
+    }
+}
+
+//the train came OFF the segment of its current leg
+static void crossed(Network* net, int id, int now)
+{
+    TrainInfo* t = &net->trains[id];
+    Journey* j = &net->journeys[id];
+    int segment = legSegment(net->legs[j->firstLeg + j->leg]);
+    Segment* s = &net->segments[segment];
+
+    t->offTime = now / 10.0;
+    logSegmentEvent(t->offTime, t, LOG_OFF, segment);
+    s->busy = 0;
+    s->crossings++;
+    s->busyTime += s->crossingTime;
+    markSegment(net, segment);
+
+    if (++j->leg == j->legCount) {
+        j->endTime = t->offTime;
+        atomic_store(&t->doneCrossing, 1);
+        net->arrived++;
+        return;
+    }
+    t->readyTime = now / 10.0;
+    requestLeg(net, id, now);
+}
+
+//Runs the network to the end, returning how many trains could not
+//reach their destination: when two nodes are full of trains that need
+//a place at the other, none of them can move again.
+//
+//Events at the same tenth are handled as in a single-track run, trains
+//finishing loading first, then trains coming OFF segments; then each
+//segment that has become free, or has got a ready train, picks its next
+//train. Only those segments are visited, so a tenth costs time in
+//proportion to what happens in it, not to the size of the network.
+int networkRun(Network* net)
+{
+    eventsInit(net->trainCount);
+    for (int i = 0; i < net->trainCount; i++) {
+        pushEvent(net->trains[i].loadingTime, SIM_LOADED, i);
+    }
+
+    while (eventCount() > 0) {
+        int now = nextEventTime();
+
+        net->endTime = now;
+        while (eventCount() > 0 && nextEventTime() == now) {
+            SimEvent ev = popEvent();
+
+            if (ev.type == SIM_CROSSED) {
+                crossed(net, ev.train, now);
+            } else {
+                TrainInfo* t = &net->trains[ev.train];
+                t->readyTime = now / 10.0;
+                net->journeys[ev.train].startTime = t->readyTime;
+                requestLeg(net, ev.train, now);
+            }
+        }
+
+        // a departure frees a place, which can admit a train to another segment
+        for (int i = 0; i < net->dispatchCount; i++) {
+            int segment = net->dispatchQueue[i];
+            net->segments[segment].queued = 0;
+            dispatchSegment(net, segment, now);
+        }
+        net->dispatchCount = 0;
+    }
+    eventsFree();
+    return net->trainCount - net->arrived;
+}
+
+// -------------------- networkReport() --------------------
+
+static const Network* g_sortNetwork;
+
+//busiest first, tie for lower id
+static int compareBusy(const void* a, const void* b)
+{
+    const Segment* x = &g_sortNetwork->segments[*(const int*)a];
+    const Segment* y = &g_sortNetwork->segments[*(const int*)b];
+    if (x->busyTime != y->busyTime) {
+        return (x->busyTime < y->busyTime) - (x->busyTime > y->busyTime);
+    }
+    return *(const int*)a - *(const int*)b;
+}
+
+//journey times, from ready at the first node to OFF the last segment,
+//and how busy the segments were over the run
+void networkReport(const Network* net)
+{
+    double end = net->endTime / 10.0;
+    double* journeys = malloc((net->trainCount + 1) * sizeof(double));
+    int* order = malloc((net->segmentCount + 1) * sizeof(int));
+    long busyTotal = 0;
+    int unused = 0;
+    int n = 0;
+
+    if (!journeys || !order) {
+        fprintf(stderr, "Out of memory for the report.\n");
+        exit(1);
+    }
+    for (int i = 0; i < net->trainCount; i++) {
+        const Journey* j = &net->journeys[i];
+        if (j->leg == j->legCount) {
+            journeys[n++] = j->endTime - j->startTime;
+        }
+    }
+    for (int i = 0; i < net->segmentCount; i++) {
+        order[i] = i;
+        busyTotal += net->segments[i].busyTime;
+        if (net->segments[i].crossings == 0) {
+            unused++;
+        }
+    }
+
+    fprintf(stderr, "Network: %d nodes, %d segments, %d of %d trains arrived by %.1f s\n",
+            net->nodeCount, net->segmentCount, net->arrived, net->trainCount, end);
+    if (net->arrived < net->trainCount) {
+        fprintf(stderr, "Deadlock: %d trains wait for places that will never free.\n",
+                net->trainCount - net->arrived);
+    }
+    printDistribution("Journey time:", journeys, n);
+    if (net->segmentCount > 0 && net->endTime > 0) {
+        fprintf(stderr, "Segment utilization: mean %.1f%%, %d segments unused\n",
+                busyTotal * 100.0 / net->endTime / net->segmentCount, unused);
+
+        g_sortNetwork = net;
+        qsort(order, net->segmentCount, sizeof(int), compareBusy);
+        for (int i = 0; i < net->segmentCount && i < BUSIEST_SEGMENTS; i++) {
+            const Segment* s = &net->segments[order[i]];
+            fprintf(stderr, "  segment %d (%d-%d): %.1f%% over %ld crossings\n",
+                    order[i], s->ends[0], s->ends[1],
+                    s->busyTime * 100.0 / net->endTime, s->crossings);
+        }
+    }
+    if (end > 0) {
+        fprintf(stderr, "Throughput: %.2f trains/minute\n", net->arrived / (end / 60.0));
+    }
+
+    free(order);
+    free(journeys);
+}
+
+void networkFree(Network* net)
+{
+    for (int i = 0; i < net->nodeCount; i++) {
+        free(net->nodes[i].segments);
+    }
+    for (int i = 0; i < net->segmentCount; i++) {
+        readyFree(&net->segments[i].ready);
+    }
+    free(net->dispatchQueue);
+    free(net->held);
+    free(net->waitHead);
+    free(net->waitTail);
+    free(net->legs);
+    free(net->journeys);
+    free(net->trains);
+    free(net->segments);
+    free(net->nodes);
+    free(net);
+}
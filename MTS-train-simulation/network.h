@@ -0,0 +1,37 @@
+#ifndef NETWORK_H
+#define NETWORK_H
+
+/*
+ * A network of single-track segments joined at nodes, stations or
+ * sidings where trains wait between segments. Every segment has its
+ * own dispatcher, a ReadySet and a TrackState, so the main track's
+ * priority, direction and starvation rules hold on each of them; a
+ * segment runs EAST from its first node to its second. A train follows
+ * its route node by node and may only enter a segment once it holds a
+ * place at the node beyond it, so a full siding stops trains before
+ * they leave, not on the track. The first and last node of a route are
+ * terminals: a train takes no place there.
+ *
+ * A node's last place is kept for a train leaving another way than the
+ * trains already there, which keeps a single line from locking up with
+ * each passing loop full of trains bound for the next. Round a cycle
+ * of nodes trains can still end up waiting on each other; networkRun()
+ * returns how many, and networkReport() says so.
+ *
+ * The network file has one item per line, numbered from 0 by kind in
+ * the order given, '#' starting a comment:
+ *
+ *   node <capacity>
+ *   segment <node> <node> <crossingTime>
+ *   train <H|L> <loadingTime> <node> <node> ...
+ *
+ * Times are in tenths of a second. A network runs in virtual time.
+ */
+typedef struct Network Network;
+
+Network* networkLoad(const char* path);
+int      networkRun(Network* net);
+void     networkReport(const Network* net);
+void     networkFree(Network* net);
+
+#endif
@@ -0,0 +1,137 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include "pool.h"
+
+typedef struct {
+    int     train;
+    int     kind;
+} Job;
+
+typedef struct {
+    pthread_t   thread;
+    sem_t       wake;
+    Job         job;           // handed over by poolSubmit()
+    int         hasJob;
+} Worker;
+
+//ring buffer of pending jobs
+static Job*      g_jobs;
+static int       g_jobCapacity;
+static int       g_jobHead = 0;
+static int       g_jobCount = 0;
+
+static Worker*   g_workers;
+static int       g_workerCount;
+static Worker**  g_idle;           // parked workers, a stack
+static int       g_idleCount = 0;
+static int       g_stopping = 0;
+static JobFunc   g_jobFunc;
+
+static pthread_mutex_t g_poolMutex = PTHREAD_MUTEX_INITIALIZER;
+
+//Worker --------------------
+static void* workerThread(void* arg)
+{
+    Worker* self = (Worker*)arg;
+
+    pthread_mutex_lock(&g_poolMutex);
+    for (;;) {
+        Job job;
+        if (self->hasJob) {
+            job = self->job;
+            self->hasJob = 0;
+        } else if (g_jobCount > 0) {
+            job = g_jobs[g_jobHead];
+            g_jobHead = (g_jobHead + 1) % g_jobCapacity;
+            g_jobCount--;
+        } else if (g_stopping) {
+            break; // stopping and drained
+        } else {
+            // park until handed a job or stopped
+            g_idle[g_idleCount++] = self;
+            pthread_mutex_unlock(&g_poolMutex);
+            while (sem_wait(&self->wake) != 0 && errno == EINTR) {
+                // retry
+            }
+            pthread_mutex_lock(&g_poolMutex);
+            continue;
+        }
+
+        pthread_mutex_unlock(&g_poolMutex);
+        g_jobFunc(job.train, job.kind);
+        pthread_mutex_lock(&g_poolMutex);
+    }
+    pthread_mutex_unlock(&g_poolMutex);
+
+    return NULL;
+}
+
+void poolStart(int workers, int capacity, JobFunc func)
+{
+    g_jobs        = malloc(capacity * sizeof(Job));
+    g_jobCapacity = capacity;
+    g_workers     = malloc(workers * sizeof(Worker));
+    g_idle        = malloc(workers * sizeof(Worker*));
+    g_workerCount = workers;
+    g_jobFunc     = func;
+    if (!g_jobs || !g_workers || !g_idle) {
+        fprintf(stderr, "Out of memory for the worker pool.\n");
+        exit(1);
+    }
+
+    for (int i = 0; i < workers; i++) {
+        Worker* w = &g_workers[i];
+        w->hasJob = 0;
+        sem_init(&w->wake, 0, 0);
+        if (pthread_create(&w->thread, NULL, workerThread, w) != 0) {
+            fprintf(stderr, "Failed to create worker thread.\n");
+            exit(1);
+        }
+    }
+}
+
+void poolSubmit(int train, int kind)
+{
+    pthread_mutex_lock(&g_poolMutex);
+    if (g_idleCount > 0) {
+        // straight to a parked worker
+        Worker* w = g_idle[--g_idleCount];
+        w->job.train = train;
+        w->job.kind  = kind;
+        w->hasJob = 1;
+        pthread_mutex_unlock(&g_poolMutex);
+        sem_post(&w->wake);
+        return;
+    }
+    if (g_jobCount == g_jobCapacity) {
+        fprintf(stderr, "Worker pool queue overflow.\n");
+        exit(1);
+    }
+    Job* job = &g_jobs[(g_jobHead + g_jobCount) % g_jobCapacity];
+    job->train = train;
+    job->kind  = kind;
+    g_jobCount++;
+    pthread_mutex_unlock(&g_poolMutex);
+}
+
+//runs the jobs still queued, then joins the workers
+void poolStop()
+{
+    pthread_mutex_lock(&g_poolMutex);
+    g_stopping = 1;
+    while (g_idleCount > 0) {
+        sem_post(&g_idle[--g_idleCount]->wake);
+    }
+    pthread_mutex_unlock(&g_poolMutex);
+
+    for (int i = 0; i < g_workerCount; i++) {
+        pthread_join(g_workers[i].thread, NULL);
+        sem_destroy(&g_workers[i].wake);
+    }
+    free(g_workers);
+    free(g_idle);
+    free(g_jobs);
+}
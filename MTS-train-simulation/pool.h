@@ -0,0 +1,20 @@
+#ifndef POOL_H
+#define POOL_H
+
+/*
+ * A fixed pool of worker threads running train jobs in FIFO order.
+ * A job is a (train, kind) pair handed to the pool's job function; the
+ * queue holds up to `capacity` jobs, which the caller sizes so it never
+ * fills (one pending job per train).
+ *
+ * Idle workers park on their own semaphores. A job goes straight to
+ * one of them and wakes only that one; it is queued only when all the
+ * workers are busy, and they take it before parking again.
+ */
+typedef void (*JobFunc)(int train, int kind);
+
+void poolStart(int workers, int capacity, JobFunc func);
+void poolSubmit(int train, int kind);
+void poolStop();
+
+#endif
@@ -0,0 +1,187 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "ready.h"
+
+// -------------------- heaps --------------------
+
+//readyTime to the tenth of a second: trains that finished loading at
+//the same tick of a real run are a few microseconds apart
+static long readyTenth(const TrainInfo* t)
+{
+    return (long)(t->readyTime * 10.0 + 0.5);
+}
+
+//earliest readyTime first, tie for lower ID
+static int trainBefore(const TrainInfo* trains, int a, int b)
+{
+    if (readyTenth(&trains[a]) != readyTenth(&trains[b])) {
+        return readyTenth(&trains[a]) < readyTenth(&trains[b]);
+    }
+    return trains[a].id < trains[b].id;
+}
+
+static void place(ReadySet* set, TrainHeap* heap, int i, int id)
+{
+    heap->ids[i] = id;
+    set->trains[id].readyIndex = i;
+}
+
+static void siftUp(ReadySet* set, TrainHeap* heap, int i)
+{
+    int id = heap->ids[i];
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!trainBefore(set->trains, id, heap->ids[parent])) {
+            break;
+        }
+        place(set, heap, i, heap->ids[parent]);
+        i = parent;
+    }
+    place(set, heap, i, id);
+}
+
+static void siftDown(ReadySet* set, TrainHeap* heap, int i)
+{
+    int id = heap->ids[i];
+    while (2 * i + 1 < heap->count) {
+        int child = 2 * i + 1;
+        if (child + 1 < heap->count && trainBefore(set->trains, heap->ids[child + 1], heap->ids[child])) {
+            child++;
+        }
+        if (!trainBefore(set->trains, heap->ids[child], id)) {
+            break;
+        }
+        place(set, heap, i, heap->ids[child]);
+        i = child;
+    }
+    place(set, heap, i, id);
+}
+
+static TrainHeap* heapOf(ReadySet* set, int id)
+{
+    TrainInfo* t = &set->trains[id];
+    return &set->heaps[t->priority][t->direction];
+}
+
+void readyInit(ReadySet* set, TrainInfo* trains)
+{
+    set->trains = trains;
+    set->count = 0;
+    for (int p = 0; p < 2; p++) {
+        for (int d = 0; d < 2; d++) {
+            set->heaps[p][d].ids = NULL;
+            set->heaps[p][d].count = 0;
+            set->heaps[p][d].capacity = 0;
+        }
+    }
+}
+
+void readyFree(ReadySet* set)
+{
+    for (int p = 0; p < 2; p++) {
+        for (int d = 0; d < 2; d++) {
+            free(set->heaps[p][d].ids);
+        }
+    }
+}
+
+void readyInsert(ReadySet* set, int id)
+{
+    TrainHeap* heap = heapOf(set, id);
+    if (heap->count == heap->capacity) {
+        heap->capacity = heap->capacity ? 2 * heap->capacity : 16;
+        heap->ids = realloc(heap->ids, heap->capacity * sizeof(int));
+        if (!heap->ids) {
+            fprintf(stderr, "Out of memory for the ready trains.\n");
+            exit(1);
+        }
+    }
+    place(set, heap, heap->count++, id);
+    siftUp(set, heap, heap->count - 1);
+    set->count++;
+}
+
+void readyRemove(ReadySet* set, int id)
+{
+    TrainHeap* heap = heapOf(set, id);
+    int i = set->trains[id].readyIndex;
+    int last = heap->ids[--heap->count];
+
+    set->trains[id].readyIndex = -1;
+    set->count--;
+    if (i == heap->count) {
+        return;
+    }
+    place(set, heap, i, last);
+    siftUp(set, heap, i);
+    siftDown(set, heap, set->trains[last].readyIndex);
+}
+
+//first train of a heap, -1 if empty
+int readyTop(const ReadySet* set, Priority priority, Direction direction)
+{
+    const TrainHeap* heap = &set->heaps[priority][direction];
+    return heap->count > 0 ? heap->ids[0] : -1;
+}
+
+// -------------------- pickNextTrain() --------------------
+
+int pickNextTrain(const ReadySet* set, const TrackState* track)
+{
+    //Check if there's at least one high-priority train
+    int haveHigh = set->heaps[HIGH_PRIORITY][EAST].count + set->heaps[HIGH_PRIORITY][WEST].count > 0;
+    Priority pickPriority = haveHigh ? HIGH_PRIORITY : LOW_PRIORITY;
+
+    //candidates: the earliest train each way with priority = pickPriority
+    int east = readyTop(set, pickPriority, EAST);
+    int west = readyTop(set, pickPriority, WEST);
+    if (east < 0) {
+        return west;
+    }
+    if (west < 0) {
+        return east;
+    }
+    Direction opp = (track->lastDirectionUsed == EAST) ? WEST : EAST;
+
+    //Starvation if starvationLimit consecutive trains in the same
+    //direction, the opposite direction goes.
+    if (track->starvationLimit > 0 && track->consecutiveDirectionCount >= track->starvationLimit) {
+        return (opp == EAST) ? east : west;
+    }
+
+    //Otherwise pick the direction opposite the last used (or West);
+    //in headway mode the last used, so trains can follow each other.
+    if (!track->anyTrainCrossed) {
+        return west;
+    }
+    if (track->keepDirection) {
+        return (opp == EAST) ? west : east;
+    }
+    return (opp == EAST) ? east : west;
+}
+
+void trackInit(TrackState* track, int starvationLimit, int keepDirection)
+{
+    track->anyTrainCrossed = 0;
+    track->lastDirectionUsed = EAST;
+    track->consecutiveDirectionCount = 0;
+    track->starvationLimit = starvationLimit;
+    track->keepDirection = keepDirection;
+}
+
+//a train going `direction` got the main track
+void trackUse(TrackState* track, Direction direction)
+{
+    if (!track->anyTrainCrossed) {
+        track->lastDirectionUsed = direction;
+        track->consecutiveDirectionCount = 1;
+        track->anyTrainCrossed = 1;
+    } else {
+        if (direction == track->lastDirectionUsed) {
+            track->consecutiveDirectionCount++;
+        } else {
+            track->lastDirectionUsed = direction;
+            track->consecutiveDirectionCount = 1;
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef READY_H
+#define READY_H
+
+#include "train.h"
+
+/*
+ * The trains that have finished loading but not yet crossed, in four
+ * min-heaps, one per (priority, direction), each ordered by readyTime
+ * then id. Every scheduling rule then only looks at the heap tops.
+ */
+typedef struct {
+    int*            ids;
+    int             count;
+    int             capacity;
+} TrainHeap;
+
+typedef struct {
+    TrainInfo*      trains;        // indexed by id
+    TrainHeap       heaps[2][2];   // [priority][direction]
+    int             count;
+} ReadySet;
+
+#define DEFAULT_STARVATION_LIMIT 2
+
+//what the direction rules remember of the trains that crossed, and how
+//they are set
+typedef struct {
+    int             anyTrainCrossed;
+    Direction       lastDirectionUsed;
+    int             consecutiveDirectionCount;
+    int             starvationLimit;   // trains in a row one way, 0 => no limit
+    int             keepDirection;     // headway mode: trains follow each other
+} TrackState;
+
+void readyInit(ReadySet* set, TrainInfo* trains);
+void readyFree(ReadySet* set);
+void readyInsert(ReadySet* set, int id);
+void readyRemove(ReadySet* set, int id);
+int  readyTop(const ReadySet* set, Priority priority, Direction direction);
+
+int  pickNextTrain(const ReadySet* set, const TrackState* track);
+void trackInit(TrackState* track, int starvationLimit, int keepDirection);
+void trackUse(TrackState* track, Direction direction);
+
+#endif
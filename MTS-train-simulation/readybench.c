@@ -0,0 +1,234 @@
+/*
+ * readybench: times pickNextTrain() with thousands of trains ready at
+ * once, on the ready heaps against the ready list scan it replaced.
+ *
+ *   readybench [--trains=<n>] [--scan-picks=<n>] [--seed=<n>]
+ *
+ * All trains are ready before the first dispatch, with ready times in
+ * [0, 10) seconds in tenths, so ties are common. Both structures then
+ * dispatch trains until empty (the scan only its first --scan-picks,
+ * the slowest ones, as it is quadratic per pick); their picks must be
+ * the same.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include "ready.h"
+#include "train.h"
+
+static TrainInfo* g_trains;
+static int       g_trainCount;
+
+//ready list and scratch lists of the scan
+static int*      g_readyTrains;
+static int       g_readyCount;
+static int*      g_candidates;
+static int*      g_filtered;
+
+static double nowSec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// -------------------- scanPickNextTrain() --------------------
+//The ready list scan pickNextTrain() used before the heaps.
+
+static int scanPickNextTrain(const TrackState* track)
+{
+    //Check if there's at least one high-priority train
+    int haveHigh = 0;
+    for (int i = 0; i < g_readyCount; i++) {
+        if (g_trains[g_readyTrains[i]].priority == HIGH_PRIORITY) {
+            haveHigh = 1;
+            break;
+        }
+    }
+    Priority pickPriority = haveHigh ? HIGH_PRIORITY : LOW_PRIORITY;
+
+    int* candidate = g_candidates;
+    int ccount = 0;
+    for (int i = 0; i < g_readyCount; i++) {
+        if (g_trains[g_readyTrains[i]].priority == pickPriority) {
+            candidate[ccount++] = g_readyTrains[i];
+        }
+    }
+    if (ccount == 0) {
+        return -1;
+    }
+
+    //Starvation: after 2 back to back, the opposite direction if any
+    if (track->consecutiveDirectionCount >= 2) {
+        Direction opp = (track->lastDirectionUsed == EAST) ? WEST : EAST;
+        int* tmpList = g_filtered;
+        int tmpCount = 0;
+        for (int i = 0; i < ccount; i++) {
+            if (g_trains[candidate[i]].direction == opp) {
+                tmpList[tmpCount++] = candidate[i];
+            }
+        }
+        if (tmpCount > 0) {
+            memcpy(candidate, tmpList, tmpCount * sizeof(int));
+            ccount = tmpCount;
+        }
+    }
+
+    //Both directions: opposite the last used (or West)
+    if (ccount > 1) {
+        int eastCount = 0, westCount = 0;
+        for (int i = 0; i < ccount; i++) {
+            if (g_trains[candidate[i]].direction == EAST) eastCount++;
+            else westCount++;
+        }
+        if (eastCount > 0 && westCount > 0) {
+            Direction desiredDir = !track->anyTrainCrossed ? WEST
+                : (track->lastDirectionUsed == EAST) ? WEST : EAST;
+            int* tmpList = g_filtered;
+            int tmpCount = 0;
+            for (int i = 0; i < ccount; i++) {
+                if (g_trains[candidate[i]].direction == desiredDir) {
+                    tmpList[tmpCount++] = candidate[i];
+                }
+            }
+            memcpy(candidate, tmpList, tmpCount * sizeof(int));
+            ccount = tmpCount;
+        }
+    }
+
+    //Earliest readyTime (tie for lower ID), by the same exchange sort
+    for (int i = 0; i < ccount - 1; i++) {
+        for (int j = i + 1; j < ccount; j++) {
+            TrainInfo* A = &g_trains[candidate[i]];
+            TrainInfo* B = &g_trains[candidate[j]];
+            if (A->readyTime > B->readyTime
+                || (A->readyTime == B->readyTime && A->id > B->id)) {
+                int tmp = candidate[i];
+                candidate[i] = candidate[j];
+                candidate[j] = tmp;
+            }
+        }
+    }
+    return candidate[0];
+}
+
+static void scanRemove(int chosen)
+{
+    for (int i = 0; i < g_readyCount; i++) {
+        if (g_readyTrains[i] == chosen) {
+            memmove(&g_readyTrains[i], &g_readyTrains[i + 1], (g_readyCount - i - 1) * sizeof(int));
+            g_readyCount--;
+            return;
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    static struct option longOptions[] = {
+        { "trains",     required_argument, NULL, 'n' },
+        { "scan-picks", required_argument, NULL, 'p' },
+        { "seed",       required_argument, NULL, 's' },
+        { NULL,         0,                 NULL, 0   }
+    };
+    int scanPicks = 500;
+    unsigned seed = 1;
+    int opt;
+
+    g_trainCount = 4096;
+    while ((opt = getopt_long(argc, argv, "n:p:s:", longOptions, NULL)) != -1) {
+        switch (opt) {
+            case 'n': g_trainCount = atoi(optarg); break;
+            case 'p': scanPicks = atoi(optarg); break;
+            case 's': seed = (unsigned) atoi(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [--trains=<n>] [--scan-picks=<n>] [--seed=<n>]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (g_trainCount < 1) {
+        fprintf(stderr, "--trains must be positive.\n");
+        return 1;
+    }
+    if (scanPicks > g_trainCount) {
+        scanPicks = g_trainCount;
+    }
+
+    g_trains      = malloc(g_trainCount * sizeof(TrainInfo));
+    g_readyTrains = malloc(g_trainCount * sizeof(int));
+    g_candidates  = malloc(g_trainCount * sizeof(int));
+    g_filtered    = malloc(g_trainCount * sizeof(int));
+    int* picks    = malloc(g_trainCount * sizeof(int));
+    if (!g_trains || !g_readyTrains || !g_candidates || !g_filtered || !picks) {
+        fprintf(stderr, "Out of memory.\n");
+        return 1;
+    }
+    srand(seed);
+    for (int i = 0; i < g_trainCount; i++) {
+        TrainInfo* t = &g_trains[i];
+        memset(t, 0, sizeof(*t));
+        t->id = i;
+        t->direction = (rand() & 1) ? EAST : WEST;
+        t->priority = (rand() % 4 == 0) ? HIGH_PRIORITY : LOW_PRIORITY;
+        t->readyTime = (rand() % 100) / 10.0;
+        t->readyIndex = -1;
+    }
+
+    // Heaps
+    ReadySet set;
+    TrackState track;
+    trackInit(&track, DEFAULT_STARVATION_LIMIT, 0);
+    readyInit(&set, g_trains);
+
+    double start = nowSec();
+    for (int i = 0; i < g_trainCount; i++) {
+        readyInsert(&set, i);
+    }
+    double inserted = nowSec();
+    for (int i = 0; i < g_trainCount; i++) {
+        int chosen = pickNextTrain(&set, &track);
+        readyRemove(&set, chosen);
+        trackUse(&track, g_trains[chosen].direction);
+        picks[i] = chosen;
+    }
+    double heapEnd = nowSec();
+    readyFree(&set);
+
+    // Scan
+    TrackState scanTrack;
+    trackInit(&scanTrack, DEFAULT_STARVATION_LIMIT, 0);
+    for (int i = 0; i < g_trainCount; i++) {
+        g_readyTrains[i] = i;
+    }
+    g_readyCount = g_trainCount;
+
+    double scanStart = nowSec();
+    for (int i = 0; i < scanPicks; i++) {
+        int chosen = scanPickNextTrain(&scanTrack);
+        scanRemove(chosen);
+        trackUse(&scanTrack, g_trains[chosen].direction);
+        if (chosen != picks[i]) {
+            fprintf(stderr, "Pick %d differs: heaps %d, scan %d.\n", i, picks[i], chosen);
+            return 1;
+        }
+    }
+    double scanEnd = nowSec();
+
+    printf("trains=%d\n", g_trainCount);
+    printf("heaps: insert %.1f ns/train, dispatch %.1f ns/pick over %d picks\n",
+           (inserted - start) * 1e9 / g_trainCount,
+           (heapEnd - inserted) * 1e9 / g_trainCount, g_trainCount);
+    if (scanPicks > 0) {
+        printf("scan:  dispatch %.1f ns/pick over the first %d picks (same picks)\n",
+               (scanEnd - scanStart) * 1e9 / scanPicks, scanPicks);
+    }
+
+    free(picks);
+    free(g_filtered);
+    free(g_candidates);
+    free(g_readyTrains);
+    free(g_trains);
+    return 0;
+}
@@ -0,0 +1,28 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "stats.h"
+
+static int compareDouble(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+void printDistribution(const char* name, double* values, int n)
+{
+    if (n == 0) {
+        return;
+    }
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) {
+        sum += values[i];
+    }
+    qsort(values, n, sizeof(double), compareDouble);
+
+    fprintf(stderr, "%-19s mean %9.3f  p50 %9.3f  p90 %9.3f  p99 %9.3f  max %9.3f ms\n",
+            name, sum / n * 1e3,
+            values[(int)(0.50 * (n - 1) + 0.5)] * 1e3,
+            values[(int)(0.90 * (n - 1) + 0.5)] * 1e3,
+            values[(int)(0.99 * (n - 1) + 0.5)] * 1e3,
+            values[n - 1] * 1e3);
+}
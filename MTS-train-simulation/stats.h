@@ -0,0 +1,8 @@
+#ifndef STATS_H
+#define STATS_H
+
+//prints the mean and nearest-rank percentiles of `values`, in seconds,
+//as one line in milliseconds on stderr; sorts them
+void printDistribution(const char* name, double* values, int n);
+
+#endif
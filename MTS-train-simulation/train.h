@@ -0,0 +1,46 @@
+#ifndef TRAIN_H
+#define TRAIN_H
+
+#include <stdatomic.h>
+
+typedef enum {
+    LOW_PRIORITY,
+    HIGH_PRIORITY
+} Priority;
+
+typedef enum {
+    EAST,
+    WEST
+} Direction;
+
+/*
+ *   - id:        train number (0-based)
+ *   - direction: E, e or W, w
+ *   - priority:  low priority or high priority
+ *   - loadingTime, crossingTime in tenths of second
+ *   - readyTime: when the train finished loading
+ *   - readyIndex: position in its ready heap while waiting to cross
+ *   - onTime, offTime: when it went ON and came OFF the main track
+ *   - isCrossing: set to 1 by the scheduler when its train's turn
+ *   - doneCrossing: set to 1 by the train when it has finished crossing
+ *   - ahead: in headway mode, the train in front of it on the track
+ *   - onNanos, offDue: in real time, when it went ON and is due OFF
+ */
+typedef struct {
+    int             id;
+    Direction       direction;
+    Priority        priority;
+    int             loadingTime;   // in tenths of a second
+    int             crossingTime;  // in tenths of a second
+    double          readyTime;     // when loading finished
+    int             readyIndex;    // set by the ready set
+    double          onTime;
+    double          offTime;
+    int             isCrossing;    // set by scheduler
+    atomic_int      doneCrossing;  // set by the train once off track
+    int             ahead;         // -1 => none
+    atomic_llong    onNanos;       // 0 => not yet ON
+    atomic_llong    offDue;
+} TrainInfo;
+
+#endif
@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "wheel.h"
+
+static int*      g_slotHead;       // first timer of each slot, -1 => empty
+static int*      g_slotTail;       // last timer of each slot
+static char*     g_slotSorted;     // slot list in due order
+static int       g_slotCount;
+static int*      g_nextTimer;      // per id: next timer in the same slot
+static int*      g_due;            // per id: tick it fires at
+static int       g_pending = 0;
+
+void wheelInit(int slots, int capacity)
+{
+    g_slotHead   = malloc(slots * sizeof(int));
+    g_slotTail   = malloc(slots * sizeof(int));
+    g_slotSorted = malloc(slots);
+    g_nextTimer  = malloc(capacity * sizeof(int));
+    g_due        = malloc(capacity * sizeof(int));
+    g_slotCount  = slots;
+    if (!g_slotHead || !g_slotTail || !g_slotSorted || !g_nextTimer || !g_due) {
+        fprintf(stderr, "Out of memory for the timer wheel.\n");
+        exit(1);
+    }
+    for (int i = 0; i < slots; i++) {
+        g_slotHead[i] = -1;
+        g_slotTail[i] = -1;
+        g_slotSorted[i] = 1;
+    }
+}
+
+//appends to the slot; a timer due before the last one unsorts the slot
+void wheelAdd(int id, int due)
+{
+    int slot = due % g_slotCount;
+    g_due[id] = due;
+    g_nextTimer[id] = -1;
+    if (g_slotHead[slot] < 0) {
+        g_slotHead[slot] = id;
+    } else {
+        if (due < g_due[g_slotTail[slot]]) {
+            g_slotSorted[slot] = 0;
+        }
+        g_nextTimer[g_slotTail[slot]] = id;
+    }
+    g_slotTail[slot] = id;
+    g_pending++;
+}
+
+//stable merge sort by due of the `count` timers from `head`
+static int sortTimers(int head, int count)
+{
+    if (count <= 1) {
+        g_nextTimer[head] = -1;
+        return head;
+    }
+    int half = count / 2;
+    int second = head;
+    for (int i = 0; i < half; i++) {
+        second = g_nextTimer[second];
+    }
+    int a = sortTimers(head, half);
+    int b = sortTimers(second, count - half);
+
+    int first = -1;
+    int* link = &first;
+    while (a >= 0 && b >= 0) {
+        if (g_due[b] < g_due[a]) {
+            *link = b;
+            b = g_nextTimer[b];
+        } else {
+            *link = a;
+            a = g_nextTimer[a];
+        }
+        link = &g_nextTimer[*link];
+    }
+    *link = a >= 0 ? a : b;
+    return first;
+}
+
+static void sortSlot(int slot)
+{
+    int count = 0;
+    for (int id = g_slotHead[slot]; id >= 0; id = g_nextTimer[id]) {
+        count++;
+    }
+    int id = sortTimers(g_slotHead[slot], count);
+    g_slotHead[slot] = id;
+    while (g_nextTimer[id] >= 0) {
+        id = g_nextTimer[id];
+    }
+    g_slotTail[slot] = id;
+    g_slotSorted[slot] = 1;
+}
+
+//fires the timers due at `tick`, in id order for ids added in order;
+//they lead their slot, later turns of the wheel are never looked at
+void wheelExpire(int tick, TimerFunc fire)
+{
+    int slot = tick % g_slotCount;
+    if (g_slotHead[slot] < 0) {
+        return;
+    }
+    if (!g_slotSorted[slot]) {
+        sortSlot(slot);
+    }
+
+    while (g_slotHead[slot] >= 0 && g_due[g_slotHead[slot]] <= tick) {
+        int id = g_slotHead[slot];
+        g_slotHead[slot] = g_nextTimer[id];
+        if (g_slotHead[slot] < 0) {
+            g_slotTail[slot] = -1;
+        }
+        g_pending--;
+        fire(id);
+    }
+}
+
+int wheelPending()
+{
+    return g_pending;
+}
+
+void wheelFree()
+{
+    free(g_slotHead);
+    free(g_slotTail);
+    free(g_slotSorted);
+    free(g_nextTimer);
+    free(g_due);
+}
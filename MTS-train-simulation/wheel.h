@@ -0,0 +1,19 @@
+#ifndef WHEEL_H
+#define WHEEL_H
+
+/*
+ * A hashed timing wheel of per-train timers, in ticks. A timer due at
+ * tick `due` sits in slot `due % slots`, kept in due order; each tick
+ * visits one slot and fires the timers leading it, the others wait for
+ * a later turn of the wheel. Adding and firing a timer are O(1), a slot
+ * filled out of due order is sorted once, on its next visit.
+ */
+typedef void (*TimerFunc)(int id);
+
+void wheelInit(int slots, int capacity);
+void wheelAdd(int id, int due);
+void wheelExpire(int tick, TimerFunc fire);
+int  wheelPending();
+void wheelFree();
+
+#endif
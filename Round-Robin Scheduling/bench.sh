@@ -0,0 +1,88 @@
+#!/bin/sh
+#
+# bench.sh
+#
+# Simulator throughput: runs ./schedule and ./feedbackq on traces made
+# by ./generator and reports simulated ticks and handled instructions
+# (events) per second of wall time, then times ./greenbench, green
+# threads under the MLFQ against pthreads. Run through `make bench`.
+#
+# Environment:
+# 	BENCH_TASKS: tasks in the large traces, run event-driven by
+# 		schedule (default 1000000).
+# 	BENCH_SMALL_TASKS: tasks in the trace for the tick-by-tick runs,
+# 		which print a line per tick (default 100000).
+# 	BENCH_GREEN_TASKS: tasks of the greenbench runs (default
+# 		100000; pthreads may hit the system's thread limit).
+# 	BENCH_DIR: where the traces go (default $TMPDIR or /tmp).
+
+BENCH_TASKS=${BENCH_TASKS:-1000000}
+BENCH_SMALL_TASKS=${BENCH_SMALL_TASKS:-100000}
+BENCH_GREEN_TASKS=${BENCH_GREEN_TASKS:-100000}
+BENCH_DIR=${BENCH_DIR:-${TMPDIR:-/tmp}}
+
+set -e
+
+#
+# now(): wall clock in seconds, with nanoseconds.
+#
+now() {
+    date +%s.%N
+}
+
+#
+# report(): one result line from the program name, trace, event count,
+# tick count and start/end times.
+#
+report() {
+    awk -v name="$1" -v trace="$2" -v events="$3" -v ticks="$4" -v start="$5" -v end="$6" 'BEGIN {
+        secs = end - start
+        if (secs <= 0) secs = 1e-9
+        printf "%-28s %-8s events=%-9d ticks=%-10d time=%7.3fs events/s=%.0f ticks/s=%.0f\n",
+               name, trace, events, ticks, secs, events / secs, ticks / secs
+    }'
+}
+
+#
+# run_summary(): times `schedule --summary`, taking the ticks from the
+# summary.
+#
+run_summary() {
+    label=$1; trace=$2; shift 2
+    file="$BENCH_DIR/bench-$trace.txt"
+    events=$(wc -l < "$file")
+    start=$(now)
+    ticks=$(./schedule --summary "$@" "$file" | sed -n 's/^ticks=\([0-9]*\).*/\1/p')
+    end=$(now)
+    report "$label" "$trace" "$events" "$ticks" "$start" "$end"
+}
+
+#
+# run_text(): times a program printing every tick, taking the ticks
+# from its last line.
+#
+run_text() {
+    label=$1; trace=$2; shift 2
+    file="$BENCH_DIR/bench-$trace.txt"
+    events=$(wc -l < "$file")
+    start=$(now)
+    ticks=$("$@" "$file" | tail -n 1 | sed 's/^\[0*\([0-9]*\)\].*/\1/')
+    end=$(now)
+    report "$label" "$trace" "$events" "$ticks" "$start" "$end"
+}
+
+./generator --tasks="$BENCH_TASKS" --arrivals=poisson > "$BENCH_DIR/bench-poisson.txt"
+./generator --tasks="$BENCH_TASKS" --arrivals=bursty > "$BENCH_DIR/bench-bursty.txt"
+./generator --tasks="$BENCH_SMALL_TASKS" --arrivals=poisson --seed=2 > "$BENCH_DIR/bench-small.txt"
+
+run_summary "schedule -e --summary"       poisson -e
+run_summary "schedule -e --summary"       bursty  -e
+run_summary "schedule -e --summary cfs"   poisson -e --policy=cfs
+run_summary "schedule --summary"          small
+run_text    "schedule"                    small   ./schedule
+run_text    "feedbackq"                   small   ./feedbackq
+
+./greenbench --tasks="$BENCH_GREEN_TASKS" --mode=yield
+./greenbench --tasks="$BENCH_GREEN_TASKS" --mode=check
+
+rm -f "$BENCH_DIR/bench-poisson.txt" "$BENCH_DIR/bench-bursty.txt" "$BENCH_DIR/bench-small.txt"
@@ -0,0 +1,193 @@
+/*
+ * cfs.c
+ *
+ * Completely Fair Scheduler style policy: every task accumulates
+ * virtual runtime at a rate inversely proportional to its weight, and
+ * the task with the least virtual runtime runs next. The weights and
+ * the min_vruntime/sleeper rules follow kernel/sched/fair.c of Linux;
+ * a min-heap stands in for the kernel's red-black tree.
+ */
+
+#include <limits.h>
+#include <stdlib.h>
+#include "policy.h"
+#include "heap.h"
+
+#define NICE_0_WEIGHT       1024
+#define VRUNTIME_SHIFT      10          // 1 tick at nice 0 == 1 << 10
+#define VRUNTIME_UNPLACED   LLONG_MIN   // Task never queued yet
+
+/*
+ * Load weight per nice level -20..19 (sched_prio_to_weight[] in Linux);
+ * each step is roughly 10% CPU.
+ */
+static const int nice_to_weight[40] = {
+    88761, 71755, 56483, 46273, 36291,
+    29154, 23254, 18705, 14949, 11916,
+     9548,  7620,  6100,  4904,  3906,
+     3121,  2501,  1991,  1586,  1277,
+     1024,   820,   655,   526,   423,
+      335,   272,   215,   172,   137,
+      110,    87,    70,    56,    45,
+       36,    29,    23,    18,    15,
+};
+
+typedef struct CfsRq CfsRq_t;
+struct CfsRq {
+    TaskHeap_t              timeline;       // Queued tasks by vruntime
+    long long               min_vruntime;   // Monotonic floor of the queue's vruntimes
+    long long               load;           // Sum of queued weights
+    const SchedConfig_t     *config;
+};
+
+static long long ticks_to_vruntime(int ticks) {
+    return (long long) ticks << VRUNTIME_SHIFT;
+}
+
+/*
+ * Advance min_vruntime to the smaller of `vruntime` and the leftmost
+ * queued task, never moving it backwards.
+ */
+static void update_min_vruntime(CfsRq_t *rq, long long vruntime) {
+    Task_t *leftmost = heap_top(&rq->timeline);
+    if (leftmost != NULL && leftmost->vruntime < vruntime) {
+        vruntime = leftmost->vruntime;
+    }
+    if (vruntime > rq->min_vruntime) {
+        rq->min_vruntime = vruntime;
+    }
+}
+
+static void *cfs_init_rq(const SchedConfig_t *config) {
+    CfsRq_t *rq = (CfsRq_t*) emalloc(sizeof(CfsRq_t));
+    init_heap(&rq->timeline);
+    rq->min_vruntime = 0;
+    rq->load         = 0;
+    rq->config       = config;
+    return rq;
+}
+
+static void cfs_free_rq(void *rq) {
+    free_heap(&((CfsRq_t*) rq)->timeline);
+    deallocate(rq);
+}
+
+static void cfs_init_task(Task_t *t, int nice) {
+    if (nice < -20) nice = -20;
+    if (nice > 19) nice = 19;
+
+    t->weight     = nice_to_weight[nice + 20];
+    t->vruntime   = VRUNTIME_UNPLACED;
+    t->rq_index = -1;
+}
+
+/*
+ * A new task starts at min_vruntime. A task waking up for a new burst
+ * keeps at most `sleeper_bonus` ticks of credit below min_vruntime,
+ * so sleepers get to run soon without monopolising the CPU.
+ */
+static void cfs_enqueue(void *q, Task_t *t, int wakeup) {
+    CfsRq_t *rq = (CfsRq_t*) q;
+
+    if (t->vruntime == VRUNTIME_UNPLACED) {
+        t->vruntime = rq->min_vruntime;
+    } else if (wakeup) {
+        long long floor = rq->min_vruntime - ticks_to_vruntime(rq->config->sleeper_bonus);
+        if (t->vruntime < floor) {
+            t->vruntime = floor;
+        }
+    }
+
+    t->sched_key = t->vruntime;
+    heap_push(&rq->timeline, t);
+    rq->load += t->weight;
+}
+
+static Task_t *cfs_pick_next(void *q) {
+    CfsRq_t *rq = (CfsRq_t*) q;
+    Task_t *t = heap_pop(&rq->timeline);
+    if (t != NULL) {
+        rq->load -= t->weight;
+        update_min_vruntime(rq, t->vruntime);
+    }
+    return t;
+}
+
+static void cfs_remove(void *q, Task_t *t) {
+    CfsRq_t *rq = (CfsRq_t*) q;
+    heap_remove(&rq->timeline, t);
+    rq->load -= t->weight;
+}
+
+static int cfs_nr_queued(void *q) {
+    return ((CfsRq_t*) q)->timeline.size;
+}
+
+/*
+ * The task's share of the scheduling latency, by weight, but never
+ * less than the minimum granularity.
+ */
+static int cfs_time_slice(void *q, Task_t *t) {
+    CfsRq_t *rq = (CfsRq_t*) q;
+    long long total = rq->load + t->weight;
+    int slice = (int) ((long long) rq->config->sched_latency * t->weight / total);
+
+    if (slice < rq->config->min_granularity) {
+        slice = rq->config->min_granularity;
+    }
+    return slice > 0 ? slice : 1;
+}
+
+static void cfs_charge(void *q, Task_t *t, int ticks) {
+    CfsRq_t *rq = (CfsRq_t*) q;
+    t->vruntime += ticks_to_vruntime(ticks) * NICE_0_WEIGHT / t->weight;
+    update_min_vruntime(rq, t->vruntime);
+}
+
+static void cfs_expire(void *q, Task_t *t) {
+    // Nothing to do: the vruntime charged so far decides its place
+}
+
+/*
+ * Wakeup preemption: the woken task runs at once if it is more than
+ * one minimum granularity behind the running task.
+ */
+static int cfs_preempts(void *q, Task_t *curr, Task_t *woken) {
+    CfsRq_t *rq = (CfsRq_t*) q;
+    return curr->vruntime - woken->vruntime > ticks_to_vruntime(rq->config->min_granularity);
+}
+
+/*
+ * Vruntimes only compare within one queue: carry the task's lag
+ * relative to min_vruntime over to the new queue.
+ */
+static void cfs_migrate(void *from, void *to, Task_t *t) {
+    if (t->vruntime != VRUNTIME_UNPLACED) {
+        t->vruntime += ((CfsRq_t*) to)->min_vruntime - ((CfsRq_t*) from)->min_vruntime;
+    }
+}
+
+static int cfs_level(Task_t *t) {
+    return 0;
+}
+
+const SchedClass_t cfs_sched_class = {
+    .name       = "cfs",
+    .init_rq    = cfs_init_rq,
+    .free_rq    = cfs_free_rq,
+    .init_task  = cfs_init_task,
+    .enqueue    = cfs_enqueue,
+    .pick_next  = cfs_pick_next,
+    .remove     = cfs_remove,
+    .nr_queued  = cfs_nr_queued,
+    .time_slice = cfs_time_slice,
+    .charge     = cfs_charge,
+    .expire     = cfs_expire,
+    .preempts   = cfs_preempts,
+    .boost      = NULL,
+    .block      = NULL,
+    .migrate    = cfs_migrate,
+    .level      = cfs_level,
+    .share      = NULL,
+    .queue_lengths = NULL,
+};
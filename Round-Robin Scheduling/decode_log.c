@@ -0,0 +1,123 @@
+/*
+ * decode_log.c
+ *
+ * Turns a binary event log written by `./schedule --log=<file>` back
+ * into the simulator's text output.
+ *
+ * Input: Command Line args
+ * ------------------------
+ * 	./decode_log <log_file>
+ * 	e.g.
+ * 	     ./schedule --log=run.log test1.txt
+ * 	     ./decode_log run.log
+ *
+ * 	`-` reads the log from stdin.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "queue.h"
+#include "event_log.h"
+
+/*
+ * print_stretch():
+ *   Prints the RUN/IDLE/SWITCH records of one stretch (one per CPU) tick by
+ *   tick, CPU after CPU, as the simulator does.
+ */
+void print_stretch(FILE *out, Event_t *group, int size) {
+    for (int i = 0; i < group[0].arg3; i++) {
+        for (int c = 0; c < size; c++) {
+            print_event(out, &group[c], i);
+        }
+    }
+}
+
+/*
+ * copy_text():
+ *   Copies the payload of a TEXT record to the output.
+ */
+void copy_text(FILE *fp, FILE *out, int length) {
+    char chunk[4096];
+
+    while (length > 0) {
+        size_t want = length < (int) sizeof(chunk) ? (size_t) length : sizeof(chunk);
+        if (fread(chunk, 1, want, fp) != want) {
+            fprintf(stderr, "Truncated event log.\n");
+            exit(1);
+        }
+        fwrite(chunk, 1, want, out);
+        length -= (int) want;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <log_file>\n", argv[0]);
+        exit(1);
+    }
+
+    FILE *fp = strcmp(argv[1], "-") == 0 ? stdin : fopen(argv[1], "rb");
+    if (!fp) {
+        fprintf(stderr, "File \"%s\" does not exist.\n", argv[1]);
+        exit(1);
+    }
+
+    char magic[sizeof(EVENT_LOG_MAGIC) - 1];
+    if (fread(magic, 1, sizeof(magic), fp) != sizeof(magic)
+        || memcmp(magic, EVENT_LOG_MAGIC, sizeof(magic)) != 0) {
+        fprintf(stderr, "\"%s\" is not an event log.\n", argv[1]);
+        exit(1);
+    }
+
+    static char stdout_buffer[EVENT_LOG_BUFFER];
+    setvbuf(stdout, stdout_buffer, _IOFBF, sizeof(stdout_buffer));
+
+    // RUN/IDLE/SWITCH records of the stretch being collected
+    int capacity = 64;
+    int size = 0;
+    Event_t *group = (Event_t*) emalloc(capacity * sizeof(Event_t));
+
+    Event_t event;
+    int32_t last_tick = 0;
+    int status;
+    while ((status = read_event(fp, &event, &last_tick)) > 0) {
+        int is_tick = event.type == EVENT_RUN || event.type == EVENT_IDLE
+                      || event.type == EVENT_SWITCH;
+
+        // A stretch ends at the first record that is not part of it
+        if (size > 0 && !(is_tick && event.tick == group[0].tick)) {
+            print_stretch(stdout, group, size);
+            size = 0;
+        }
+
+        if (is_tick) {
+            if (size == capacity) {
+                capacity *= 2;
+                Event_t *bigger = (Event_t*) emalloc(capacity * sizeof(Event_t));
+                memcpy(bigger, group, size * sizeof(Event_t));
+                deallocate(group);
+                group = bigger;
+            }
+            group[size++] = event;
+        } else if (event.type == EVENT_TEXT) {
+            copy_text(fp, stdout, event.arg1);
+        } else {
+            print_event(stdout, &event, 0);
+        }
+    }
+    if (status < 0) {
+        fflush(stdout);
+        fprintf(stderr, "Truncated event log.\n");
+        exit(1);
+    }
+    if (size > 0) {
+        print_stretch(stdout, group, size);
+    }
+
+    deallocate(group);
+    if (fp != stdin) {
+        fclose(fp);
+    }
+    return 0;
+}
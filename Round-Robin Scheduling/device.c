@@ -0,0 +1,175 @@
+/*
+ * device.c
+ *
+ * I/O devices with FIFO or elevator (LOOK) request queues; see
+ * Silberschatz et al., "Operating System Concepts", Section 11.2
+ * (disk scheduling).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "device.h"
+
+static int less(Task_t *a, Task_t *b) {
+    if (a->io_key != b->io_key) {
+        return a->io_key < b->io_key;
+    }
+    return a->io_seq < b->io_seq;
+}
+
+static void place(IoQueue_t *q, int i, Task_t *t) {
+    q->items[i] = t;
+    t->io_index = i;
+}
+
+static void sift_up(IoQueue_t *q, int i) {
+    Task_t *t = q->items[i];
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!less(t, q->items[parent])) {
+            break;
+        }
+        place(q, i, q->items[parent]);
+        i = parent;
+    }
+    place(q, i, t);
+}
+
+static void sift_down(IoQueue_t *q, int i) {
+    Task_t *t = q->items[i];
+    while (2 * i + 1 < q->size) {
+        int child = 2 * i + 1;
+        if (child + 1 < q->size && less(q->items[child + 1], q->items[child])) {
+            child++;
+        }
+        if (!less(q->items[child], t)) {
+            break;
+        }
+        place(q, i, q->items[child]);
+        i = child;
+    }
+    place(q, i, t);
+}
+
+static void io_push(IoQueue_t *q, Task_t *t) {
+    if (q->size == q->capacity) {
+        int capacity = q->capacity ? 2 * q->capacity : 64;
+        Task_t **items = (Task_t**) emalloc(capacity * sizeof(Task_t*));
+        if (q->size > 0) {
+            memcpy(items, q->items, q->size * sizeof(Task_t*));
+        }
+        free(q->items);
+        q->items = items;
+        q->capacity = capacity;
+    }
+    place(q, q->size++, t);
+    sift_up(q, q->size - 1);
+}
+
+static void io_remove_at(IoQueue_t *q, int i) {
+    Task_t *last = q->items[--q->size];
+    if (i < q->size) {
+        place(q, i, last);
+        sift_up(q, i);
+        sift_down(q, last->io_index);
+    }
+}
+
+/*
+ * Initialize an idle device with empty queues, its head at position 0
+ * moving up.
+ */
+Device_t *init_device(int id, IoSched_t sched, int seek_rate) {
+    Device_t *dev = (Device_t*) emalloc(sizeof(Device_t));
+    memset(dev, 0, sizeof(Device_t));
+    dev->id        = id;
+    dev->sched     = sched;
+    dev->seek_rate = seek_rate;
+    dev->direction = 1;
+    dev->current   = NULL;
+    return dev;
+}
+
+/*
+ * Release the device. The tasks belong to the task table.
+ */
+void free_device(Device_t *dev) {
+    free(dev->sweeps[0].items);
+    free(dev->sweeps[1].items);
+    deallocate(dev);
+}
+
+/*
+ * Queue the task's request (`io_length`, `io_position`).
+ */
+void device_submit(Device_t *dev, Task_t *t) {
+    t->io_seq = dev->next_seq++;
+    dev->queued++;
+
+    if (dev->sched == IO_FIFO) {
+        t->io_key = 0;
+        io_push(&dev->sweeps[0], t);
+        return;
+    }
+
+    // Ahead of the head in the current direction: this sweep, else the next
+    int ahead = dev->direction > 0 ? t->io_position >= dev->head : t->io_position <= dev->head;
+    int direction = ahead ? dev->direction : -dev->direction;
+    t->io_key = direction > 0 ? t->io_position : -(long long) t->io_position;
+    io_push(&dev->sweeps[ahead ? dev->sweep : 1 - dev->sweep], t);
+}
+
+/*
+ * Drop the task's request, queued or in service.
+ */
+void device_cancel(Device_t *dev, Task_t *t) {
+    if (dev->current == t) {
+        dev->current = NULL;
+        dev->remaining = 0;
+        return;
+    }
+    for (int i = 0; i < 2; i++) {
+        IoQueue_t *q = &dev->sweeps[i];
+        if (t->io_index < q->size && q->items[t->io_index] == t) {
+            io_remove_at(q, t->io_index);
+            dev->queued--;
+            return;
+        }
+    }
+}
+
+/*
+ * If the device is idle, start serving its next request: the oldest,
+ * or for the elevator the nearest ahead of the head, reversing the
+ * sweep when nothing is left ahead. Returns the task started, or NULL.
+ */
+Task_t *device_start(Device_t *dev) {
+    if (dev->current != NULL || dev->queued == 0) {
+        return NULL;
+    }
+
+    IoQueue_t *q = &dev->sweeps[dev->sweep];
+    if (q->size == 0) {
+        dev->sweep = 1 - dev->sweep;
+        dev->direction = -dev->direction;
+        q = &dev->sweeps[dev->sweep];
+    }
+    Task_t *t = q->items[0];
+    io_remove_at(q, 0);
+    dev->queued--;
+
+    int seek = 0;
+    if (dev->seek_rate > 0) {
+        long long distance = (long long) t->io_position - dev->head;
+        if (distance < 0) {
+            distance = -distance;
+        }
+        seek = (int) ((distance + dev->seek_rate - 1) / dev->seek_rate);
+    }
+
+    dev->head      = t->io_position;
+    dev->current   = t;
+    dev->remaining = seek < INT_MAX - t->io_length ? t->io_length + seek : INT_MAX;
+    return t;
+}
@@ -0,0 +1,58 @@
+#ifndef _DEVICE_H_
+#define _DEVICE_H_
+
+#include "queue.h"
+
+/* Order in which a device serves its queued requests */
+typedef enum {
+    IO_FIFO,            // Arrival order
+    IO_ELEVATOR         // LOOK: sweep across positions, reversing at the last request
+} IoSched_t;
+
+/*
+ * Request queue of a device: a binary min-heap of tasks by `io_key`,
+ * ties broken by arrival (`io_seq`). Each task records its position
+ * in `io_index`, so an exiting task's request can be dropped.
+ */
+typedef struct IoQueue IoQueue_t;
+struct IoQueue {
+    Task_t      **items;
+    int         size;
+    int         capacity;
+};
+
+/*
+ * A simulated I/O device serving one request at a time. A request is
+ * the task's `io_length` ticks of service at `io_position`, plus a
+ * seek of one tick per `seek_rate` positions the head travels (free
+ * if `seek_rate` is 0). The elevator keeps the requests ahead of the
+ * head in the current direction in one queue and the others in the
+ * second, swapping them when the sweep runs out.
+ */
+typedef struct Device Device_t;
+struct Device {
+    int                 id;
+    IoSched_t           sched;
+    int                 seek_rate;
+    IoQueue_t           sweeps[2];
+    int                 sweep;          // Queue of the current sweep
+    int                 direction;      // 1 => rising positions, -1 => falling
+    int                 head;           // Position of the last request served
+    unsigned long long  next_seq;
+    int                 queued;
+
+    Task_t              *current;       // Request in service, NULL => idle
+    int                 remaining;      // Service ticks left
+
+    long long           busy_ticks;
+    int                 served;         // Requests completed
+};
+
+Device_t *init_device(int, IoSched_t, int);
+void free_device(Device_t *);
+
+void device_submit(Device_t *, Task_t *);
+void device_cancel(Device_t *, Task_t *);
+Task_t *device_start(Device_t *);
+
+#endif
@@ -0,0 +1,151 @@
+/*
+ * edf.c
+ *
+ * Earliest Deadline First: the queued task whose burst is due first
+ * runs next, and a waking task with an earlier deadline preempts.
+ * Bursts without a deadline run in the background, first come first
+ * served.
+ *
+ * With budget enforcement each task is served by a constant bandwidth
+ * server (L. Abeni and G. Buttazzo, "Integrating Multimedia
+ * Applications in Hard Real-Time Systems", 1998): it may use `budget`
+ * ticks per `period` at its deadline, and a task overrunning its
+ * budget has its deadline postponed by a period, so it cannot delay
+ * the tasks that keep to theirs.
+ */
+
+#include <limits.h>
+#include <stdlib.h>
+#include "policy.h"
+#include "heap.h"
+
+#define NO_DEADLINE     LLONG_MAX
+
+typedef struct EdfRq EdfRq_t;
+struct EdfRq {
+    TaskHeap_t              deadlines;      // Queued tasks by (server) deadline
+    const SchedConfig_t     *config;
+};
+
+static void *edf_init_rq(const SchedConfig_t *config) {
+    EdfRq_t *rq = (EdfRq_t*) emalloc(sizeof(EdfRq_t));
+    init_heap(&rq->deadlines);
+    rq->config = config;
+    return rq;
+}
+
+static void edf_free_rq(void *rq) {
+    free_heap(&((EdfRq_t*) rq)->deadlines);
+    deallocate(rq);
+}
+
+static void edf_init_task(Task_t *t, int param) {
+    t->sched_key = NO_DEADLINE;
+    t->budget    = 0;
+    t->rq_index  = -1;
+}
+
+/*
+ * A new burst gets the deadline `rel_deadline` ticks after its arrival
+ * and a full budget. Under CBS a server whose deadline is still ahead
+ * keeps it, and its remaining budget, as long as that budget does not
+ * exceed its bandwidth over the time left; otherwise waking up early
+ * would buy it more than its share.
+ */
+static void edf_enqueue(void *q, Task_t *t, int wakeup) {
+    EdfRq_t *rq = (EdfRq_t*) q;
+
+    if (wakeup) {
+        long long now = t->ready_tick;
+
+        if (t->rel_deadline <= 0) {
+            t->sched_key = NO_DEADLINE;
+        } else if (!rq->config->cbs
+                   || t->sched_key == NO_DEADLINE || t->sched_key <= now
+                   || (long long) t->budget * t->period
+                      >= (t->sched_key - now) * t->max_budget) {
+            t->sched_key = now + t->rel_deadline;
+            t->budget    = t->max_budget;
+        }
+    }
+    heap_push(&rq->deadlines, t);
+}
+
+static Task_t *edf_pick_next(void *q) {
+    return heap_pop(&((EdfRq_t*) q)->deadlines);
+}
+
+static void edf_remove(void *q, Task_t *t) {
+    heap_remove(&((EdfRq_t*) q)->deadlines, t);
+}
+
+static int edf_nr_queued(void *q) {
+    return ((EdfRq_t*) q)->deadlines.size;
+}
+
+/*
+ * Runs to completion unless preempted, or under CBS until the budget
+ * runs out.
+ */
+static int edf_time_slice(void *q, Task_t *t) {
+    EdfRq_t *rq = (EdfRq_t*) q;
+
+    if (rq->config->cbs && t->sched_key != NO_DEADLINE
+        && t->budget < t->remaining_burst_time) {
+        return t->budget;
+    }
+    return t->remaining_burst_time;
+}
+
+/*
+ * Under CBS, an exhausted budget is recharged and the deadline
+ * postponed by one period.
+ */
+static void edf_charge(void *q, Task_t *t, int ticks) {
+    EdfRq_t *rq = (EdfRq_t*) q;
+
+    if (!rq->config->cbs || t->sched_key == NO_DEADLINE) {
+        return;
+    }
+    t->budget -= ticks;
+    while (t->budget <= 0) {
+        t->budget    += t->max_budget;
+        t->sched_key += t->period;
+    }
+}
+
+static void edf_expire(void *q, Task_t *t) {
+}
+
+static int edf_preempts(void *q, Task_t *curr, Task_t *woken) {
+    return woken->sched_key < curr->sched_key;
+}
+
+static void edf_migrate(void *from, void *to, Task_t *t) {
+    // Deadlines are absolute: nothing to carry over
+}
+
+static int edf_level(Task_t *t) {
+    return 0;
+}
+
+const SchedClass_t edf_sched_class = {
+    .name       = "edf",
+    .init_rq    = edf_init_rq,
+    .free_rq    = edf_free_rq,
+    .init_task  = edf_init_task,
+    .enqueue    = edf_enqueue,
+    .pick_next  = edf_pick_next,
+    .remove     = edf_remove,
+    .nr_queued  = edf_nr_queued,
+    .time_slice = edf_time_slice,
+    .charge     = edf_charge,
+    .expire     = edf_expire,
+    .preempts   = edf_preempts,
+    .boost      = NULL,
+    .block      = NULL,
+    .migrate    = edf_migrate,
+    .level      = edf_level,
+    .share      = NULL,
+    .queue_lengths = NULL,
+};
@@ -0,0 +1,270 @@
+/*
+ * event_log.c
+ *
+ * Writing the binary event log, and the text format shared by the
+ * simulator and the log decoder.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "event_log.h"
+#include "queue.h"
+
+/*
+ * Longest encoded record: a header and seven fields of up to five
+ * varint bytes each.
+ */
+#define EVENT_RECORD_MAX    40
+#define EVENT_FIELDS        7
+
+static uint32_t zigzag(int32_t v) {
+    return ((uint32_t) v << 1) ^ (uint32_t) -(int32_t) ((uint32_t) v >> 31);
+}
+
+static int32_t unzigzag(uint32_t u) {
+    return (int32_t) ((u >> 1) ^ (uint32_t) -(int32_t) (u & 1));
+}
+
+/*
+ * Stores `v` as a varint at `p`; returns the number of bytes.
+ */
+static size_t put_varint(uint8_t *p, uint32_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t) (v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t) v;
+    return n;
+}
+
+/*
+ * Reads a varint; returns 0 at the end of the file or on an overlong
+ * encoding.
+ */
+static int get_varint(FILE *fp, uint32_t *v) {
+    *v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        int c = getc(fp);
+        if (c == EOF) {
+            return 0;
+        }
+        *v |= (uint32_t) (c & 0x7f) << shift;
+        if (!(c & 0x80)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Write out whatever is buffered.
+ */
+static void flush_event_log(EventLog_t *log) {
+    if (log->used > 0 && fwrite(log->buffer, 1, log->used, log->fp) != log->used) {
+        fprintf(stderr, "Writing the event log failed.\n");
+        exit(1);
+    }
+    log->used = 0;
+}
+
+/*
+ * Append raw bytes to the buffer, flushing it when it fills up.
+ */
+static void log_bytes(EventLog_t *log, const void *data, size_t n) {
+    const char *p = (const char*) data;
+
+    while (n > 0) {
+        if (log->used == EVENT_LOG_BUFFER) {
+            flush_event_log(log);
+        }
+        size_t chunk = EVENT_LOG_BUFFER - log->used;
+        if (chunk > n) {
+            chunk = n;
+        }
+        memcpy(log->buffer + log->used, p, chunk);
+        log->used += chunk;
+        p += chunk;
+        n -= chunk;
+    }
+}
+
+/*
+ * Create the log file (`-` => stdout) and write its header.
+ */
+EventLog_t *open_event_log(const char *path) {
+    EventLog_t *log = (EventLog_t*) emalloc(sizeof(EventLog_t));
+
+    log->fp = strcmp(path, "-") == 0 ? stdout : fopen(path, "wb");
+    if (log->fp == NULL) {
+        fprintf(stderr, "Cannot create event log \"%s\".\n", path);
+        exit(1);
+    }
+    log->buffer = (char*) emalloc(EVENT_LOG_BUFFER);
+    log->used = 0;
+    log->last_tick = 0;
+
+    log_bytes(log, EVENT_LOG_MAGIC, strlen(EVENT_LOG_MAGIC));
+    return log;
+}
+
+/*
+ * Append one event record.
+ */
+void log_event(EventLog_t *log, const Event_t *event) {
+    uint32_t fields[EVENT_FIELDS] = {
+        zigzag(event->tick - log->last_tick),
+        zigzag(event->arg3),
+        zigzag(event->task),
+        zigzag(event->arg1),
+        zigzag(event->arg2),
+        event->queue,
+        (uint32_t) (event->cpu + 1)
+    };
+    uint8_t record[EVENT_RECORD_MAX];
+    uint32_t mask = 0;
+    size_t n = 0;
+
+    for (int i = 0; i < EVENT_FIELDS; i++) {
+        if (fields[i] != 0) {
+            mask |= 1u << i;
+        }
+    }
+    n += put_varint(record, mask << 3 | event->type);
+    for (int i = 0; i < EVENT_FIELDS; i++) {
+        if (fields[i] != 0) {
+            n += put_varint(record + n, fields[i]);
+        }
+    }
+    log->last_tick = event->tick;
+
+    if (log->used + n <= EVENT_LOG_BUFFER) {
+        memcpy(log->buffer + log->used, record, n);
+        log->used += n;
+        return;
+    }
+    log_bytes(log, record, n);
+}
+
+/*
+ * read_event():
+ *   Reads the next record of a log into `event`; `last_tick` carries
+ *   the tick of the previous record (0 before the first). Returns 1
+ *   for a record, 0 at the END record and -1 if the log is cut short
+ *   or corrupt.
+ */
+int read_event(FILE *fp, Event_t *event, int32_t *last_tick) {
+    uint32_t header;
+    uint32_t fields[EVENT_FIELDS] = { 0 };
+
+    if (!get_varint(fp, &header) || (header & 7) > EVENT_END || header >> 3 >= 1u << EVENT_FIELDS) {
+        return -1;
+    }
+    for (int i = 0; i < EVENT_FIELDS; i++) {
+        if ((header >> 3 & 1u << i) && !get_varint(fp, &fields[i])) {
+            return -1;
+        }
+    }
+
+    event->type  = (uint8_t) (header & 7);
+    event->tick  = *last_tick + unzigzag(fields[0]);
+    event->arg3  = unzigzag(fields[1]);
+    event->task  = unzigzag(fields[2]);
+    event->arg1  = unzigzag(fields[3]);
+    event->arg2  = unzigzag(fields[4]);
+    event->queue = (uint16_t) fields[5];
+    event->cpu   = (int16_t) (fields[6] - 1);
+    *last_tick = event->tick;
+
+    return event->type == EVENT_END ? 0 : 1;
+}
+
+/*
+ * Append a TEXT record carrying `n` bytes of preformatted output.
+ */
+void log_text(EventLog_t *log, const char *text, size_t n) {
+    Event_t event;
+    memset(&event, 0, sizeof(event));
+    event.type = EVENT_TEXT;
+    event.tick = log->last_tick;
+    event.arg1 = (int32_t) n;
+    event.cpu  = -1;
+
+    log_event(log, &event);
+    log_bytes(log, text, n);
+}
+
+/*
+ * Mark the log complete with an END record, then flush and close it.
+ */
+void close_event_log(EventLog_t *log) {
+    Event_t event;
+    memset(&event, 0, sizeof(event));
+    event.type = EVENT_END;
+    event.tick = log->last_tick;
+    event.cpu  = -1;
+
+    log_event(log, &event);
+    flush_event_log(log);
+    if (log->fp != stdout) {
+        fclose(log->fp);
+    } else {
+        fflush(stdout);
+    }
+    free(log->buffer);
+    free(log);
+}
+
+/*
+ * Start a tick line, naming the CPU if the event has one.
+ */
+static void print_prefix(FILE *out, int tick, int cpu) {
+    if (cpu >= 0) {
+        fprintf(out, "[%05d] cpu=%02d ", tick, cpu);
+    } else {
+        fprintf(out, "[%05d] ", tick);
+    }
+}
+
+/*
+ * Print the text line of an event. For RUN and IDLE events `offset`
+ * selects the tick within the stretch. TEXT events carry their text
+ * separately and print nothing here.
+ */
+void print_event(FILE *out, const Event_t *event, int offset) {
+    switch (event->type) {
+        case EVENT_NEW:
+            fprintf(out, "[%05d] id=%04d NEW\n", event->tick, event->task);
+            break;
+
+        case EVENT_EXIT:
+            fprintf(out, "[%05d] id=%04d EXIT wt=%d tat=%d",
+                    event->tick, event->task, event->arg1, event->arg2);
+            if (event->arg3 >= 0) {
+                fprintf(out, " mig=%d", event->arg3);
+            }
+            fputc('\n', out);
+            break;
+
+        case EVENT_RUN:
+            print_prefix(out, event->tick + offset, event->cpu);
+            fprintf(out, "id=%04d req=%d used=%d queue=%d\n",
+                    event->task, event->arg1, event->arg2 + offset, event->queue);
+            break;
+
+        case EVENT_IDLE:
+            print_prefix(out, event->tick + offset, event->cpu);
+            fputs("IDLE\n", out);
+            break;
+
+        case EVENT_SWITCH:
+            print_prefix(out, event->tick + offset, event->cpu);
+            fprintf(out, "id=%04d SWITCH\n", event->task);
+            break;
+
+        case EVENT_BOOST:
+            print_prefix(out, event->tick, event->cpu);
+            fputs("BOOST\n", out);
+            break;
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef _EVENT_LOG_H_
+#define _EVENT_LOG_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define EVENT_LOG_MAGIC     "MLFQLOG2"
+#define EVENT_LOG_BUFFER    (1 << 20)
+
+typedef enum {
+    EVENT_NEW,
+    EVENT_EXIT,
+    EVENT_RUN,
+    EVENT_IDLE,
+    EVENT_BOOST,
+    EVENT_TEXT,
+    EVENT_SWITCH,
+    EVENT_END
+} EventType_t;
+
+/*
+ * One simulator output event. RUN, IDLE and SWITCH events cover `count`
+ * consecutive ticks starting at `tick`; the records of all CPUs for
+ * the same stretch are written back to back and printed interleaved
+ * tick by tick.
+ *
+ *   NEW:   task
+ *   EXIT:  task, arg1 = wait time, arg2 = turnaround,
+ *          arg3 = migrations (-1 => not printed)
+ *   RUN:   task, arg1 = burst, arg2 = used after the first tick,
+ *          arg3 = count, queue
+ *   IDLE:  arg3 = count
+ *   SWITCH: task switched to, arg3 = count
+ *   BOOST: (cpu = -1 => one boost for all CPUs)
+ *   TEXT:  arg1 = number of bytes of text following the record
+ *   END:   last record of a complete log
+ *
+ * `cpu` is -1 for lines without a `cpu=` field.
+ *
+ * In the log a record is a header followed by its non-zero fields,
+ * each an unsigned LEB128 varint (7 bits a byte, least significant
+ * group first), so the encoding does not depend on the host. The
+ * header is `mask << 3 | type`, where bit i of `mask` is set if field
+ * i is present, in the order: tick (as the difference from the
+ * previous record's tick), arg3, task, arg1, arg2, queue, cpu + 1.
+ * Signed fields are zigzag-coded (0, -1, 1, -2, ... => 0, 1, 2, 3, ...).
+ */
+typedef struct Event Event_t;
+struct Event {
+    int32_t     tick;
+    int32_t     task;
+    int32_t     arg1;
+    int32_t     arg2;
+    int32_t     arg3;
+    int16_t     cpu;
+    uint16_t    queue;
+    uint8_t     type;
+};
+
+/*
+ * Binary event log written through a large in-memory buffer.
+ */
+typedef struct EventLog EventLog_t;
+struct EventLog {
+    FILE        *fp;
+    char        *buffer;
+    size_t      used;
+    int32_t     last_tick;      // Tick of the last record, for deltas
+};
+
+EventLog_t *open_event_log(const char *);
+void log_event(EventLog_t *, const Event_t *);
+void log_text(EventLog_t *, const char *, size_t);
+void close_event_log(EventLog_t *);
+
+int read_event(FILE *, Event_t *, int32_t *);
+void print_event(FILE *, const Event_t *, int);
+
+#endif
@@ -25,6 +25,8 @@
  * 	2) Special Case:
  * 	     burst_time =  0 -- Task Creation
  * 	     burst_time = -1 -- Task Termination
+ * 	3) A burst for a task whose previous burst is still pending
+ * 		replaces that burst; the task keeps its place.
  * 
  * 
  * Assumptions: (For Multi-Level Feedback Queue)
@@ -35,7 +37,9 @@
  * 	3) Arrival tick, Burst tick and termination tick for the same  
  * 		Task will never overlap. But the arrival/exit of one  
  * 		Task may overlap with another Task.
- * 	4) Tasks will be labelled from 1 to 10.
+ * 	4) Tasks may carry any int id, negative ones included; they
+ * 		are kept in a hashed task table, so only live tasks take up
+ * 		memory.
  * 	5) The event_ticks in the test files will be in sorted order.
  * 	6) Once a Task is assigned a queue, it will always continue to 
  * 		run in that queue for any new future bursts (Unless further 
@@ -60,13 +64,13 @@
 #include <string.h>
 #include <stdbool.h>
 #include "queue.h"
+#include "task_table.h"
 
 
 /* 
  * Some constants related to assignment description.
  */
 #define MAX_INPUT_LINE 100
-#define MAX_TASKS 10
 #define BOOST_INTERVAL 25
 
 /*
@@ -79,8 +83,8 @@ Queue_t *queue_1;
 Queue_t *queue_2;
 Queue_t *queue_3;
 
-/* Global Task Table (up to 10 tasks) */
-Task_t task_table[MAX_TASKS];
+/* Global Task Table (task id -> Task_t) */
+TaskTable_t *task_table;
 
 /* Currently running task + the time slice left for it */
 Task_t *current_task = NULL;
@@ -106,15 +110,7 @@ void initialize_vars() {
     queue_2 = init_queue();
     queue_3 = init_queue();
 
-    for (int i = 0; i < MAX_TASKS; i++) {
-        task_table[i].id                   = 0;  // 0 => "unused"
-        task_table[i].burst_time           = 0;
-        task_table[i].remaining_burst_time = 0;
-        task_table[i].current_queue        = 0;
-        task_table[i].total_wait_time      = 0;
-        task_table[i].total_execution_time = 0;
-        task_table[i].next                 = NULL;
-    }
+    task_table = init_task_table();
 
     current_task      = NULL;
     remaining_quantum = 0;
@@ -149,7 +145,7 @@ void read_instruction(FILE *fp, Instruction_t *instruction) {
     }
 
     instruction->is_eof = false;
-    if (instruction->event_tick < 0 || instruction->task_id < 0) {
+    if (instruction->event_tick < 0) {
         fprintf(stderr, "Incorrect file input.\n");
         exit(1);
     }
@@ -173,42 +169,28 @@ Queue_t *get_queue_by_id(int queue_id) {
 }
 
 /*
- * remove_task_from_queue():
- *   Remove a given Task_t pointer from a queue, if present.
+ * make_ready():
+ *   Queue the task on its current level. Wait time is not counted
+ *   tick by tick; instead the task remembers the tick from which it
+ *   is waiting and the scheduler adds the difference when the task
+ *   is dequeued (or EXIT does, should it leave while queued).
  */
-void remove_task_from_queue(Queue_t *q, Task_t *t) {
-    if (is_empty(q)) return;
-
-    if (q->start == t) {
-        q->start = t->next;
-        if (q->start == NULL) {
-            q->end = NULL;
-        }
-        t->next = NULL;
-        return;
-    }
-
-    Task_t *prev = q->start;
-    while (prev->next && prev->next != t) {
-        prev = prev->next;
-    }
-    if (prev->next == t) {
-        prev->next = t->next;
-        if (prev->next == NULL) {
-            q->end = prev;
-        }
-        t->next = NULL;
-    }
+void make_ready(Task_t *t, int ready_tick) {
+    t->ready_tick = ready_tick;
+    enqueue(get_queue_by_id(t->current_queue), t);
 }
 
 /*
  * remove_task_from_all_queues():
- *   Remove the task from Q1, Q2, Q3 if it appears.
+ *   Remove the task from whichever queue holds it. A task is only
+ *   queued while it has burst left and is not running, and then it
+ *   always sits in the queue matching its `current_queue`.
  */
 void remove_task_from_all_queues(Task_t *t) {
-    remove_task_from_queue(queue_1, t);
-    remove_task_from_queue(queue_2, t);
-    remove_task_from_queue(queue_3, t);
+    if (t == current_task || t->remaining_burst_time <= 0) {
+        return;
+    }
+    remove_from_queue(get_queue_by_id(t->current_queue), t);
 }
 
 /*
@@ -221,7 +203,7 @@ void remove_task_from_all_queues(Task_t *t) {
  *   Called each time a new task arrives with burst_time>0, *before* we enqueue it,
  *   so that the new higher-priority task can run immediately at this tick.
  */
-void preempt_if_higher_priority_arrived(Task_t *new_task) {
+void preempt_if_higher_priority_arrived(Task_t *new_task, int tick) {
     // If no current_task, no preemption needed
     if (current_task == NULL) return;
 
@@ -229,7 +211,7 @@ void preempt_if_higher_priority_arrived(Task_t *new_task) {
     if (new_task->current_queue < current_task->current_queue) {
         // Preempt current_task:
         // 1) Put current_task at back of its queue
-        enqueue(get_queue_by_id(current_task->current_queue), current_task);
+        make_ready(current_task, tick);
         // 2) Clear current_task so scheduler can pick new arrival
         current_task = NULL;
         remaining_quantum = 0;
@@ -258,10 +240,11 @@ void preempt_if_higher_priority_arrived(Task_t *new_task) {
  
 void handle_instruction(Instruction_t *instruction, int tick) {
     int task_id = instruction->task_id;
-    Task_t *t   = &task_table[task_id];
+    Task_t *t;
 
     if (instruction->burst_time == 0) {
         // NEW task
+        t = task_table_insert(task_table, task_id);
         t->id                   = task_id;
         t->burst_time           = 0;
         t->remaining_burst_time = 0;
@@ -271,9 +254,21 @@ void handle_instruction(Instruction_t *instruction, int tick) {
         t->next                 = NULL;
 
         printf("[%05d] id=%04d NEW\n", tick, task_id);
+        return;
+    }
 
-    } else if (instruction->burst_time == -1) {
+    t = task_table_lookup(task_table, task_id);
+    if (t == NULL) {
+        fprintf(stderr, "Instruction for unknown task %d.\n", task_id);
+        exit(1);
+    }
+
+    if (instruction->burst_time == -1) {
         // EXIT
+        if (t != current_task && t->remaining_burst_time > 0) {
+            // Still queued: settle the wait time accrued so far
+            t->total_wait_time += tick - t->ready_tick;
+        }
         int waiting_time     = t->total_wait_time;
         int turn_around_time = t->total_wait_time + t->total_execution_time;
 
@@ -289,30 +284,30 @@ void handle_instruction(Instruction_t *instruction, int tick) {
             remaining_quantum = 0;
         }
 
-        // Zero out the structure
-        t->id = 0;
-        t->burst_time = 0;
-        t->remaining_burst_time = 0;
-        t->current_queue = 0;
-        t->total_wait_time = 0;
-        t->total_execution_time = 0;
-        t->next = NULL;
+        // Hand the record back to the task table
+        task_table_remove(task_table, t);
 
     } else {
         // A CPU burst requirement: new_task needs CPU time
+        int pending = t->remaining_burst_time > 0;
         t->burst_time           = instruction->burst_time;
         t->remaining_burst_time = instruction->burst_time;
 
+        if (pending) {
+            // Still queued or running: the new burst replaces the old one in place
+            return;
+        }
+
         /*
          * (NEW) Preempt if the new task is strictly higher priority
          * than the currently running task. The assignment states
          * no preemption if same priority, but does imply preemption
          * for higher priority.
          */
-        preempt_if_higher_priority_arrived(t);
+        preempt_if_higher_priority_arrived(t, tick);
 
         // Now queue the new CPU burst
-        enqueue(get_queue_by_id(t->current_queue), t);
+        make_ready(t, tick);
     }
 }
 
@@ -394,9 +389,11 @@ void boost(int tick) {
  *  	queues.
  *  b. On Pre-emption of a task by another task, the preempted task 
  *  	is `enqueued` to the end of its associated queue.
+ *
+ *  tick: Clock tick at which the task is picked
  */
 
-void scheduler() {
+void scheduler(int tick) {
     if (current_task != NULL && remaining_quantum > 0) {
         // still have time quantum left, so keep running
         return;
@@ -411,12 +408,13 @@ void scheduler() {
         while (!is_empty(q)) {
             Task_t *front = q->start;
             // If front is invalid, discard it
-            if (front->id == 0 || front->remaining_burst_time <= 0) {
+            if (front->remaining_burst_time <= 0) {
                 dequeue(q);
                 continue;
             }
             // Found a valid candidate
             current_task = dequeue(q);
+            current_task->total_wait_time += tick - current_task->ready_tick;
             remaining_quantum = QUEUE_TIME_QUANTUMS[current_task->current_queue - 1];
             return;
         }
@@ -460,7 +458,7 @@ void execute_task(int tick) {
         } else if (remaining_quantum == 0) {
             // demote + requeue
             decrease_task_level(current_task);
-            enqueue(get_queue_by_id(current_task->current_queue), current_task);
+            make_ready(current_task, tick + 1);
             current_task = NULL;
         }
     } else {
@@ -469,34 +467,13 @@ void execute_task(int tick) {
     }
 }
 
-/*
- * Function: update_task_metrics
- * -----------------------------
- * 	Increments the waiting time/execution time for the tasks 
- * 	that are currently scheduled (In the queue). These values would  
- * 	be later used for the computation of the task waiting time and  
- *	turnaround time.
- */
-
-void update_task_metrics() {
-    for (int i = 0; i < MAX_TASKS; i++) {
-        if (task_table[i].id == 0) continue;  // unused entry
-        if (task_table[i].remaining_burst_time > 0) {
-            // If not current running task => waiting
-            if (!current_task || (current_task->id != task_table[i].id)) {
-                task_table[i].total_wait_time++;
-            }
-        }
-    }
-}
-
 /*
  * main():
  *   The simulation loop:
  *     - read instructions for this tick
  *     - possibly boost
  *     - scheduler picks a task if none or quantum used up
- *     - update wait times
+ *       (and settles its wait time)
  *     - execute current task
  *     - stop if instructions finished, all queues empty, no current task
  */
@@ -537,10 +514,7 @@ int main(int argc, char *argv[]) {
         boost(tick);
 
         // Let scheduler pick a task if needed
-        scheduler();
-
-        // Update wait times for tasks not running
-        update_task_metrics();
+        scheduler(tick);
 
         // Run 1 CPU tick
         execute_task(tick);
@@ -559,6 +533,7 @@ int main(int argc, char *argv[]) {
     deallocate(queue_1);
     deallocate(queue_2);
     deallocate(queue_3);
+    free_task_table(task_table);
 
     return 0;
 }
@@ -0,0 +1,141 @@
+/*
+ * fenwick.c
+ *
+ * Ticket tree for lottery scheduling, after P. M. Fenwick, "A New Data
+ * Structure for Cumulative Frequency Tables" (1994).
+ */
+
+#include <stdlib.h>
+#include "fenwick.h"
+
+static void add(TicketTree_t *tt, int slot, long long delta) {
+    for (int i = slot + 1; i <= tt->capacity; i += i & -i) {
+        tt->tree[i] += delta;
+    }
+}
+
+/*
+ * Doubles the number of slots. The new slots go on the free stack so
+ * that the lowest is handed out first; the sums are rebuilt in O(n).
+ */
+static void grow(TicketTree_t *tt) {
+    int capacity = tt->capacity ? 2 * tt->capacity : 64;
+
+    long long *tree  = (long long*) emalloc((capacity + 1) * sizeof(long long));
+    Task_t **slots   = (Task_t**) emalloc(capacity * sizeof(Task_t*));
+    int *free_slots  = (int*) emalloc(capacity * sizeof(int));
+
+    for (int i = 0; i < capacity; i++) {
+        slots[i] = i < tt->capacity ? tt->slots[i] : NULL;
+    }
+    for (int i = 0; i < tt->num_free; i++) {
+        free_slots[i] = tt->free_slots[i];
+    }
+    int num_free = tt->num_free;
+    for (int i = capacity - 1; i >= tt->capacity; i--) {
+        free_slots[num_free++] = i;
+    }
+
+    // Linear-time build: push each node's sum up to its parent
+    tree[0] = 0;
+    for (int i = 1; i <= capacity; i++) {
+        tree[i] = slots[i - 1] ? slots[i - 1]->weight : 0;
+    }
+    for (int i = 1; i <= capacity; i++) {
+        int parent = i + (i & -i);
+        if (parent <= capacity) {
+            tree[parent] += tree[i];
+        }
+    }
+
+    free(tt->tree);
+    free(tt->slots);
+    free(tt->free_slots);
+    tt->tree       = tree;
+    tt->slots      = slots;
+    tt->free_slots = free_slots;
+    tt->num_free   = num_free;
+    tt->capacity   = capacity;
+}
+
+/*
+ * Initialize an empty tree.
+ */
+void init_ticket_tree(TicketTree_t *tt) {
+    tt->tree       = NULL;
+    tt->slots      = NULL;
+    tt->free_slots = NULL;
+    tt->num_free   = 0;
+    tt->capacity   = 0;
+    tt->size       = 0;
+    tt->total      = 0;
+}
+
+/*
+ * Release the arrays. The tasks belong to the task table.
+ */
+void free_ticket_tree(TicketTree_t *tt) {
+    free(tt->tree);
+    free(tt->slots);
+    free(tt->free_slots);
+    init_ticket_tree(tt);
+}
+
+/*
+ * Adds the task with its `weight` tickets.
+ */
+void ticket_tree_insert(TicketTree_t *tt, Task_t *t) {
+    if (tt->num_free == 0) {
+        grow(tt);
+    }
+    int slot = tt->free_slots[--tt->num_free];
+
+    tt->slots[slot] = t;
+    t->rq_index = slot;
+    add(tt, slot, t->weight);
+    tt->size++;
+    tt->total += t->weight;
+}
+
+/*
+ * Takes the task and its tickets out of the tree.
+ */
+void ticket_tree_remove(TicketTree_t *tt, Task_t *t) {
+    int slot = t->rq_index;
+    if (slot < 0 || slot >= tt->capacity || tt->slots[slot] != t) {
+        return;
+    }
+
+    add(tt, slot, -t->weight);
+    tt->slots[slot] = NULL;
+    tt->free_slots[tt->num_free++] = slot;
+    t->rq_index = -1;
+    tt->size--;
+    tt->total -= t->weight;
+}
+
+/*
+ * Returns the task holding ticket number `ticket` (0 <= ticket <
+ * total), counting the tickets slot by slot: the lowest slot whose
+ * prefix sum exceeds `ticket`. Descends the implicit tree from its
+ * largest power of two in O(log n).
+ */
+Task_t *ticket_tree_find(TicketTree_t *tt, long long ticket) {
+    if (ticket < 0 || ticket >= tt->total) {
+        return NULL;
+    }
+
+    int pos = 0;
+    int step = 1;
+    while (step * 2 <= tt->capacity) {
+        step *= 2;
+    }
+    for (; step > 0; step /= 2) {
+        if (pos + step <= tt->capacity && tt->tree[pos + step] <= ticket) {
+            pos += step;
+            ticket -= tt->tree[pos];
+        }
+    }
+    // pos is the number of slots whose prefix sum is <= ticket
+    return tt->slots[pos];
+}
@@ -0,0 +1,30 @@
+#ifndef _FENWICK_H_
+#define _FENWICK_H_
+
+#include "queue.h"
+
+/*
+ * Fenwick (binary indexed) tree over the tickets of queued tasks, for
+ * lottery scheduling: insert, remove and drawing the winner of a
+ * lottery all take O(log n). Each queued task owns a slot, recorded
+ * in its `rq_index`; freed slots are reused.
+ */
+typedef struct TicketTree TicketTree_t;
+struct TicketTree {
+    long long   *tree;              // 1-based Fenwick sums
+    Task_t      **slots;            // 0-based: task owning each slot
+    int         *free_slots;        // Stack of unused slots
+    int         num_free;
+    int         capacity;
+    int         size;               // Tasks in the tree
+    long long   total;              // Sum of all tickets
+};
+
+void init_ticket_tree(TicketTree_t *);
+void free_ticket_tree(TicketTree_t *);
+
+void ticket_tree_insert(TicketTree_t *, Task_t *);
+void ticket_tree_remove(TicketTree_t *, Task_t *);
+Task_t *ticket_tree_find(TicketTree_t *, long long);
+
+#endif
@@ -0,0 +1,483 @@
+/*
+ * generator.c
+ *
+ * Synthetic workload generator: writes an instruction file (the
+ * format read by `schedule` and `feedbackq`) for any number of tasks,
+ * streaming it in tick order so that millions of tasks take no more
+ * memory than the tasks alive at the same time.
+ *
+ * Usage:
+ * 	./generator [options] > trace.txt
+ * 	./generator --tasks=1000000 --arrivals=bursty | ./schedule --summary -
+ *
+ * 	--tasks=<n>: number of tasks (default `1000`). Task ids run from
+ * 		0 to n - 1.
+ * 	--arrivals=poisson|bursty: arrival process (default `poisson`).
+ * 		poisson: exponential gaps with mean --mean-gap.
+ * 		bursty: tasks arrive in episodes of --burstiness tasks on
+ * 			average, --burstiness times faster than the mean
+ * 			rate, separated by quiet spells; the long-run rate
+ * 			stays one task per --mean-gap ticks.
+ * 	--mean-gap=<ticks>: mean ticks between task arrivals (default
+ * 		`40`).
+ * 	--burstiness=<k>: tasks per bursty episode (default `8`).
+ * 	--interactive=<fraction>: share of interactive tasks (default
+ * 		`0.8`). Interactive tasks issue many short CPU bursts
+ * 		(--bursts on average, exponential lengths of mean
+ * 		--short-burst), each after a think time of mean --think.
+ * 		Batch tasks issue one to a few long bursts with bounded
+ * 		Pareto lengths, back to back.
+ * 	--bursts=<n>: mean number of bursts of an interactive task
+ * 		(default `10`).
+ * 	--short-burst=<ticks>: mean interactive burst (default `2`).
+ * 	--think=<ticks>: mean think time between interactive bursts
+ * 		(default `20`).
+ * 	--alpha=<a>: Pareto shape of the batch bursts (default `1.5`);
+ * 		smaller is heavier tailed.
+ * 	--min-burst=<ticks>, --max-burst=<ticks>: bounds of the batch
+ * 		bursts (defaults `10` and `10000`).
+ * 	--io-length=<ticks>: mean length of an I/O request made by an
+ * 		interactive task after each of its bursts (default `0`:
+ * 		no I/O). The requests go to a random device at a random
+ * 		position, and the think time starts once the I/O could
+ * 		have finished.
+ * 	--io-devices=<n>: devices the requests are spread over
+ * 		(default `1`).
+ * 	--positions=<n>: device positions, for the elevator (default
+ * 		`1000`).
+ * 	--seed=<n>: random seed (default `1`).
+ *
+ * Output: one `<tick>,<task_id>,<burst_time>` line per instruction in
+ * 	tick order. Each task gets a NEW line, its bursts, each no
+ * 	earlier than the previous one could have finished, and an EXIT
+ * 	line one think time after its last burst could have finished. A
+ * 	task that falls behind under load may thus see a new burst
+ * 	replace a pending one, or exit with burst left.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <getopt.h>
+#include "queue.h"
+
+#define OUTPUT_BUFFER (1 << 20)
+
+typedef enum {
+    ARRIVALS_POISSON,
+    ARRIVALS_BURSTY
+} Arrivals_t;
+
+/*
+ * A live task: its next instruction is due at `tick`.
+ */
+typedef struct GenTask GenTask_t;
+struct GenTask {
+    long long           tick;
+    unsigned long long  seq;            // Tie-break: creation order
+    int                 id;
+    int                 interactive;
+    int                 bursts_left;    // Bursts still to issue, 0 => EXIT next
+    int                 io_length;      // I/O request due at `tick`, 0 => none
+    long long           after_io;       // Tick of the instruction after the I/O
+};
+
+/* Settings */
+int num_tasks = 1000;
+Arrivals_t arrivals = ARRIVALS_POISSON;
+double mean_gap = 40.0;
+double burstiness = 8.0;
+double interactive_fraction = 0.8;
+double mean_bursts = 10.0;
+double short_burst = 2.0;
+double think_time = 20.0;
+double alpha = 1.5;
+int min_burst = 10;
+int max_burst = 10000;
+double io_length = 0.0;
+int io_devices = 1;
+int positions = 1000;
+unsigned long long rng = 1;
+
+/* Live tasks, a binary min-heap by (tick, seq) */
+GenTask_t *heap = NULL;
+int heap_count = 0;
+int heap_capacity = 0;
+
+/*
+ * usage():
+ *   Print the command line synopsis and quit.
+ */
+void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--tasks=<n>] [--arrivals=poisson|bursty] "
+                    "[--mean-gap=<ticks>] [--burstiness=<k>] [--interactive=<fraction>] "
+                    "[--bursts=<n>] [--short-burst=<ticks>] [--think=<ticks>] "
+                    "[--alpha=<a>] [--min-burst=<ticks>] [--max-burst=<ticks>] "
+                    "[--io-length=<ticks>] [--io-devices=<n>] [--positions=<n>] "
+                    "[--seed=<n>]\n", prog);
+    exit(1);
+}
+
+/*
+ * parse_count():
+ *   Parses a non-negative integer for the setting `what`.
+ */
+int parse_count(const char *what, const char *value) {
+    char *end;
+    long n = strtol(value, &end, 10);
+    if (end == value || *end != '\0' || n < 0 || n > INT_MAX) {
+        fprintf(stderr, "Invalid %s: %s\n", what, value);
+        exit(1);
+    }
+    return (int) n;
+}
+
+/*
+ * parse_real():
+ *   Parses a number no smaller than `min` for the setting `what`.
+ */
+double parse_real(const char *what, const char *value, double min) {
+    char *end;
+    double x = strtod(value, &end);
+    if (end == value || *end != '\0' || !(x >= min) || isinf(x)) {
+        fprintf(stderr, "Invalid %s: %s\n", what, value);
+        exit(1);
+    }
+    return x;
+}
+
+/*
+ * validate_args():
+ *   Parses the flags; no other arguments are allowed.
+ */
+void validate_args(int argc, char *argv[]) {
+    static const struct option long_options[] = {
+        { "tasks",       required_argument, NULL, 'n' },
+        { "arrivals",    required_argument, NULL, 'a' },
+        { "mean-gap",    required_argument, NULL, 'g' },
+        { "burstiness",  required_argument, NULL, 'k' },
+        { "interactive", required_argument, NULL, 'i' },
+        { "bursts",      required_argument, NULL, 'b' },
+        { "short-burst", required_argument, NULL, 's' },
+        { "think",       required_argument, NULL, 't' },
+        { "alpha",       required_argument, NULL, 'A' },
+        { "min-burst",   required_argument, NULL, 'l' },
+        { "max-burst",   required_argument, NULL, 'h' },
+        { "io-length",   required_argument, NULL, 'o' },
+        { "io-devices",  required_argument, NULL, 'd' },
+        { "positions",   required_argument, NULL, 'p' },
+        { "seed",        required_argument, NULL, 'r' },
+        { NULL,          0,                 NULL,  0  }
+    };
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "n:a:g:k:i:b:s:t:A:l:h:o:d:p:r:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'n':
+                num_tasks = parse_count("number of tasks", optarg);
+                break;
+            case 'a':
+                if (strcmp(optarg, "poisson") == 0) {
+                    arrivals = ARRIVALS_POISSON;
+                } else if (strcmp(optarg, "bursty") == 0) {
+                    arrivals = ARRIVALS_BURSTY;
+                } else {
+                    fprintf(stderr, "Unknown arrival process: %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'g':
+                mean_gap = parse_real("mean gap", optarg, 0.0);
+                break;
+            case 'k':
+                burstiness = parse_real("burstiness", optarg, 1.0);
+                break;
+            case 'i':
+                interactive_fraction = parse_real("interactive fraction", optarg, 0.0);
+                if (interactive_fraction > 1.0) {
+                    fprintf(stderr, "Invalid interactive fraction: %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'b':
+                mean_bursts = parse_real("mean number of bursts", optarg, 1.0);
+                break;
+            case 's':
+                short_burst = parse_real("short burst", optarg, 1.0);
+                break;
+            case 't':
+                think_time = parse_real("think time", optarg, 0.0);
+                break;
+            case 'A':
+                alpha = parse_real("alpha", optarg, 0.01);
+                break;
+            case 'l':
+                min_burst = parse_count("minimum burst", optarg);
+                break;
+            case 'h':
+                max_burst = parse_count("maximum burst", optarg);
+                break;
+            case 'o':
+                io_length = parse_real("I/O length", optarg, 0.0);
+                break;
+            case 'd':
+                io_devices = parse_count("number of I/O devices", optarg);
+                break;
+            case 'p':
+                positions = parse_count("number of positions", optarg);
+                break;
+            case 'r':
+                rng = (unsigned long long) parse_count("seed", optarg);
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    if (optind != argc) {
+        usage(argv[0]);
+    }
+    if (io_devices < 1 || positions < 1) {
+        fprintf(stderr, "Invalid I/O devices or positions.\n");
+        exit(1);
+    }
+    if (min_burst < 1 || max_burst < min_burst) {
+        fprintf(stderr, "Invalid burst bounds: %d-%d\n", min_burst, max_burst);
+        exit(1);
+    }
+    if (rng == 0) {
+        rng = 1;
+    }
+}
+
+/*
+ * next_random():
+ *   xorshift64* (S. Vigna, 2016).
+ */
+unsigned long long next_random() {
+    rng ^= rng >> 12;
+    rng ^= rng << 25;
+    rng ^= rng >> 27;
+    return rng * 0x2545F4914F6CDD1DULL;
+}
+
+/*
+ * uniform():
+ *   Uniform double in (0, 1].
+ */
+double uniform() {
+    return ((next_random() >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+/*
+ * exponential():
+ *   Exponentially distributed double with the given mean.
+ */
+double exponential(double mean) {
+    return -mean * log(uniform());
+}
+
+/*
+ * geometric():
+ *   Count >= 1 with the given mean (geometric distribution).
+ */
+int geometric(double mean) {
+    if (mean <= 1.0) {
+        return 1;
+    }
+    double n = 1.0 + floor(log(uniform()) / log(1.0 - 1.0 / mean));
+    return n < INT_MAX ? (int) n : INT_MAX;
+}
+
+/*
+ * pareto():
+ *   Bounded Pareto integer in [lo, hi] with shape `alpha`, by inverse
+ *   transform.
+ */
+int pareto(int lo, int hi) {
+    if (lo == hi) {
+        return lo;
+    }
+    double l = pow(lo, alpha), h = pow(hi, alpha);
+    double u = uniform();
+    double x = pow((h - u * (h - l)) / (h * l), -1.0 / alpha);
+    return x < hi ? (int) x : hi;
+}
+
+/*
+ * next_arrival_gap():
+ *   Ticks (fractional) until the next task arrives. A bursty episode
+ *   of `burstiness` tasks on average starts after a quiet spell chosen
+ *   so that an episode spans `burstiness * mean_gap` ticks on average.
+ */
+double next_arrival_gap() {
+    static int episode_left = 0;
+
+    if (arrivals == ARRIVALS_POISSON) {
+        return exponential(mean_gap);
+    }
+    if (episode_left > 0) {
+        episode_left--;
+        return exponential(mean_gap / burstiness);
+    }
+    episode_left = geometric(burstiness) - 1;
+    return exponential(burstiness * mean_gap - (burstiness - 1.0) * mean_gap / burstiness);
+}
+
+/*
+ * heap_push():
+ *   Adds a live task to the heap.
+ */
+void heap_push(const GenTask_t *task) {
+    if (heap_count == heap_capacity) {
+        int capacity = heap_capacity ? 2 * heap_capacity : 1024;
+        GenTask_t *grown = (GenTask_t*) emalloc(capacity * sizeof(GenTask_t));
+        if (heap_count > 0) {
+            memcpy(grown, heap, heap_count * sizeof(GenTask_t));
+        }
+        free(heap);
+        heap = grown;
+        heap_capacity = capacity;
+    }
+
+    int i = heap_count++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (heap[parent].tick < task->tick
+            || (heap[parent].tick == task->tick && heap[parent].seq < task->seq)) {
+            break;
+        }
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = *task;
+}
+
+/*
+ * heap_pop():
+ *   Removes the task due first.
+ */
+GenTask_t heap_pop() {
+    GenTask_t top = heap[0];
+    GenTask_t last = heap[--heap_count];
+
+    int i = 0;
+    while (1) {
+        int child = 2 * i + 1;
+        if (child >= heap_count) {
+            break;
+        }
+        if (child + 1 < heap_count
+            && (heap[child + 1].tick < heap[child].tick
+                || (heap[child + 1].tick == heap[child].tick && heap[child + 1].seq < heap[child].seq))) {
+            child++;
+        }
+        if (last.tick < heap[child].tick
+            || (last.tick == heap[child].tick && last.seq < heap[child].seq)) {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+    return top;
+}
+
+/*
+ * emit():
+ *   Writes the first fields of an instruction line; the caller ends
+ *   the line.
+ */
+void emit(long long tick, int task_id, int burst_time) {
+    if (tick > INT_MAX) {
+        fprintf(stderr, "Trace runs past tick %d.\n", INT_MAX);
+        exit(1);
+    }
+    printf("%lld,%d,%d", tick, task_id, burst_time);
+}
+
+/*
+ * issue_next():
+ *   Writes the task's due instruction (a burst, an I/O request or its
+ *   EXIT) and, unless it exited, puts it back due at its next one.
+ */
+void issue_next(GenTask_t *task) {
+    if (task->io_length > 0) {
+        int device = (int) (next_random() % (unsigned long long) io_devices);
+        int position = (int) (next_random() % (unsigned long long) positions);
+        emit(task->tick, task->id, -2);
+        printf(",%d,%d,%d\n", task->io_length, device, position);
+        task->io_length = 0;
+        task->tick = task->after_io;
+        heap_push(task);
+        return;
+    }
+    if (task->bursts_left == 0) {
+        emit(task->tick, task->id, -1);
+        printf("\n");
+        return;
+    }
+
+    int burst = task->interactive ? 1 + (int) exponential(short_burst - 1.0)
+                                  : pareto(min_burst, max_burst);
+    emit(task->tick, task->id, burst);
+    printf("\n");
+    task->bursts_left--;
+
+    // Batch bursts follow each other at once; think time before anything else
+    double gap = task->interactive || task->bursts_left == 0 ? exponential(think_time) : 0.0;
+    if (task->interactive && io_length > 0.0) {
+        // The request follows on the next tick, to be served once the burst is done
+        task->io_length = 1 + (int) exponential(io_length - 1.0 > 0.0 ? io_length - 1.0 : 0.0);
+        task->after_io = task->tick + burst + 1 + task->io_length + (long long) gap;
+        task->tick += 1;
+    } else {
+        task->tick += burst + 1 + (long long) gap;
+    }
+    heap_push(task);
+}
+
+/*
+ * main():
+ *   Merges the arrival stream with the instructions of the live tasks,
+ *   in tick order.
+ */
+int main(int argc, char *argv[]) {
+    validate_args(argc, argv);
+
+    static char stdout_buffer[OUTPUT_BUFFER];
+    setvbuf(stdout, stdout_buffer, _IOFBF, sizeof(stdout_buffer));
+
+    unsigned long long seq = 0;
+    double clock = 0.0;
+    int created = 0;
+    long long next_arrival = 1;
+
+    while (created < num_tasks || heap_count > 0) {
+        if (created < num_tasks && (heap_count == 0 || next_arrival <= heap[0].tick)) {
+            // NEW, then the first burst from the next tick on
+            GenTask_t task;
+            task.id          = created++;
+            task.seq         = seq++;
+            task.tick        = next_arrival + 1;
+            task.interactive = uniform() <= interactive_fraction;
+            task.bursts_left = task.interactive ? geometric(mean_bursts) : geometric(2.0);
+            task.io_length   = 0;
+            emit(next_arrival, task.id, 0);
+            printf("\n");
+            heap_push(&task);
+
+            clock += next_arrival_gap();
+            next_arrival = 1 + (long long) clock;
+            continue;
+        }
+
+        GenTask_t task = heap_pop();
+        issue_next(&task);
+    }
+
+    free(heap);
+    return 0;
+}
@@ -0,0 +1,274 @@
+/*
+ * green.c
+ *
+ * Green threads on ucontext, scheduled by the simulator's MLFQ policy.
+ * A switch goes straight from one thread's context to the next; the
+ * scheduler context in green_run() is only entered when a thread
+ * returns, to free it. swapcontext() saves and restores the signal
+ * mask, a system call per switch, but it also means a SIGALRM tick can
+ * land anywhere: the handler only bumps a counter that the preemption
+ * points read.
+ */
+
+#include <signal.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "green.h"
+#include "mlfq.h"
+
+
+static const SchedClass_t *policy = &mlfq_sched_class;
+static void *rq;                        // Mlfq_t of the ready threads
+static int boost_interval;
+static int tick_usec;                   // 0 => a tick per green_check()
+static size_t stack_size;
+
+static volatile sig_atomic_t timer_ticks;
+static long check_ticks;
+static long next_boost;
+
+static Green_t *current;
+static ucontext_t scheduler_context;
+static GreenStats_t stats;
+static int next_id;
+
+/*
+ * Current tick.
+ */
+static long now(void) {
+    return tick_usec > 0 ? (long) timer_ticks : check_ticks;
+}
+
+static void on_tick(int sig) {
+    timer_ticks++;
+}
+
+/*
+ * Entry point of every thread; returning resumes the scheduler
+ * context (uc_link).
+ */
+static void trampoline(void) {
+    Green_t *g = current;
+    g->func(g->arg);
+    g->done = 1;
+}
+
+/*
+ * Makes `g` the running thread with a fresh slice for its level.
+ */
+static void dispatch(Green_t *g) {
+    current = g;
+    g->slice_start = now();
+    g->slice = policy->time_slice(rq, &g->task);
+}
+
+/*
+ * Boosts all threads to level 1 once the boost tick is reached. The
+ * running thread's slice is cut to the level 1 quantum, as in the
+ * simulator.
+ */
+static void maybe_boost(void) {
+    long tick = now();
+    if (boost_interval <= 0 || tick < next_boost) {
+        return;
+    }
+
+    int used = (int) (tick - current->slice_start);
+    int remaining = current->slice - used;
+    policy->boost(rq, &current->task, &remaining);
+    current->slice = used + remaining;
+    stats.boosts++;
+
+    while (next_boost <= tick) {
+        next_boost += boost_interval;
+    }
+}
+
+/*
+ * The running thread `prev` is queued again: run the thread the policy
+ * picks, which may be `prev` itself.
+ */
+static void switch_from(Green_t *prev) {
+    Green_t *next = (Green_t*) policy->pick_next(rq);
+
+    dispatch(next);
+    if (next != prev) {
+        stats.switches++;
+        swapcontext(&prev->context, &next->context);
+    }
+}
+
+/*
+ * green_init():
+ *   Sets up the runtime. The policy keeps using `config` (levels and
+ *   quanta), which must outlive the runtime. Threads get stacks of
+ *   `stack` bytes.
+ */
+void green_init(const SchedConfig_t *config, int boost, int usec, size_t stack) {
+    rq = policy->init_rq(config);
+    boost_interval = boost;
+    tick_usec = usec;
+    stack_size = stack;
+    timer_ticks = 0;
+    check_ticks = 0;
+    next_boost = boost;
+    current = NULL;
+    next_id = 0;
+    memset(&stats, 0, sizeof(stats));
+
+    if (tick_usec > 0) {
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = on_tick;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGALRM, &action, NULL);
+
+        struct itimerval timer;
+        timer.it_interval.tv_sec = tick_usec / 1000000;
+        timer.it_interval.tv_usec = tick_usec % 1000000;
+        timer.it_value = timer.it_interval;
+        if (setitimer(ITIMER_REAL, &timer, NULL) != 0) {
+            fprintf(stderr, "Cannot start the tick timer.\n");
+            exit(1);
+        }
+    }
+}
+
+/*
+ * green_spawn():
+ *   Creates a thread running `func(arg)` at level 1; it first runs
+ *   when the policy picks it. May be called from a thread. Returns
+ *   the thread id.
+ */
+int green_spawn(GreenFunc_t func, void *arg) {
+    Green_t *g = (Green_t*) emalloc(sizeof(Green_t));
+    memset(g, 0, sizeof(Green_t));
+    g->task.id = next_id++;
+    g->task.rq_index = -1;
+    policy->init_task(&g->task, 0);
+    g->func = func;
+    g->arg = arg;
+    g->stack = emalloc(stack_size);
+
+    if (getcontext(&g->context) != 0) {
+        fprintf(stderr, "getcontext failed.\n");
+        exit(1);
+    }
+    g->context.uc_stack.ss_sp = g->stack;
+    g->context.uc_stack.ss_size = stack_size;
+    g->context.uc_link = &scheduler_context;
+    makecontext(&g->context, trampoline, 0);
+
+    policy->enqueue(rq, &g->task, 1);
+    stats.spawned++;
+    return g->task.id;
+}
+
+/*
+ * green_run():
+ *   Runs threads until none is left. Returns to the caller's context.
+ */
+void green_run(void) {
+    Green_t *next;
+
+    while ((next = (Green_t*) policy->pick_next(rq)) != NULL) {
+        dispatch(next);
+        stats.switches++;
+        swapcontext(&scheduler_context, &next->context);
+
+        // The running thread returned
+        Green_t *done = current;
+        current = NULL;
+        stats.finished++;
+        deallocate(done->stack);
+        deallocate(done);
+    }
+}
+
+/*
+ * green_yield():
+ *   Gives up the CPU: the thread goes to the back of its level, which
+ *   it keeps, and gets a full quantum when it runs again.
+ */
+void green_yield(void) {
+    stats.yields++;
+    maybe_boost();
+    policy->enqueue(rq, &current->task, 0);
+    switch_from(current);
+}
+
+/*
+ * green_check():
+ *   Preemption point. Switches when the slice is used up (demoting
+ *   the thread) or a higher level has a ready thread (the thread goes
+ *   to the back of its level); otherwise returns at once.
+ */
+void green_check(void) {
+    if (tick_usec == 0) {
+        check_ticks++;
+    }
+    maybe_boost();
+
+    Green_t *g = current;
+    if (now() - g->slice_start >= g->slice) {
+        int level = g->task.current_queue;
+        policy->expire(rq, &g->task);
+        stats.expiries++;
+        if (g->task.current_queue > level) {
+            stats.demotions++;
+        }
+    } else {
+        int highest = mlfq_highest_level((Mlfq_t*) rq);
+        if (highest == 0 || highest >= g->task.current_queue) {
+            return;
+        }
+        stats.preemptions++;
+    }
+
+    policy->enqueue(rq, &g->task, 0);
+    switch_from(g);
+}
+
+/*
+ * green_self():
+ *   Id of the running thread, -1 outside threads.
+ */
+int green_self(void) {
+    return current ? current->task.id : -1;
+}
+
+/*
+ * green_level():
+ *   MLFQ level of the running thread, 0 outside threads.
+ */
+int green_level(void) {
+    return current ? current->task.current_queue : 0;
+}
+
+/*
+ * green_stats():
+ *   Counters so far.
+ */
+void green_stats(GreenStats_t *out) {
+    *out = stats;
+    out->ticks = now();
+}
+
+/*
+ * green_shutdown():
+ *   Stops the timer and frees the policy's queues. Threads still
+ *   queued are not freed.
+ */
+void green_shutdown(void) {
+    if (tick_usec > 0) {
+        struct itimerval off;
+        memset(&off, 0, sizeof(off));
+        setitimer(ITIMER_REAL, &off, NULL);
+        signal(SIGALRM, SIG_DFL);
+    }
+    policy->free_rq(rq);
+    rq = NULL;
+}
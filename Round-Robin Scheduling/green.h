@@ -0,0 +1,60 @@
+#ifndef _GREEN_H_
+#define _GREEN_H_
+
+#include <stddef.h>
+#include <ucontext.h>
+#include "queue.h"
+#include "policy.h"
+
+/*
+ * User-space threads scheduled by the MLFQ policy (mlfq_sched_class):
+ * a green thread is a Task_t with its own stack and context. They all
+ * run on the calling OS thread, switching at preemption points:
+ * green_yield() always gives up the CPU, green_check() only once the
+ * thread's quantum is used up, demoting it, or when a thread of a
+ * higher level is ready. Every `boost_interval` ticks all threads go
+ * back to level 1.
+ *
+ * Ticks come from an interval timer (SIGALRM every `tick_usec`), whose
+ * handler only counts them, or, with `tick_usec` 0, from the
+ * preemption points themselves: each green_check() is one tick, which
+ * makes runs deterministic.
+ */
+typedef void (*GreenFunc_t)(void *);
+
+typedef struct Green Green_t;
+struct Green {
+    Task_t      task;               // First: the policy sees the thread as a task
+    ucontext_t  context;
+    void        *stack;
+    GreenFunc_t func;
+    void        *arg;
+    long        slice_start;        // Tick the current slice started
+    int         slice;              // Ticks of the current slice
+    int         done;
+};
+
+typedef struct GreenStats GreenStats_t;
+struct GreenStats {
+    long long   switches;           // Context switches between threads
+    long long   yields;             // green_yield() calls
+    long long   expiries;           // Slices used up
+    long long   demotions;          // Expiries that lowered the level
+    long long   preemptions;        // Switches for a higher level thread
+    long long   boosts;
+    long        ticks;
+    int         spawned;
+    int         finished;
+};
+
+void green_init(const SchedConfig_t *, int, int, size_t);
+int green_spawn(GreenFunc_t, void *);
+void green_run(void);
+void green_yield(void);
+void green_check(void);
+int green_self(void);
+int green_level(void);
+void green_stats(GreenStats_t *);
+void green_shutdown(void);
+
+#endif
@@ -0,0 +1,445 @@
+/*
+ * greenbench.c
+ *
+ * Green threads under the MLFQ (green.c) against one pthread per task:
+ * many lightweight tasks each do --work units of busy work, passing a
+ * preemption point after every unit. Reports the wall time, the
+ * context switches, the cost of a switch and how fairly the CPU was
+ * shared.
+ *
+ * Usage:
+ * 	./greenbench [options]
+ *
+ * 	--tasks=<n>: number of tasks (default `100000`).
+ * 	--work=<n>: units of work per task (default `20`).
+ * 	--unit=<n>: loop iterations per unit (default `200`).
+ * 	--mode=yield|check: preemption point (default `yield`).
+ * 		yield: green_yield() / sched_yield() after every unit,
+ * 			a switch per unit: measures the switch cost.
+ * 		check: green_check(), switching only at the end of the
+ * 			MLFQ quantum, with demotions and boosts; pthreads
+ * 			run unhindered and the kernel preempts them.
+ * 	--runtime=green|pthread|both: what to run (default `both`).
+ * 	--quanta=<q1,q2,...>: MLFQ quanta in ticks (default `2,4,8`).
+ * 	--boost-interval=<ticks>: MLFQ boost period, 0 disables
+ * 		boosting (default `25`).
+ * 	--tick-usec=<n>: green tick length; 0 counts a tick per
+ * 		green_check() (default `0`).
+ * 	--stack=<bytes>: stack of a green thread or pthread (default
+ * 		`16384`, at least PTHREAD_STACK_MIN for pthreads).
+ *
+ * Output: one line per runtime. `switch_ns` is the wall time beyond
+ * 	the same work done in a plain loop, per switch; pthread switches
+ * 	are the process's voluntary and involuntary context switches.
+ * 	`fairness` is Jain's index (1 = even) of the units every task
+ * 	had done when the first task finished. A runtime that cannot
+ * 	create all its tasks (e.g. past the system's thread limit)
+ * 	reports the failure instead.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "green.h"
+
+#define MAX_QUANTA 64
+
+typedef enum {
+    MODE_YIELD,
+    MODE_CHECK
+} Mode_t;
+
+/* Settings */
+int num_tasks = 100000;
+int work = 20;
+int unit = 200;
+Mode_t mode = MODE_YIELD;
+int run_green = 1, run_pthread = 1;
+int quanta[MAX_QUANTA] = { 2, 4, 8 };
+int num_levels = 3;
+int boost_interval = 25;
+int tick_usec = 0;
+size_t stack_size = 16384;
+
+/* Shared by the tasks of a run */
+int *progress;                  // Units done per task
+double *snapshot;               // Progress when the first task finished
+int first_done;
+volatile unsigned long sink;
+
+/* Start gate and abort flag of the pthread run */
+pthread_mutex_t gate_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t gate_open = PTHREAD_COND_INITIALIZER;
+int gate_state;                 // 0 => closed, 1 => go, -1 => abort
+
+/*
+ * usage():
+ *   Print the command line synopsis and quit.
+ */
+void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--tasks=<n>] [--work=<n>] [--unit=<n>] "
+                    "[--mode=yield|check] [--runtime=green|pthread|both] "
+                    "[--quanta=<q1,q2,...>] [--boost-interval=<ticks>] "
+                    "[--tick-usec=<n>] [--stack=<bytes>]\n", prog);
+    exit(1);
+}
+
+/*
+ * parse_count():
+ *   Parses a non-negative integer for the setting `what`.
+ */
+int parse_count(const char *what, const char *value) {
+    char *end;
+    long n = strtol(value, &end, 10);
+    if (end == value || *end != '\0' || n < 0 || n > INT_MAX) {
+        fprintf(stderr, "Invalid %s: %s\n", what, value);
+        exit(1);
+    }
+    return (int) n;
+}
+
+/*
+ * set_quanta():
+ *   Parses a comma-separated list of positive quanta.
+ */
+void set_quanta(const char *list) {
+    const char *p = list;
+    num_levels = 0;
+    for (;;) {
+        char *end;
+        long q = strtol(p, &end, 10);
+        if (end == p || q <= 0 || q > INT_MAX || num_levels == MAX_QUANTA
+            || (*end != ',' && *end != '\0')) {
+            fprintf(stderr, "Invalid quanta list: %s\n", list);
+            exit(1);
+        }
+        quanta[num_levels++] = (int) q;
+        if (*end == '\0') {
+            break;
+        }
+        p = end + 1;
+    }
+}
+
+/*
+ * validate_args():
+ *   Parses the flags; no other arguments are allowed.
+ */
+void validate_args(int argc, char *argv[]) {
+    static const struct option long_options[] = {
+        { "tasks",          required_argument, NULL, 'n' },
+        { "work",           required_argument, NULL, 'w' },
+        { "unit",           required_argument, NULL, 'u' },
+        { "mode",           required_argument, NULL, 'm' },
+        { "runtime",        required_argument, NULL, 'r' },
+        { "quanta",         required_argument, NULL, 'q' },
+        { "boost-interval", required_argument, NULL, 'b' },
+        { "tick-usec",      required_argument, NULL, 't' },
+        { "stack",          required_argument, NULL, 's' },
+        { NULL,             0,                 NULL,  0  }
+    };
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "n:w:u:m:r:q:b:t:s:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'n':
+                num_tasks = parse_count("number of tasks", optarg);
+                break;
+            case 'w':
+                work = parse_count("work", optarg);
+                break;
+            case 'u':
+                unit = parse_count("unit", optarg);
+                break;
+            case 'm':
+                if (strcmp(optarg, "yield") == 0) {
+                    mode = MODE_YIELD;
+                } else if (strcmp(optarg, "check") == 0) {
+                    mode = MODE_CHECK;
+                } else {
+                    fprintf(stderr, "Unknown mode: %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'r':
+                run_green = strcmp(optarg, "green") == 0 || strcmp(optarg, "both") == 0;
+                run_pthread = strcmp(optarg, "pthread") == 0 || strcmp(optarg, "both") == 0;
+                if (!run_green && !run_pthread) {
+                    fprintf(stderr, "Unknown runtime: %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'q':
+                set_quanta(optarg);
+                break;
+            case 'b':
+                boost_interval = parse_count("boost interval", optarg);
+                break;
+            case 't':
+                tick_usec = parse_count("tick length", optarg);
+                break;
+            case 's':
+                stack_size = (size_t) parse_count("stack size", optarg);
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    if (optind != argc || num_tasks < 1 || work < 1) {
+        usage(argv[0]);
+    }
+}
+
+/*
+ * seconds():
+ *   Monotonic clock in seconds.
+ */
+double seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * spin():
+ *   One unit of busy work.
+ */
+void spin(void) {
+    unsigned long x = sink;
+    for (int i = 0; i < unit; i++) {
+        x = x * 6364136223846793005UL + 1442695040888963407UL;
+    }
+    sink = x;
+}
+
+/*
+ * finish():
+ *   The task is done; the first one to finish takes the snapshot.
+ */
+void finish(void) {
+    if (__atomic_exchange_n(&first_done, 1, __ATOMIC_ACQ_REL) == 0) {
+        for (int i = 0; i < num_tasks; i++) {
+            snapshot[i] = __atomic_load_n(&progress[i], __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/*
+ * fairness():
+ *   Jain's index of the snapshot: (sum x)^2 / (n * sum x^2).
+ */
+double fairness(void) {
+    double sum = 0, squares = 0;
+    for (int i = 0; i < num_tasks; i++) {
+        sum += snapshot[i];
+        squares += snapshot[i] * snapshot[i];
+    }
+    return squares > 0 ? sum * sum / (num_tasks * squares) : 1.0;
+}
+
+/*
+ * reset_run():
+ *   Clears the progress of a previous run.
+ */
+void reset_run(void) {
+    memset(progress, 0, num_tasks * sizeof(int));
+    memset(snapshot, 0, num_tasks * sizeof(double));
+    first_done = 0;
+}
+
+/*
+ * baseline():
+ *   Seconds the work of all tasks takes in a plain loop.
+ */
+double baseline(void) {
+    double start = seconds();
+    for (long long i = 0; i < (long long) num_tasks * work; i++) {
+        spin();
+    }
+    return seconds() - start;
+}
+
+/*
+ * report():
+ *   One result line.
+ */
+void report(const char *runtime, double elapsed, double plain, long long switches,
+            const char *extra) {
+    double switch_ns = switches > 0 ? (elapsed - plain) * 1e9 / switches : 0.0;
+    printf("%-7s mode=%s tasks=%d work=%d time=%.3fs switches=%lld switch_ns=%.0f "
+           "fairness=%.4f%s\n",
+           runtime, mode == MODE_YIELD ? "yield" : "check", num_tasks, work, elapsed,
+           switches, switch_ns < 0 ? 0.0 : switch_ns, fairness(), extra);
+}
+
+/*
+ * green_task():
+ *   Body of a green thread; `arg` is its task index.
+ */
+void green_task(void *arg) {
+    int i = (int) (long) arg;
+    for (int u = 0; u < work; u++) {
+        spin();
+        progress[i]++;
+        if (mode == MODE_YIELD) {
+            green_yield();
+        } else {
+            green_check();
+        }
+    }
+    finish();
+}
+
+/*
+ * bench_green():
+ *   Runs the tasks as green threads.
+ */
+void bench_green(double plain) {
+    SchedConfig_t config;
+    memset(&config, 0, sizeof(config));
+    config.num_levels = num_levels;
+    config.quanta = quanta;
+
+    reset_run();
+    green_init(&config, boost_interval, tick_usec, stack_size);
+    for (int i = 0; i < num_tasks; i++) {
+        green_spawn(green_task, (void*) (long) i);
+    }
+
+    double start = seconds();
+    green_run();
+    double elapsed = seconds() - start;
+
+    GreenStats_t stats;
+    green_stats(&stats);
+    green_shutdown();
+
+    char extra[160];
+    snprintf(extra, sizeof(extra), " ticks=%ld expiries=%lld demotions=%lld preemptions=%lld boosts=%lld",
+             stats.ticks, stats.expiries, stats.demotions, stats.preemptions, stats.boosts);
+    report("green", elapsed, plain, stats.switches, extra);
+}
+
+/*
+ * pthread_task():
+ *   Body of a pthread; waits at the gate, then works like green_task().
+ */
+void *pthread_task(void *arg) {
+    int i = (int) (long) arg;
+
+    pthread_mutex_lock(&gate_lock);
+    while (gate_state == 0) {
+        pthread_cond_wait(&gate_open, &gate_lock);
+    }
+    int go = gate_state > 0;
+    pthread_mutex_unlock(&gate_lock);
+    if (!go) {
+        return NULL;
+    }
+
+    for (int u = 0; u < work; u++) {
+        spin();
+        __atomic_store_n(&progress[i], u + 1, __ATOMIC_RELAXED);
+        if (mode == MODE_YIELD) {
+            sched_yield();
+        }
+    }
+    finish();
+    return NULL;
+}
+
+/*
+ * open_gate():
+ *   Releases the waiting threads: `state` 1 to run, -1 to quit.
+ */
+void open_gate(int state) {
+    pthread_mutex_lock(&gate_lock);
+    gate_state = state;
+    pthread_cond_broadcast(&gate_open);
+    pthread_mutex_unlock(&gate_lock);
+}
+
+/*
+ * context_switches():
+ *   Context switches of the process so far.
+ */
+long long context_switches(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (long long) usage.ru_nvcsw + usage.ru_nivcsw;
+}
+
+/*
+ * bench_pthread():
+ *   Runs the tasks as one pthread each, all released at once.
+ */
+void bench_pthread(double plain) {
+    pthread_t *threads = (pthread_t*) emalloc(num_tasks * sizeof(pthread_t));
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, stack_size < PTHREAD_STACK_MIN ? PTHREAD_STACK_MIN : stack_size);
+
+    reset_run();
+    gate_state = 0;
+    int created = 0, error = 0;
+    while (created < num_tasks) {
+        error = pthread_create(&threads[created], &attr, pthread_task, (void*) (long) created);
+        if (error != 0) {
+            break;
+        }
+        created++;
+    }
+
+    double start = seconds();
+    long long switches = context_switches();
+    open_gate(created == num_tasks ? 1 : -1);
+    for (int i = 0; i < created; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double elapsed = seconds() - start;
+    switches = context_switches() - switches;
+
+    pthread_attr_destroy(&attr);
+    deallocate(threads);
+
+    if (created < num_tasks) {
+        printf("pthread mode=%s tasks=%d failed: created=%d (%s)\n",
+               mode == MODE_YIELD ? "yield" : "check", num_tasks, created, strerror(error));
+        return;
+    }
+    report("pthread", elapsed, plain, switches, "");
+}
+
+/*
+ * main():
+ *   Times the plain work, then each runtime.
+ */
+int main(int argc, char *argv[]) {
+    validate_args(argc, argv);
+
+    progress = (int*) emalloc(num_tasks * sizeof(int));
+    snapshot = (double*) emalloc(num_tasks * sizeof(double));
+
+    double plain = baseline();
+    printf("plain   tasks=%d work=%d time=%.3fs\n", num_tasks, work, plain);
+    fflush(stdout);
+    if (run_green) {
+        bench_green(plain);
+        fflush(stdout);
+    }
+    if (run_pthread) {
+        bench_pthread(plain);
+    }
+
+    deallocate(progress);
+    deallocate(snapshot);
+    return 0;
+}
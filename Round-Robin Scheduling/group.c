@@ -0,0 +1,580 @@
+/*
+ * group.c
+ *
+ * Group scheduling: a scheduling class wrapping the task policy, with
+ * a run queue per group and CPU, picked by group virtual runtime. The
+ * group share and bandwidth (quota/period) rules follow the group
+ * scheduling and CFS bandwidth control of kernel/sched/fair.c in
+ * Linux, flattened to a single level of groups.
+ */
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "group.h"
+
+#define VRUNTIME_SHIFT 10               // 1 tick at the default weight == 1 << 10
+
+/*
+ * The group level run queue of a CPU: the entities of all groups on
+ * this CPU, the runnable ones in a min-heap by virtual runtime.
+ */
+struct GroupRq {
+    GroupTable_t    *table;
+    GroupEntity_t   *entities;          // One per group
+    GroupEntity_t   **heap;
+    int             heap_size;
+    unsigned long long next_seq;
+    long long       min_vruntime;       // Monotonic floor for entities that become runnable
+    int             count;              // Tasks queued over all groups
+    GroupEntity_t   *active;            // Entities with queued tasks
+    int             *lengths;           // Scratch for queue_lengths
+    const SchedConfig_t *config;
+};
+
+static int less(GroupEntity_t *a, GroupEntity_t *b) {
+    if (a->vruntime != b->vruntime) {
+        return a->vruntime < b->vruntime;
+    }
+    return a->seq < b->seq;
+}
+
+static void place(GroupRq_t *rq, int i, GroupEntity_t *e) {
+    rq->heap[i] = e;
+    e->heap_index = i;
+}
+
+static void sift_up(GroupRq_t *rq, int i) {
+    GroupEntity_t *e = rq->heap[i];
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!less(e, rq->heap[parent])) {
+            break;
+        }
+        place(rq, i, rq->heap[parent]);
+        i = parent;
+    }
+    place(rq, i, e);
+}
+
+static void sift_down(GroupRq_t *rq, int i) {
+    GroupEntity_t *e = rq->heap[i];
+    while (2 * i + 1 < rq->heap_size) {
+        int child = 2 * i + 1;
+        if (child + 1 < rq->heap_size && less(rq->heap[child + 1], rq->heap[child])) {
+            child++;
+        }
+        if (!less(rq->heap[child], e)) {
+            break;
+        }
+        place(rq, i, rq->heap[child]);
+        i = child;
+    }
+    place(rq, i, e);
+}
+
+/*
+ * Makes the entity runnable on its CPU. An entity that sat idle is
+ * placed no earlier than the CPU's min_vruntime, so it cannot bank
+ * the time it did not use.
+ */
+static void push_entity(GroupRq_t *rq, GroupEntity_t *e) {
+    if (e->vruntime < rq->min_vruntime) {
+        e->vruntime = rq->min_vruntime;
+    }
+    e->seq = rq->next_seq++;
+    rq->heap_size++;
+    place(rq, rq->heap_size - 1, e);
+    sift_up(rq, rq->heap_size - 1);
+}
+
+static void remove_entity(GroupRq_t *rq, GroupEntity_t *e) {
+    int i = e->heap_index;
+    GroupEntity_t *last = rq->heap[--rq->heap_size];
+    e->heap_index = -1;
+    if (i == rq->heap_size) {
+        return;
+    }
+    place(rq, i, last);
+    sift_up(rq, i);
+    sift_down(rq, last->heap_index);
+}
+
+/*
+ * Entity of the task's group on this CPU, with its inner run queue.
+ */
+static GroupEntity_t *entity_of(GroupRq_t *rq, Task_t *t) {
+    GroupEntity_t *e = &rq->entities[t->group];
+    if (e->rq == NULL) {
+        e->rq = rq->table->inner->init_rq(rq->config);
+    }
+    return e;
+}
+
+/*
+ * Keeps the entities with queued tasks in the CPU's active list, so
+ * boosts and queue lengths only visit those.
+ */
+static void add_queued(GroupRq_t *rq, GroupEntity_t *e) {
+    if (e->queued++ > 0) {
+        return;
+    }
+    e->prev_active = NULL;
+    e->next_active = rq->active;
+    if (rq->active) {
+        rq->active->prev_active = e;
+    }
+    rq->active = e;
+}
+
+static void drop_queued(GroupRq_t *rq, GroupEntity_t *e) {
+    if (--e->queued > 0) {
+        return;
+    }
+    if (e->prev_active) {
+        e->prev_active->next_active = e->next_active;
+    } else {
+        rq->active = e->next_active;
+    }
+    if (e->next_active) {
+        e->next_active->prev_active = e->prev_active;
+    }
+}
+
+static int is_throttled(GroupRq_t *rq, GroupEntity_t *e) {
+    return rq->table->groups[e->group].throttled;
+}
+
+/*
+ * The entity gained or lost queued tasks: keep it in the heap exactly
+ * while it has some and its group is not throttled.
+ */
+static void update_entity(GroupRq_t *rq, GroupEntity_t *e) {
+    int runnable = e->queued > 0 && !is_throttled(rq, e);
+    if (runnable && e->heap_index < 0) {
+        push_entity(rq, e);
+    } else if (!runnable && e->heap_index >= 0) {
+        remove_entity(rq, e);
+    }
+}
+
+static void *group_init_rq(const SchedConfig_t *config) {
+    GroupTable_t *table = config->groups;
+    GroupRq_t *rq = (GroupRq_t*) emalloc(sizeof(GroupRq_t));
+
+    rq->table        = table;
+    rq->entities     = (GroupEntity_t*) emalloc(table->num_groups * sizeof(GroupEntity_t));
+    rq->heap         = (GroupEntity_t**) emalloc(table->num_groups * sizeof(GroupEntity_t*));
+    rq->heap_size    = 0;
+    rq->next_seq     = 0;
+    rq->min_vruntime = 0;
+    rq->count        = 0;
+    rq->active       = NULL;
+    rq->lengths      = (int*) emalloc((config->num_levels > 0 ? config->num_levels : 1) * sizeof(int));
+    rq->config       = config;
+    for (int i = 0; i < table->num_groups; i++) {
+        GroupEntity_t *e = &rq->entities[i];
+        e->group      = i;
+        e->rq         = NULL;
+        e->vruntime   = 0;
+        e->seq        = 0;
+        e->heap_index = -1;
+        e->queued     = 0;
+        e->prev_active = NULL;
+        e->next_active = NULL;
+    }
+
+    // Register with the table, which throttles and refills on all CPUs
+    if (table->num_rqs == table->capacity) {
+        table->capacity = table->capacity ? 2 * table->capacity : 8;
+        GroupRq_t **rqs = (GroupRq_t**) emalloc(table->capacity * sizeof(GroupRq_t*));
+        if (table->num_rqs > 0) {
+            memcpy(rqs, table->rqs, table->num_rqs * sizeof(GroupRq_t*));
+            deallocate(table->rqs);
+        }
+        table->rqs = rqs;
+    }
+    table->rqs[table->num_rqs++] = rq;
+    return rq;
+}
+
+static void group_free_rq(void *p) {
+    GroupRq_t *rq = (GroupRq_t*) p;
+    for (int i = 0; i < rq->table->num_groups; i++) {
+        if (rq->entities[i].rq) {
+            rq->table->inner->free_rq(rq->entities[i].rq);
+        }
+    }
+    deallocate(rq->entities);
+    deallocate(rq->heap);
+    deallocate(rq->lengths);
+    deallocate(rq);
+}
+
+static const SchedClass_t *inner_of(void *rq) {
+    return ((GroupRq_t*) rq)->table->inner;
+}
+
+static void group_enqueue(void *p, Task_t *t, int wakeup) {
+    GroupRq_t *rq = (GroupRq_t*) p;
+    GroupEntity_t *e = entity_of(rq, t);
+
+    rq->table->inner->enqueue(e->rq, t, wakeup);
+    add_queued(rq, e);
+    rq->count++;
+    update_entity(rq, e);
+}
+
+static Task_t *group_pick_next(void *p) {
+    GroupRq_t *rq = (GroupRq_t*) p;
+    if (rq->heap_size == 0) {
+        return NULL;
+    }
+
+    GroupEntity_t *e = rq->heap[0];
+    Task_t *t = rq->table->inner->pick_next(e->rq);
+    drop_queued(rq, e);
+    rq->count--;
+    if (e->vruntime > rq->min_vruntime) {
+        rq->min_vruntime = e->vruntime;
+    }
+    update_entity(rq, e);
+    return t;
+}
+
+static void group_remove(void *p, Task_t *t) {
+    GroupRq_t *rq = (GroupRq_t*) p;
+    GroupEntity_t *e = entity_of(rq, t);
+
+    rq->table->inner->remove(e->rq, t);
+    drop_queued(rq, e);
+    rq->count--;
+    update_entity(rq, e);
+}
+
+static int group_nr_queued(void *rq) {
+    return ((GroupRq_t*) rq)->count;
+}
+
+static int group_time_slice(void *p, Task_t *t) {
+    GroupRq_t *rq = (GroupRq_t*) p;
+    return rq->table->inner->time_slice(entity_of(rq, t)->rq, t);
+}
+
+/*
+ * Charges the task and its group's entity on this CPU. The virtual
+ * runtime per tick is rounded once, so charging a stretch at once or
+ * tick by tick comes to the same.
+ */
+static void group_charge(void *p, Task_t *t, int ticks) {
+    GroupRq_t *rq = (GroupRq_t*) p;
+    GroupEntity_t *e = entity_of(rq, t);
+    int weight = rq->table->groups[t->group].spec.weight;
+
+    rq->table->inner->charge(e->rq, t, ticks);
+    e->vruntime += ticks * (((long long) GROUP_DEFAULT_WEIGHT << VRUNTIME_SHIFT) / weight);
+    if (e->heap_index >= 0) {
+        sift_down(rq, e->heap_index);
+    }
+}
+
+static void group_expire(void *p, Task_t *t) {
+    GroupRq_t *rq = (GroupRq_t*) p;
+    rq->table->inner->expire(entity_of(rq, t)->rq, t);
+}
+
+/*
+ * Only a task of the running task's group may preempt it, as its
+ * policy decides; groups take turns at slice ends.
+ */
+static int group_preempts(void *p, Task_t *curr, Task_t *woken) {
+    GroupRq_t *rq = (GroupRq_t*) p;
+    if (curr->group != woken->group) {
+        return 0;
+    }
+    return rq->table->inner->preempts(entity_of(rq, curr)->rq, curr, woken);
+}
+
+/*
+ * Boosts the run queues of the groups with queued tasks on this CPU,
+ * and that of the running task's group, which alone is passed the
+ * running task. Empty run queues have nothing to boost.
+ */
+static void group_boost(void *p, Task_t *curr, int *remaining_quantum) {
+    GroupRq_t *rq = (GroupRq_t*) p;
+    GroupEntity_t *own = curr ? entity_of(rq, curr) : NULL;
+
+    for (GroupEntity_t *e = rq->active; e != NULL; e = e->next_active) {
+        rq->table->inner->boost(e->rq, e == own ? curr : NULL, remaining_quantum);
+    }
+    if (own != NULL && own->queued == 0) {
+        rq->table->inner->boost(own->rq, curr, remaining_quantum);
+    }
+}
+
+static void group_block(void *p, Task_t *t) {
+    GroupRq_t *rq = (GroupRq_t*) p;
+    rq->table->inner->block(entity_of(rq, t)->rq, t);
+}
+
+static void group_migrate(void *from, void *to, Task_t *t) {
+    inner_of(from)->migrate(entity_of((GroupRq_t*) from, t)->rq,
+                            entity_of((GroupRq_t*) to, t)->rq, t);
+}
+
+static int group_share(void *p, Task_t *t, double *achieved, double *target) {
+    GroupRq_t *rq = (GroupRq_t*) p;
+    return rq->table->inner->share(entity_of(rq, t)->rq, t, achieved, target);
+}
+
+/*
+ * Queued tasks per level, summed over the groups.
+ */
+static int group_queue_lengths(void *p, int *lengths) {
+    GroupRq_t *rq = (GroupRq_t*) p;
+    int levels = rq->config->num_levels;
+
+    memset(lengths, 0, levels * sizeof(int));
+    for (GroupEntity_t *e = rq->active; e != NULL; e = e->next_active) {
+        rq->table->inner->queue_lengths(e->rq, rq->lengths);
+        for (int i = 0; i < levels; i++) {
+            lengths[i] += rq->lengths[i];
+        }
+    }
+    return levels;
+}
+
+/*
+ * init_group_class():
+ *   Fills `cls` with the group class over the task policy `inner`,
+ *   leaving out the hooks `inner` lacks. init_task and level do not
+ *   involve a run queue and are those of `inner`.
+ */
+void init_group_class(SchedClass_t *cls, const SchedClass_t *inner) {
+    memset(cls, 0, sizeof(SchedClass_t));
+    cls->name          = inner->name;
+    cls->init_rq       = group_init_rq;
+    cls->free_rq       = group_free_rq;
+    cls->init_task     = inner->init_task;
+    cls->enqueue       = group_enqueue;
+    cls->pick_next     = group_pick_next;
+    cls->remove        = group_remove;
+    cls->nr_queued     = group_nr_queued;
+    cls->time_slice    = group_time_slice;
+    cls->charge        = group_charge;
+    cls->expire        = group_expire;
+    cls->preempts      = group_preempts;
+    cls->boost         = inner->boost ? group_boost : NULL;
+    cls->block         = inner->block ? group_block : NULL;
+    cls->migrate       = group_migrate;
+    cls->level         = inner->level;
+    cls->share         = inner->share ? group_share : NULL;
+    cls->queue_lengths = inner->queue_lengths ? group_queue_lengths : NULL;
+}
+
+/*
+ * Refill heap: the throttled groups by next_refill.
+ */
+static void refill_place(GroupTable_t *table, int i, Group_t *g) {
+    table->refills[i] = g;
+    g->refill_index = i;
+}
+
+static void refill_sift_up(GroupTable_t *table, int i) {
+    Group_t *g = table->refills[i];
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (table->refills[parent]->next_refill <= g->next_refill) {
+            break;
+        }
+        refill_place(table, i, table->refills[parent]);
+        i = parent;
+    }
+    refill_place(table, i, g);
+}
+
+static void refill_sift_down(GroupTable_t *table, int i) {
+    Group_t *g = table->refills[i];
+    while (2 * i + 1 < table->num_refills) {
+        int child = 2 * i + 1;
+        if (child + 1 < table->num_refills
+            && table->refills[child + 1]->next_refill < table->refills[child]->next_refill) {
+            child++;
+        }
+        if (table->refills[child]->next_refill >= g->next_refill) {
+            break;
+        }
+        refill_place(table, i, table->refills[child]);
+        i = child;
+    }
+    refill_place(table, i, g);
+}
+
+/*
+ * Starts the periods of a quota group that began by `tick`: each adds
+ * the quota, paying off any overrun, but unused quota is not saved
+ * up. Periods start at tick 1; a group's quota is only brought up to
+ * date when it is used or throttled, not at every period.
+ */
+static void roll_periods(Group_t *g, int tick) {
+    if (g->spec.quota == 0 || tick < g->next_refill) {
+        return;
+    }
+    long long periods = (tick - g->next_refill) / g->spec.period + 1;
+    long long left = g->quota_left + periods * g->spec.quota;
+    long long next = g->next_refill + periods * g->spec.period;
+
+    g->quota_left = left > g->spec.quota ? g->spec.quota : (int) left;
+    g->next_refill = next > INT_MAX ? INT_MAX : (int) next;
+}
+
+/*
+ * Makes the group's entities runnable, or not, on every CPU.
+ */
+static void update_group(GroupTable_t *table, int group) {
+    for (int i = 0; i < table->num_rqs; i++) {
+        update_entity(table->rqs[i], &table->rqs[i]->entities[group]);
+    }
+}
+
+/*
+ * init_group_table():
+ *   State of `count` groups for one run, over the task policy `inner`.
+ */
+GroupTable_t *init_group_table(const GroupSpec_t *specs, int count, const SchedClass_t *inner) {
+    GroupTable_t *table = (GroupTable_t*) emalloc(sizeof(GroupTable_t));
+    table->num_groups  = count;
+    table->groups      = (Group_t*) emalloc(count * sizeof(Group_t));
+    table->inner       = inner;
+    table->rqs         = NULL;
+    table->num_rqs     = 0;
+    table->capacity    = 0;
+    table->refills     = (Group_t**) emalloc(count * sizeof(Group_t*));
+    table->num_refills = 0;
+
+    for (int i = 0; i < count; i++) {
+        Group_t *g = &table->groups[i];
+        g->spec            = specs[i];
+        g->quota_left      = specs[i].quota;
+        g->next_refill     = specs[i].quota > 0 ? 1 + specs[i].period : INT_MAX;
+        g->refill_index    = -1;
+        g->throttled       = 0;
+        g->throttled_at    = 0;
+        g->throttles       = 0;
+        g->throttled_ticks = 0;
+        g->used_ticks      = 0;
+    }
+    return table;
+}
+
+/*
+ * free_group_table():
+ *   Frees the table; the run queues are freed by their class.
+ */
+void free_group_table(GroupTable_t *table) {
+    deallocate(table->groups);
+    deallocate(table->refills);
+    if (table->rqs) {
+        deallocate(table->rqs);
+    }
+    deallocate(table);
+}
+
+/*
+ * group_next_refill():
+ *   First tick a throttled group starts a new period (INT_MAX if none).
+ */
+int group_next_refill(GroupTable_t *table) {
+    return table->num_refills > 0 ? table->refills[0]->next_refill : INT_MAX;
+}
+
+/*
+ * group_refill():
+ *   Starts the new periods of the throttled groups due by `tick`. A
+ *   group with quota again becomes runnable on every CPU; one still
+ *   paying off an overrun waits for its next period.
+ */
+void group_refill(GroupTable_t *table, int tick) {
+    while (table->num_refills > 0 && table->refills[0]->next_refill <= tick) {
+        Group_t *g = table->refills[0];
+
+        roll_periods(g, tick);
+        if (g->quota_left <= 0) {
+            refill_sift_down(table, 0);
+            continue;
+        }
+
+        Group_t *last = table->refills[--table->num_refills];
+        if (table->num_refills > 0) {
+            refill_place(table, 0, last);
+            refill_sift_down(table, 0);
+        }
+        g->refill_index = -1;
+        g->throttled = 0;
+        g->throttled_ticks += tick - g->throttled_at;
+        update_group(table, (int) (g - table->groups));
+    }
+}
+
+/*
+ * group_account():
+ *   The group's tasks ran `ticks` CPU ticks in all from tick `first`
+ *   on, within one period. Returns 1 if that used up its quota: the
+ *   group is then throttled from the next tick, taken off every CPU's
+ *   heap, and the caller must take its running tasks off the CPUs.
+ */
+int group_account(GroupTable_t *table, int group, int first, int ticks) {
+    Group_t *g = &table->groups[group];
+
+    g->used_ticks += ticks;
+    if (g->spec.quota == 0) {
+        return 0;
+    }
+    roll_periods(g, first);
+    g->quota_left -= ticks;
+    if (g->quota_left > 0 || g->throttled) {
+        return 0;
+    }
+
+    g->throttled = 1;
+    g->throttled_at = first + ticks;
+    g->throttles++;
+    refill_place(table, table->num_refills++, g);
+    refill_sift_up(table, table->num_refills - 1);
+    update_group(table, group);
+    return 1;
+}
+
+/*
+ * group_quota_ticks():
+ *   Ticks from `tick` on that `running` tasks of the group can run
+ *   before it uses up its quota or its period ends (INT_MAX if it has
+ *   no quota).
+ */
+int group_quota_ticks(GroupTable_t *table, int group, int tick, int running) {
+    Group_t *g = &table->groups[group];
+    if (g->spec.quota == 0) {
+        return INT_MAX;
+    }
+
+    roll_periods(g, tick);
+    int ticks = (g->quota_left + running - 1) / running;
+    if (g->next_refill - tick < ticks) {
+        ticks = g->next_refill - tick;
+    }
+    return ticks;
+}
+
+/*
+ * group_finish():
+ *   Closes the throttle periods still open after tick `last`.
+ */
+void group_finish(GroupTable_t *table, int last) {
+    for (int i = 0; i < table->num_groups; i++) {
+        Group_t *g = &table->groups[i];
+        if (g->throttled && last + 1 > g->throttled_at) {
+            g->throttled_ticks += last + 1 - g->throttled_at;
+            g->throttled_at = last + 1;
+        }
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef _GROUP_H_
+#define _GROUP_H_
+
+#include "queue.h"
+#include "policy.h"
+
+/*
+ * Task groups (in the manner of Linux cgroups' cpu controller): each
+ * group gets a share of the CPU time in proportion to its weight, and
+ * may be limited to `quota` ticks of CPU time per `period` ticks over
+ * all CPUs, after which it is throttled until its next period.
+ *
+ * Scheduling is hierarchical. Every CPU keeps, per group, a run queue
+ * of the task policy (the `inner` class) and a group virtual runtime
+ * that grows by the ticks the group's tasks run, scaled by 1024 /
+ * weight. The CPU runs the group with the least virtual runtime, in
+ * a heap of the groups that have queued tasks and are not throttled,
+ * and within it the task the inner policy picks.
+ */
+#define GROUP_DEFAULT_WEIGHT 1024
+#define GROUP_MAX_WEIGHT     262144
+
+/* A group as configured */
+typedef struct GroupSpec GroupSpec_t;
+struct GroupSpec {
+    int         weight;
+    int         quota;              // Ticks per period, 0 => unlimited
+    int         period;
+};
+
+typedef struct GroupRq GroupRq_t;
+
+/* A group on one CPU */
+typedef struct GroupEntity GroupEntity_t;
+struct GroupEntity {
+    int             group;
+    void            *rq;            // Inner run queue, NULL until first used
+    long long       vruntime;
+    unsigned long long seq;         // Heap tie-break
+    int             heap_index;     // -1 => not in the CPU's heap
+    int             queued;         // Tasks in `rq`
+    GroupEntity_t   *prev_active;   // Entities with queued tasks
+    GroupEntity_t   *next_active;
+};
+
+typedef struct Group Group_t;
+struct Group {
+    GroupSpec_t     spec;
+    int             quota_left;     // This period; negative => overrun, paid next period
+    int             next_refill;    // Tick of the next period, for quota groups
+    int             refill_index;   // Position in the refill heap while throttled
+    int             throttled;
+    int             throttled_at;   // Tick the current throttle started
+    int             throttles;
+    long long       throttled_ticks;
+    long long       used_ticks;     // CPU ticks of its tasks
+};
+
+/*
+ * Per-run state of all groups, shared by the CPUs' run queues.
+ */
+struct GroupTable {
+    int             num_groups;
+    Group_t         *groups;
+    const SchedClass_t *inner;
+    GroupRq_t       **rqs;          // One per CPU, in creation order
+    int             num_rqs;
+    int             capacity;
+    Group_t         **refills;      // Throttled groups by next_refill (min-heap)
+    int             num_refills;
+};
+
+GroupTable_t *init_group_table(const GroupSpec_t *, int, const SchedClass_t *);
+void free_group_table(GroupTable_t *);
+void init_group_class(SchedClass_t *, const SchedClass_t *);
+
+int group_next_refill(GroupTable_t *);
+void group_refill(GroupTable_t *, int);
+int group_account(GroupTable_t *, int, int, int);
+int group_quota_ticks(GroupTable_t *, int, int, int);
+void group_finish(GroupTable_t *, int);
+
+#endif
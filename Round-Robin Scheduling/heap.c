@@ -0,0 +1,127 @@
+/*
+ * heap.c
+ *
+ * Indexed binary heap, after Sedgewick & Wayne, "Algorithms", 4th
+ * ed., Section 2.4 (index priority queue).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "heap.h"
+
+static int less(Task_t *a, Task_t *b) {
+    if (a->sched_key != b->sched_key) {
+        return a->sched_key < b->sched_key;
+    }
+    return a->heap_seq < b->heap_seq;
+}
+
+static void place(TaskHeap_t *h, int i, Task_t *t) {
+    h->items[i] = t;
+    t->rq_index = i;
+}
+
+static void sift_up(TaskHeap_t *h, int i) {
+    Task_t *t = h->items[i];
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!less(t, h->items[parent])) {
+            break;
+        }
+        place(h, i, h->items[parent]);
+        i = parent;
+    }
+    place(h, i, t);
+}
+
+static void sift_down(TaskHeap_t *h, int i) {
+    Task_t *t = h->items[i];
+    while (2 * i + 1 < h->size) {
+        int child = 2 * i + 1;
+        if (child + 1 < h->size && less(h->items[child + 1], h->items[child])) {
+            child++;
+        }
+        if (!less(h->items[child], t)) {
+            break;
+        }
+        place(h, i, h->items[child]);
+        i = child;
+    }
+    place(h, i, t);
+}
+
+/*
+ * Initialize an empty heap.
+ */
+void init_heap(TaskHeap_t *h) {
+    h->items    = NULL;
+    h->size     = 0;
+    h->capacity = 0;
+    h->next_seq = 0;
+}
+
+/*
+ * Release the heap array. The tasks belong to the task table.
+ */
+void free_heap(TaskHeap_t *h) {
+    free(h->items);
+    h->items = NULL;
+    h->size = h->capacity = 0;
+}
+
+/*
+ * Insert the task, keyed by its current `sched_key`.
+ */
+void heap_push(TaskHeap_t *h, Task_t *t) {
+    if (h->size == h->capacity) {
+        int capacity = h->capacity ? 2 * h->capacity : 64;
+        Task_t **items = (Task_t**) emalloc(capacity * sizeof(Task_t*));
+        if (h->size > 0) {
+            memcpy(items, h->items, h->size * sizeof(Task_t*));
+        }
+        free(h->items);
+        h->items = items;
+        h->capacity = capacity;
+    }
+
+    t->heap_seq = h->next_seq++;
+    place(h, h->size++, t);
+    sift_up(h, h->size - 1);
+}
+
+/*
+ * Returns the task with the smallest key without removing it.
+ */
+Task_t *heap_top(TaskHeap_t *h) {
+    return h->size > 0 ? h->items[0] : NULL;
+}
+
+/*
+ * Removes and returns the task with the smallest key, NULL if empty.
+ */
+Task_t *heap_pop(TaskHeap_t *h) {
+    if (h->size == 0) {
+        return NULL;
+    }
+    Task_t *top = h->items[0];
+    heap_remove(h, top);
+    return top;
+}
+
+/*
+ * Removes the given task from the heap.
+ */
+void heap_remove(TaskHeap_t *h, Task_t *t) {
+    int i = t->rq_index;
+    if (i < 0 || i >= h->size || h->items[i] != t) {
+        return;
+    }
+
+    Task_t *last = h->items[--h->size];
+    t->rq_index = -1;
+    if (last != t) {
+        place(h, i, last);
+        sift_down(h, i);
+        sift_up(h, last->rq_index);
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef _HEAP_H_
+#define _HEAP_H_
+
+#include "queue.h"
+
+/*
+ * Binary min-heap of tasks ordered by `sched_key`, ties broken by
+ * insertion order. Each task records its position in `rq_index`
+ * (-1 while not in a heap), so any task can be removed in O(log n).
+ */
+typedef struct TaskHeap TaskHeap_t;
+struct TaskHeap {
+    Task_t              **items;
+    int                 size;
+    int                 capacity;
+    unsigned long long  next_seq;
+};
+
+void init_heap(TaskHeap_t *);
+void free_heap(TaskHeap_t *);
+
+void heap_push(TaskHeap_t *, Task_t *);
+Task_t *heap_pop(TaskHeap_t *);
+Task_t *heap_top(TaskHeap_t *);
+void heap_remove(TaskHeap_t *, Task_t *);
+
+#endif
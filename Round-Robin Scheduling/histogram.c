@@ -0,0 +1,100 @@
+/*
+ * histogram.c
+ *
+ * Log-linear latency histogram, after G. Tene's HdrHistogram.
+ */
+
+#include <string.h>
+#include "histogram.h"
+
+/*
+ * Bucket of a value: exact below 2 * HIST_SUB_BUCKETS, then the top
+ * HIST_SUB_BITS + 1 bits of the value select the bucket within its
+ * power of two.
+ */
+static int bucket_of(int value) {
+    if (value < 2 * HIST_SUB_BUCKETS) {
+        return value;
+    }
+    int magnitude = 31 - __builtin_clz((unsigned) value);     // >= HIST_SUB_BITS + 1
+    int shift = magnitude - HIST_SUB_BITS;
+    int sub = value >> shift;                                   // HIST_SUB_BUCKETS..2*HIST_SUB_BUCKETS-1
+    return 2 * HIST_SUB_BUCKETS
+           + (magnitude - HIST_SUB_BITS - 1) * HIST_SUB_BUCKETS
+           + (sub - HIST_SUB_BUCKETS);
+}
+
+/*
+ * Largest value counted in the bucket.
+ */
+static int bucket_top(int bucket) {
+    if (bucket < 2 * HIST_SUB_BUCKETS) {
+        return bucket;
+    }
+    int offset = bucket - 2 * HIST_SUB_BUCKETS;
+    int shift = offset / HIST_SUB_BUCKETS + 1;
+    long long sub = HIST_SUB_BUCKETS + offset % HIST_SUB_BUCKETS;
+    long long top = ((sub + 1) << shift) - 1;
+    return top > 0x7fffffff ? 0x7fffffff : (int) top;
+}
+
+/*
+ * Initialize an empty histogram.
+ */
+void init_histogram(Histogram_t *h) {
+    memset(h, 0, sizeof(Histogram_t));
+}
+
+/*
+ * Counts the value; negative values count as 0.
+ */
+void histogram_record(Histogram_t *h, int value) {
+    if (value < 0) {
+        value = 0;
+    }
+    h->counts[bucket_of(value)]++;
+    if (h->count == 0 || value < h->min) {
+        h->min = value;
+    }
+    if (h->count == 0 || value > h->max) {
+        h->max = value;
+    }
+    h->count++;
+    h->sum += value;
+}
+
+/*
+ * The value below or at which `percentile` percent of the values
+ * fall (nearest rank), reported as the top of its bucket but never
+ * above the largest value seen. 0 if the histogram is empty.
+ */
+int histogram_percentile(const Histogram_t *h, double percentile) {
+    if (h->count == 0) {
+        return 0;
+    }
+
+    long long rank = (long long) (percentile / 100.0 * h->count + 0.999999);
+    if (rank < 1) {
+        rank = 1;
+    }
+    if (rank > h->count) {
+        rank = h->count;
+    }
+
+    long long seen = 0;
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        seen += h->counts[b];
+        if (seen >= rank) {
+            int top = bucket_top(b);
+            return top < h->max ? top : h->max;
+        }
+    }
+    return h->max;
+}
+
+/*
+ * Mean of the values, 0 if there are none.
+ */
+double histogram_mean(const Histogram_t *h) {
+    return h->count > 0 ? (double) h->sum / h->count : 0.0;
+}
@@ -0,0 +1,29 @@
+#ifndef _HISTOGRAM_H_
+#define _HISTOGRAM_H_
+
+/*
+ * Log-linear histogram of non-negative ints in the style of
+ * HdrHistogram: values below 2 * HIST_SUB_BUCKETS are counted exactly,
+ * larger ones in HIST_SUB_BUCKETS buckets per power of two, so every
+ * value is known to within 1 / HIST_SUB_BUCKETS (about 1.6%) and the
+ * memory use is fixed whatever the number of values.
+ */
+#define HIST_SUB_BITS       6
+#define HIST_SUB_BUCKETS    (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS        (2 * HIST_SUB_BUCKETS + (31 - HIST_SUB_BITS - 1) * HIST_SUB_BUCKETS)
+
+typedef struct Histogram Histogram_t;
+struct Histogram {
+    long long   counts[HIST_BUCKETS];
+    long long   count;
+    long long   sum;
+    int         min;
+    int         max;
+};
+
+void init_histogram(Histogram_t *);
+void histogram_record(Histogram_t *, int);
+int histogram_percentile(const Histogram_t *, double);
+double histogram_mean(const Histogram_t *);
+
+#endif
@@ -0,0 +1,238 @@
+/*
+ * loader.c
+ *
+ * Streaming parser for instruction files. Windows of a regular file
+ * are mapped with mmap(2) and released once parsed; other inputs are
+ * read(2) in LOADER_BLOCK chunks, keeping only the partial line at
+ * the end of a chunk.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "loader.h"
+
+/*
+ * Parses a decimal int, skipping leading blanks. Returns the first
+ * character after it, or NULL if there is no valid int.
+ */
+static const char *parse_int(const char *p, const char *end, int *value) {
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+
+    int negative = 0;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+    if (p == end || *p < '0' || *p > '9') {
+        return NULL;
+    }
+
+    long long v = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        v = v * 10 + (*p - '0');
+        if (v > (long long) INT_MAX + 1) {
+            return NULL;
+        }
+        p++;
+    }
+    if (!negative && v > INT_MAX) {
+        return NULL;
+    }
+
+    *value = (int) (negative ? -v : v);
+    return p;
+}
+
+/*
+ * Parses one line (without its newline) into an instruction.
+ */
+static void parse_line(const char *line, const char *end, Instruction_t *instruction) {
+    const char *p = parse_int(line, end, &instruction->event_tick);
+    if (p && p < end && *p == ',') {
+        p = parse_int(p + 1, end, &instruction->task_id);
+    } else {
+        p = NULL;
+    }
+    if (p && p < end && *p == ',') {
+        p = parse_int(p + 1, end, &instruction->burst_time);
+    } else {
+        p = NULL;
+    }
+
+    // Optional extra fields (e.g. the nice level of a NEW task)
+    instruction->num_params = 0;
+    while (p && p < end && *p == ','
+           && instruction->num_params < MAX_INSTRUCTION_PARAMS) {
+        p = parse_int(p + 1, end, &instruction->params[instruction->num_params++]);
+    }
+
+    if (p == NULL) {
+        fprintf(stderr, "Malformed input line: %.*s\n", (int) (end - line), line);
+        exit(1);
+    }
+    instruction->is_eof = 0;
+}
+
+/*
+ * Parses the complete lines in `data` into the batch.
+ */
+static void parse_batch(Loader_t *loader) {
+    const char *data = loader->data;
+
+    while (loader->batch_count < LOADER_BATCH && loader->pos < loader->len) {
+        const char *line = data + loader->pos;
+        const char *newline = memchr(line, '\n', loader->len - loader->pos);
+        const char *end;
+
+        if (newline != NULL) {
+            end = newline;
+        } else if (loader->at_eof) {
+            end = data + loader->len;   // Last line has no newline
+        } else {
+            return;                     // Incomplete line: refill first
+        }
+
+        parse_line(line, end, &loader->batch[loader->batch_count++]);
+        loader->pos = (size_t) (end - data) + (newline != NULL);
+    }
+}
+
+/*
+ * Makes the data following `pos` available: maps the next window of a
+ * regular file, or reads the next block from a pipe.
+ */
+static void refill(Loader_t *loader) {
+    if (loader->is_mapped) {
+        static long page_size = 0;
+        if (page_size == 0) {
+            page_size = sysconf(_SC_PAGESIZE);
+        }
+
+        off_t next = loader->data_offset + (off_t) loader->pos;
+        off_t offset = next - next % page_size;
+
+        if (loader->data != NULL) {
+            munmap(loader->data, loader->len);
+        }
+        loader->len = loader->file_size - offset < LOADER_WINDOW
+                      ? (size_t) (loader->file_size - offset) : LOADER_WINDOW;
+        if (loader->len <= (size_t) (next - offset)) {
+            fprintf(stderr, "Input line too long.\n");
+            exit(1);
+        }
+        loader->data = mmap(NULL, loader->len, PROT_READ, MAP_PRIVATE, loader->fd, offset);
+        if (loader->data == MAP_FAILED) {
+            perror("mmap");
+            exit(1);
+        }
+        madvise(loader->data, loader->len, MADV_SEQUENTIAL);
+
+        loader->pos = (size_t) (next - offset);
+        loader->data_offset = offset;
+        loader->at_eof = offset + (off_t) loader->len == loader->file_size;
+        return;
+    }
+
+    // Keep the partial line, then top the buffer up
+    memmove(loader->data, loader->data + loader->pos, loader->len - loader->pos);
+    loader->len -= loader->pos;
+    loader->pos = 0;
+    if (loader->len == LOADER_BLOCK) {
+        fprintf(stderr, "Input line too long.\n");
+        exit(1);
+    }
+
+    while (loader->len < LOADER_BLOCK) {
+        ssize_t n = read(loader->fd, loader->data + loader->len, LOADER_BLOCK - loader->len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            perror("read");
+            exit(1);
+        }
+        if (n == 0) {
+            loader->at_eof = 1;
+            break;
+        }
+        loader->len += (size_t) n;
+        if (memchr(loader->data + loader->len - n, '\n', (size_t) n) != NULL) {
+            break;
+        }
+    }
+}
+
+/*
+ * Open an instruction file (`-` => stdin). Returns NULL if the file
+ * cannot be opened.
+ */
+Loader_t *open_loader(const char *path) {
+    int fd = strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    Loader_t *loader = (Loader_t*) emalloc(sizeof(Loader_t));
+    struct stat st;
+
+    loader->fd          = fd;
+    loader->is_mapped   = fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0;
+    loader->file_size   = loader->is_mapped ? st.st_size : 0;
+    loader->data_offset = 0;
+    loader->data        = loader->is_mapped ? NULL : (char*) emalloc(LOADER_BLOCK);
+    loader->len         = 0;
+    loader->pos         = 0;
+    loader->at_eof      = 0;
+    loader->batch_count = 0;
+    loader->batch_next  = 0;
+
+    return loader;
+}
+
+/*
+ * Stores the next instruction; returns 0 once the input is exhausted.
+ */
+int next_instruction(Loader_t *loader, Instruction_t *instruction) {
+    if (loader->batch_next == loader->batch_count) {
+        loader->batch_count = 0;
+        loader->batch_next = 0;
+
+        while (1) {
+            parse_batch(loader);
+            if (loader->batch_count > 0) {
+                break;
+            }
+            if (loader->at_eof && loader->pos >= loader->len) {
+                return 0;
+            }
+            refill(loader);
+        }
+    }
+
+    *instruction = loader->batch[loader->batch_next++];
+    return 1;
+}
+
+/*
+ * Release the loader and close its input.
+ */
+void close_loader(Loader_t *loader) {
+    if (loader->is_mapped) {
+        if (loader->data != NULL) {
+            munmap(loader->data, loader->len);
+        }
+    } else {
+        free(loader->data);
+    }
+    if (loader->fd != STDIN_FILENO) {
+        close(loader->fd);
+    }
+    free(loader);
+}
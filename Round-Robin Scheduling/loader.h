@@ -0,0 +1,41 @@
+#ifndef _LOADER_H_
+#define _LOADER_H_
+
+#include <stddef.h>
+#include <sys/types.h>
+#include "queue.h"
+
+#define LOADER_BLOCK    (1 << 20)       // Read size for pipes
+#define LOADER_WINDOW   (64 << 20)      // Mapped window for regular files
+#define LOADER_BATCH    4096            // Instructions parsed at a time
+
+/*
+ * Instruction reader for `<event_tick>,<task_id>,<burst_time>` files;
+ * up to MAX_INSTRUCTION_PARAMS further comma-separated ints per line
+ * end up in `params`.
+ * Regular files are memory-mapped one window at a time, anything else
+ * (pipes, stdin) is read in large blocks; either way memory use does
+ * not grow with the input. Lines are parsed a batch at a time.
+ */
+typedef struct Loader Loader_t;
+struct Loader {
+    int             fd;
+    int             is_mapped;
+    off_t           file_size;          // Mapped input only
+    off_t           data_offset;        // File offset of data[0]
+
+    char            *data;              // Current window or read buffer
+    size_t          len;
+    size_t          pos;                // Start of the first unparsed line
+    int             at_eof;             // data ends where the input does
+
+    Instruction_t   batch[LOADER_BATCH];
+    int             batch_count;
+    int             batch_next;
+};
+
+Loader_t *open_loader(const char *);
+int next_instruction(Loader_t *, Instruction_t *);
+void close_loader(Loader_t *);
+
+#endif
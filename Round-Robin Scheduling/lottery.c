@@ -0,0 +1,149 @@
+/*
+ * lottery.c
+ *
+ * Lottery scheduling (C. A. Waldspurger and W. E. Weihl, "Lottery
+ * Scheduling: Flexible Proportional-Share Resource Management", 1994):
+ * every slice goes to the holder of a ticket drawn at random from the
+ * queued tasks' tickets. The draw is reproducible for a given seed.
+ */
+
+#include <stdlib.h>
+#include "policy.h"
+#include "fenwick.h"
+#include "share.h"
+
+#define MAX_TICKETS         (1 << 20)
+#define DEFAULT_TICKETS     100
+
+typedef struct LotteryRq LotteryRq_t;
+struct LotteryRq {
+    TicketTree_t            tickets;        // Queued tasks
+    unsigned long long      rng;            // xorshift64* state
+    ShareClock_t            share;
+    const SchedConfig_t     *config;
+};
+
+/*
+ * xorshift64* (S. Vigna, 2016); the state must not be 0.
+ */
+static unsigned long long next_random(LotteryRq_t *rq) {
+    rq->rng ^= rq->rng >> 12;
+    rq->rng ^= rq->rng << 25;
+    rq->rng ^= rq->rng >> 27;
+    return rq->rng * 0x2545F4914F6CDD1DULL;
+}
+
+static void *lottery_init_rq(const SchedConfig_t *config) {
+    LotteryRq_t *rq = (LotteryRq_t*) emalloc(sizeof(LotteryRq_t));
+    init_ticket_tree(&rq->tickets);
+    init_share_clock(&rq->share);
+    rq->rng    = config->seed ? config->seed : 1;
+    rq->config = config;
+    return rq;
+}
+
+static void lottery_free_rq(void *rq) {
+    free_ticket_tree(&((LotteryRq_t*) rq)->tickets);
+    deallocate(rq);
+}
+
+/*
+ * `tickets` <= 0 means the default number of tickets.
+ */
+static void lottery_init_task(Task_t *t, int tickets) {
+    t->weight   = tickets > 0 ? (tickets < MAX_TICKETS ? tickets : MAX_TICKETS) : DEFAULT_TICKETS;
+    t->rq_index = -1;
+    init_share_task(t);
+}
+
+static void lottery_enqueue(void *q, Task_t *t, int wakeup) {
+    LotteryRq_t *rq = (LotteryRq_t*) q;
+
+    if (wakeup) {
+        share_join(&rq->share, t);
+    }
+    ticket_tree_insert(&rq->tickets, t);
+}
+
+/*
+ * Holds the lottery among the queued tasks.
+ */
+static Task_t *lottery_pick_next(void *q) {
+    LotteryRq_t *rq = (LotteryRq_t*) q;
+
+    if (rq->tickets.size == 0) {
+        return NULL;
+    }
+    long long winner = (long long) (next_random(rq) % (unsigned long long) rq->tickets.total);
+    Task_t *t = ticket_tree_find(&rq->tickets, winner);
+    ticket_tree_remove(&rq->tickets, t);
+    return t;
+}
+
+static void lottery_remove(void *q, Task_t *t) {
+    LotteryRq_t *rq = (LotteryRq_t*) q;
+    ticket_tree_remove(&rq->tickets, t);
+    share_leave(&rq->share, t);
+}
+
+static int lottery_nr_queued(void *q) {
+    return ((LotteryRq_t*) q)->tickets.size;
+}
+
+static int lottery_time_slice(void *q, Task_t *t) {
+    return ((LotteryRq_t*) q)->config->slice;
+}
+
+static void lottery_charge(void *q, Task_t *t, int ticks) {
+    share_advance(&((LotteryRq_t*) q)->share, ticks);
+}
+
+static void lottery_expire(void *q, Task_t *t) {
+}
+
+/*
+ * Nothing preempts: a woken task enters the next draw.
+ */
+static int lottery_preempts(void *q, Task_t *curr, Task_t *woken) {
+    return 0;
+}
+
+static void lottery_block(void *q, Task_t *t) {
+    share_leave(&((LotteryRq_t*) q)->share, t);
+}
+
+static void lottery_migrate(void *from, void *to, Task_t *t) {
+    if (t->share_joined) {
+        share_leave(&((LotteryRq_t*) from)->share, t);
+        share_join(&((LotteryRq_t*) to)->share, t);
+    }
+}
+
+static int lottery_level(Task_t *t) {
+    return 0;
+}
+
+static int lottery_share(void *q, Task_t *t, double *achieved, double *target) {
+    return share_report(&((LotteryRq_t*) q)->share, t, achieved, target);
+}
+
+const SchedClass_t lottery_sched_class = {
+    .name       = "lottery",
+    .init_rq    = lottery_init_rq,
+    .free_rq    = lottery_free_rq,
+    .init_task  = lottery_init_task,
+    .enqueue    = lottery_enqueue,
+    .pick_next  = lottery_pick_next,
+    .remove     = lottery_remove,
+    .nr_queued  = lottery_nr_queued,
+    .time_slice = lottery_time_slice,
+    .charge     = lottery_charge,
+    .expire     = lottery_expire,
+    .preempts   = lottery_preempts,
+    .boost      = NULL,
+    .block      = lottery_block,
+    .migrate    = lottery_migrate,
+    .level      = lottery_level,
+    .share      = lottery_share,
+    .queue_lengths = NULL,
+};
@@ -0,0 +1,266 @@
+/*
+ * mlfq.c
+ *
+ * The ready structure of the multi-level feedback queue. The
+ * priority bitmap follows the O(1) scheduler of Linux 2.6
+ * (see R. Love, "Linux Kernel Development", 2nd ed., Chapter 4).
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include "mlfq.h"
+
+static void mark_ready(Mlfq_t *m, int level) {
+    m->ready_bitmap[(level - 1) / 64] |= (uint64_t) 1 << ((level - 1) % 64);
+}
+
+static void mark_empty(Mlfq_t *m, int level) {
+    m->ready_bitmap[(level - 1) / 64] &= ~((uint64_t) 1 << ((level - 1) % 64));
+}
+
+/*
+ * Initialize an MLFQ with `num_levels` empty queues.
+ */
+Mlfq_t *init_mlfq(int num_levels) {
+    assert(num_levels > 0);
+
+    Mlfq_t *m = (Mlfq_t*) emalloc(sizeof(Mlfq_t));
+    m->num_levels   = num_levels;
+    m->queues       = (Queue_t**) emalloc(num_levels * sizeof(Queue_t*));
+    m->bitmap_words = (num_levels + 63) / 64;
+    m->ready_bitmap = (uint64_t*) emalloc(m->bitmap_words * sizeof(uint64_t));
+    m->level_counts = (int*) emalloc(num_levels * sizeof(int));
+    m->boost_count  = 0;
+    m->count        = 0;
+    m->config       = NULL;
+
+    for (int i = 0; i < num_levels; i++) {
+        m->queues[i] = init_queue();
+        m->level_counts[i] = 0;
+    }
+    for (int i = 0; i < m->bitmap_words; i++) {
+        m->ready_bitmap[i] = 0;
+    }
+
+    return m;
+}
+
+/*
+ * Release the MLFQ. The tasks themselves belong to the task table.
+ */
+void free_mlfq(Mlfq_t *m) {
+    for (int i = 0; i < m->num_levels; i++) {
+        deallocate(m->queues[i]);
+    }
+    deallocate(m->queues);
+    deallocate(m->ready_bitmap);
+    deallocate(m->level_counts);
+    deallocate(m);
+}
+
+/*
+ * Check if every level is empty.
+ */
+int mlfq_is_empty(Mlfq_t *m) {
+    return mlfq_highest_level(m) == 0;
+}
+
+/*
+ * Returns the highest-priority level holding a task, or 0 if none.
+ */
+int mlfq_highest_level(Mlfq_t *m) {
+    for (int i = 0; i < m->bitmap_words; i++) {
+        if (m->ready_bitmap[i] != 0) {
+            return i * 64 + __builtin_ctzll(m->ready_bitmap[i]) + 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Returns the task at the front of the highest ready level without
+ * dequeuing it.
+ */
+Task_t *mlfq_peek(Mlfq_t *m) {
+    int level = mlfq_highest_level(m);
+    return level == 0 ? NULL : m->queues[level - 1]->start;
+}
+
+/*
+ * Queue the task at the end of the level given by its `current_queue`.
+ */
+void mlfq_enqueue(Mlfq_t *m, Task_t *task) {
+    assert(task->current_queue >= 1 && task->current_queue <= m->num_levels);
+
+    task->ready_boost = m->boost_count;
+    enqueue(m->queues[task->current_queue - 1], task);
+    mark_ready(m, task->current_queue);
+    m->level_counts[task->current_queue - 1]++;
+    m->count++;
+}
+
+/*
+ * Dequeues the front task of the highest ready level and records that
+ * level in the task's `current_queue`.
+ */
+Task_t *mlfq_dequeue(Mlfq_t *m) {
+    int level = mlfq_highest_level(m);
+    if (level == 0) {
+        return NULL;
+    }
+
+    Queue_t *q = m->queues[level - 1];
+    Task_t *task = dequeue(q);
+    if (is_empty(q)) {
+        mark_empty(m, level);
+    }
+    task->current_queue = level;
+    m->level_counts[level - 1]--;
+    m->count--;
+
+    return task;
+}
+
+/*
+ * Take a queued task off its level. A boost since the task was queued
+ * means it now sits in level 1, whatever its `current_queue` says.
+ */
+void mlfq_remove(Mlfq_t *m, Task_t *task) {
+    int level = task->ready_boost == m->boost_count ? task->current_queue : 1;
+    Queue_t *q = m->queues[level - 1];
+
+    remove_from_queue(q, task);
+    if (is_empty(q)) {
+        mark_empty(m, level);
+    }
+    m->level_counts[level - 1]--;
+    m->count--;
+}
+
+/*
+ * Moves every queued task to level 1, lowest level first, by splicing
+ * whole queues. This costs O(levels); the tasks' `current_queue` is
+ * corrected lazily when they are dequeued.
+ */
+void mlfq_boost(Mlfq_t *m) {
+    for (int level = m->num_levels; level > 1; level--) {
+        splice_queue(m->queues[0], m->queues[level - 1]);
+        mark_empty(m, level);
+        m->level_counts[0] += m->level_counts[level - 1];
+        m->level_counts[level - 1] = 0;
+    }
+    if (!is_empty(m->queues[0])) {
+        mark_ready(m, 1);
+    }
+    m->boost_count++;
+}
+
+/*
+ * The MLFQ as a scheduling policy: tasks start in level 1, run for
+ * their level's quantum and drop a level each time they use it up.
+ */
+
+static void *mlfq_init_rq(const SchedConfig_t *config) {
+    Mlfq_t *m = init_mlfq(config->num_levels);
+    m->config = config;
+    return m;
+}
+
+static void mlfq_free_rq(void *rq) {
+    free_mlfq((Mlfq_t*) rq);
+}
+
+static void mlfq_init_task(Task_t *t, int param) {
+    t->current_queue = 1;  // always starts in top queue
+}
+
+static void mlfq_class_enqueue(void *rq, Task_t *t, int wakeup) {
+    mlfq_enqueue((Mlfq_t*) rq, t);
+}
+
+static Task_t *mlfq_pick_next(void *rq) {
+    return mlfq_dequeue((Mlfq_t*) rq);
+}
+
+static void mlfq_class_remove(void *rq, Task_t *t) {
+    mlfq_remove((Mlfq_t*) rq, t);
+}
+
+static int mlfq_nr_queued(void *rq) {
+    return ((Mlfq_t*) rq)->count;
+}
+
+static int mlfq_time_slice(void *rq, Task_t *t) {
+    return ((Mlfq_t*) rq)->config->quanta[t->current_queue - 1];
+}
+
+static void mlfq_charge(void *rq, Task_t *t, int ticks) {
+}
+
+/*
+ * Demote the task by one level, down to the lowest.
+ */
+static void mlfq_expire(void *rq, Task_t *t) {
+    if (t->current_queue < ((Mlfq_t*) rq)->num_levels) {
+        t->current_queue++;
+    }
+}
+
+/*
+ * Only a strictly higher level preempts; the same level never does.
+ */
+static int mlfq_preempts(void *rq, Task_t *curr, Task_t *woken) {
+    return woken->current_queue < curr->current_queue;
+}
+
+/*
+ * Boost the queued tasks into level 1. The running task joins level 1
+ * too, its remaining quantum cut to at most the level 1 quantum.
+ */
+static void mlfq_class_boost(void *rq, Task_t *curr, int *remaining_quantum) {
+    Mlfq_t *m = (Mlfq_t*) rq;
+
+    mlfq_boost(m);
+    if (curr && curr->current_queue > 1) {
+        curr->current_queue = 1;
+        if (*remaining_quantum > m->config->quanta[0]) {
+            *remaining_quantum = m->config->quanta[0];
+        }
+    }
+}
+
+static void mlfq_migrate(void *from, void *to, Task_t *t) {
+}
+
+static int mlfq_level(Task_t *t) {
+    return t->current_queue;
+}
+
+static int mlfq_queue_lengths(void *rq, int *lengths) {
+    Mlfq_t *m = (Mlfq_t*) rq;
+    for (int i = 0; i < m->num_levels; i++) {
+        lengths[i] = m->level_counts[i];
+    }
+    return m->num_levels;
+}
+
+const SchedClass_t mlfq_sched_class = {
+    .name       = "mlfq",
+    .init_rq    = mlfq_init_rq,
+    .free_rq    = mlfq_free_rq,
+    .init_task  = mlfq_init_task,
+    .enqueue    = mlfq_class_enqueue,
+    .pick_next  = mlfq_pick_next,
+    .remove     = mlfq_class_remove,
+    .nr_queued  = mlfq_nr_queued,
+    .time_slice = mlfq_time_slice,
+    .charge     = mlfq_charge,
+    .expire     = mlfq_expire,
+    .preempts   = mlfq_preempts,
+    .boost      = mlfq_class_boost,
+    .block      = NULL,
+    .migrate    = mlfq_migrate,
+    .level      = mlfq_level,
+    .share      = NULL,
+    .queue_lengths = mlfq_queue_lengths,
+};
@@ -0,0 +1,39 @@
+#ifndef _MLFQ_H_
+#define _MLFQ_H_
+
+#include <stdint.h>
+#include "queue.h"
+#include "policy.h"
+
+/*
+ * Multi-level feedback queue with `num_levels` round-robin queues.
+ * Levels are numbered from 1 (highest priority) to `num_levels`.
+ * Bit (level - 1) of `ready_bitmap` is set while that level's queue
+ * is non-empty, so the highest ready level is found with a
+ * find-first-set over a few words instead of probing every queue.
+ */
+typedef struct Mlfq Mlfq_t;
+struct Mlfq {
+    int         num_levels;
+    Queue_t     **queues;           // queues[level - 1]
+    uint64_t    *ready_bitmap;
+    int         bitmap_words;
+    int         boost_count;        // Boosts performed so far
+    int         count;              // Tasks queued over all levels
+    int         *level_counts;      // Tasks queued per level, level 1 first
+    const SchedConfig_t *config;    // Quanta when used as a policy run queue
+};
+
+Mlfq_t *init_mlfq(int);
+void free_mlfq(Mlfq_t *);
+
+int mlfq_is_empty(Mlfq_t *);
+int mlfq_highest_level(Mlfq_t *);
+Task_t *mlfq_peek(Mlfq_t *);
+
+void mlfq_enqueue(Mlfq_t *, Task_t *);
+Task_t *mlfq_dequeue(Mlfq_t *);
+void mlfq_remove(Mlfq_t *, Task_t *);
+void mlfq_boost(Mlfq_t *);
+
+#endif
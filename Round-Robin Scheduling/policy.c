@@ -0,0 +1,28 @@
+/*
+ * policy.c
+ *
+ * Registry of the scheduling policies selectable with --policy.
+ */
+
+#include <string.h>
+#include "policy.h"
+
+static const SchedClass_t *sched_classes[] = {
+    &mlfq_sched_class,
+    &cfs_sched_class,
+    &stride_sched_class,
+    &lottery_sched_class,
+    &edf_sched_class,
+};
+
+/*
+ * Returns the policy with the given name, or NULL if there is none.
+ */
+const SchedClass_t *find_sched_class(const char *name) {
+    for (size_t i = 0; i < sizeof(sched_classes) / sizeof(sched_classes[0]); i++) {
+        if (strcmp(sched_classes[i]->name, name) == 0) {
+            return sched_classes[i];
+        }
+    }
+    return NULL;
+}
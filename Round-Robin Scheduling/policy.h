@@ -0,0 +1,98 @@
+#ifndef _POLICY_H_
+#define _POLICY_H_
+
+#include "queue.h"
+
+typedef struct GroupTable GroupTable_t;
+
+/*
+ * Tunables of the scheduling policies, shared by all run queues of a
+ * simulation. Times are in ticks.
+ */
+typedef struct SchedConfig SchedConfig_t;
+struct SchedConfig {
+    /* MLFQ */
+    int         num_levels;
+    int         *quanta;            // One per level, level 1 first
+
+    /* CFS */
+    int         min_granularity;    // Shortest slice; also the wakeup preemption margin
+    int         sched_latency;      // Period in which every queued task runs once
+    int         sleeper_bonus;      // Credit a waking task may keep below min_vruntime
+
+    /* Stride and lottery */
+    int         slice;              // Ticks a picked task runs before the next pick
+    unsigned long long seed;        // Lottery random number seed
+
+    /* EDF */
+    int         cbs;                // Enforce budgets with a constant bandwidth server
+
+    /* Group scheduling */
+    GroupTable_t *groups;           // Set up by the simulator
+};
+
+/*
+ * A scheduling policy, modelled on the Linux `sched_class`. Each CPU
+ * owns one run queue (`rq`) created by init_rq(); the simulator keeps
+ * the running task itself and only hands tasks to the policy while
+ * they wait.
+ *
+ *   init_task:  set up the policy fields of a NEW task from the
+ *               optional fourth field of the NEW instruction (0 if
+ *               absent): the nice level for cfs, the tickets for
+ *               stride and lottery
+ *   enqueue:    queue a task; `wakeup` is set for new bursts, clear
+ *               when a preempted or expired task is put back
+ *   pick_next:  dequeue the task to run next, NULL if none
+ *   remove:     dequeue a specific queued task
+ *   time_slice: ticks the picked task may run before it is re-queued
+ *   charge:     account `ticks` of CPU time to the running task
+ *   expire:     the task used up its slice (before it is re-queued)
+ *   preempts:   should the woken (already queued) task preempt curr?
+ *   boost:      periodic priority boost, NULL if the policy has none;
+ *               may shorten the running task's remaining slice
+ *   block:      the running task leaves the CPU without being queued
+ *               (burst done or EXIT); NULL if the policy does not care
+ *   migrate:    the task moves between two run queues
+ *   level:      value printed as `queue=` (0 if the policy has none)
+ *   share:      achieved and target CPU share of the task while it was
+ *               runnable; NULL for policies without tickets, returns
+ *               0 if there is nothing to report
+ *   queue_lengths: queued tasks per level into `lengths` (room for
+ *               config->num_levels), returns the number of levels;
+ *               NULL if the policy has a single level (nr_queued)
+ */
+typedef struct SchedClass SchedClass_t;
+struct SchedClass {
+    const char  *name;
+
+    void        *(*init_rq)(const SchedConfig_t *);
+    void        (*free_rq)(void *);
+    void        (*init_task)(Task_t *, int);
+
+    void        (*enqueue)(void *, Task_t *, int);
+    Task_t      *(*pick_next)(void *);
+    void        (*remove)(void *, Task_t *);
+    int         (*nr_queued)(void *);
+
+    int         (*time_slice)(void *, Task_t *);
+    void        (*charge)(void *, Task_t *, int);
+    void        (*expire)(void *, Task_t *);
+    int         (*preempts)(void *, Task_t *, Task_t *);
+    void        (*boost)(void *, Task_t *, int *);
+    void        (*block)(void *, Task_t *);
+    void        (*migrate)(void *, void *, Task_t *);
+    int         (*level)(Task_t *);
+    int         (*share)(void *, Task_t *, double *, double *);
+    int         (*queue_lengths)(void *, int *);
+};
+
+extern const SchedClass_t mlfq_sched_class;
+extern const SchedClass_t cfs_sched_class;
+extern const SchedClass_t stride_sched_class;
+extern const SchedClass_t lottery_sched_class;
+extern const SchedClass_t edf_sched_class;
+
+const SchedClass_t *find_sched_class(const char *);
+
+#endif
@@ -63,6 +63,7 @@ void deallocate(void *t) {
  */
 void enqueue(Queue_t *q, Task_t *task) {
     task->next = NULL;
+    task->prev = q->end;
 
     if (is_empty(q)) {
         q->start = task;
@@ -89,12 +90,53 @@ Task_t *dequeue(Queue_t *q) {
 
     if(q->start == NULL) {
         q->end = NULL;
+    } else {
+        q->start->prev = NULL;
     }
 
     task->next = NULL;
     return task;
 }
 
+/*
+ * Unlinks the given node, which must be in the queue, in O(1).
+ */
+void remove_from_queue(Queue_t *q, Task_t *task) {
+    if (task->prev != NULL) {
+        task->prev->next = task->next;
+    } else {
+        q->start = task->next;
+    }
+    if (task->next != NULL) {
+        task->next->prev = task->prev;
+    } else {
+        q->end = task->prev;
+    }
+    task->next = NULL;
+    task->prev = NULL;
+}
+
+/*
+ * Moves every node of `src` to the end of `dst` in O(1), leaving
+ * `src` empty.
+ */
+void splice_queue(Queue_t *dst, Queue_t *src) {
+    if (is_empty(src)) {
+        return;
+    }
+
+    if (is_empty(dst)) {
+        dst->start = src->start;
+    } else {
+        dst->end->next = src->start;
+    }
+    src->start->prev = dst->end;
+    dst->end = src->end;
+
+    src->start = NULL;
+    src->end = NULL;
+}
+
 /*
  * Return the number of nodes in the queue.
  */
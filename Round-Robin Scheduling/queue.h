@@ -1,6 +1,8 @@
 #ifndef _QUEUE_H_
 #define _QUEUE_H_
 
+#include <stddef.h>
+
 typedef struct Task Task_t;
 struct Task {
     int         id;
@@ -10,15 +12,61 @@ struct Task {
 
     int         total_wait_time;        // For Computing `Wait Time`
     int         total_execution_time;   // For Computing `Turn Around Time`
+    int         ready_tick;             // Tick from which queued time counts as waiting
+    int         ready_boost;            // MLFQ boost count when the task was queued
+    int         cpu;                    // CPU the task last ran/queued on, -1 => none yet
+    int         migrations;             // Moves between CPUs
+    int         arrival_tick;           // Tick the pending burst arrived
+    int         total_switch_time;      // Switch overhead paid before its runs
+    int         last_run_tick;          // Last tick it ran
+    int         last_run_cpu;           // CPU it last ran on, -1 => none yet
+    int         responded;              // The pending burst has run
+    int         group;                  // Task group, 0 without groups
+
+    long long   vruntime;               // CFS virtual runtime / stride pass
+    int         weight;                 // CFS load weight / stride and lottery tickets
+    long long   sched_key;              // Heap order of heap-based policies
+    unsigned long long heap_seq;        // Heap tie-break (insertion order)
+    int         rq_index;               // Heap position or ticket slot, -1 => not queued
+
+    int         share_joined;           // Counted in its run queue's tickets
+    double      share_mark;             // Run queue share clock when last settled
+    long long   busy_mark;              // Run queue busy ticks when last settled
+    double      entitled_ticks;         // CPU time its tickets entitled it to
+    long long   runnable_ticks;         // Busy ticks of its CPU while it was runnable
+
+    int         deadline;               // Absolute deadline of the pending burst, -1 => none
+    int         rel_deadline;           // Relative deadline of the last burst, 0 => none
+    int         period;                 // CBS period of the last burst
+    int         max_budget;             // CBS budget per period of the last burst
+    int         budget;                 // CBS budget left
+
+    int         io_device;              // Device queueing or serving its request, -1 => none
+    int         io_length;              // Service ticks of the request
+    int         io_position;            // Position the request seeks to
+    int         io_submit_tick;         // Tick the request was queued
+    long long   io_key;                 // Device queue order
+    unsigned long long io_seq;          // Device queue tie-break (arrival order)
+    int         io_index;               // Position in the device queue
+    int         io_held_length;         // Request waiting for the CPU burst or current request, 0 => none
+    int         io_held_device;
+    int         io_held_position;
     Task_t      *next;                  // For Queue (Linked List) Operations
+    Task_t      *prev;                  // Back link, so a queued task unlinks in O(1)
+    struct TaskSlab *slab;              // Task table slab the record belongs to
 };
 
 typedef struct Instruction Instruction_t;
+#define MAX_INSTRUCTION_PARAMS 3
+
 struct Instruction {
     int         event_tick;
     int         task_id;
     int         burst_time;
     int         is_eof;
+
+    int         params[MAX_INSTRUCTION_PARAMS];   // Optional trailing fields
+    int         num_params;
 };
 
 typedef struct Queue Queue_t;
@@ -32,8 +80,11 @@ int is_empty(Queue_t *);
 
 void enqueue(Queue_t *, Task_t *);
 Task_t *dequeue(Queue_t *);
+void remove_from_queue(Queue_t *, Task_t *);
+void splice_queue(Queue_t *, Queue_t *);
 int queue_size(Queue_t *);
 
+void *emalloc(size_t);
 void deallocate(void *);
 
 #endif
@@ -7,12 +7,112 @@
  * 	Simulate a Multi-Level Feedback Queue with `3` Levels/Queues each 
  * 	implementing a Round-Robin scheduling policy with a Time Quantum
  * 	of `2`, `4` and `8` resp, and including a boost mechanism.
+ * 	The number of levels, their quanta and the boost interval can
+ * 	be changed from the command line or a config file.
  * 
  * Input: Command Line args
  * ------------------------
- * 	./feedbackq <input_test_case_file>
+ * 	./schedule [options] <input_test_case_file>
  * 	e.g.
- * 	     ./feedbackq test1.txt
+ * 	     ./schedule test1.txt
+ * 	     ./schedule --quanta=1,2,4,8,16 --boost-interval=50 test1.txt
+ * 	     ./generator | ./schedule --summary -
+ *
+ * 	The input file may be `-` (or any pipe) to read from stdin.
+ *
+ * 	--event-driven: instead of stepping one tick at a time, jump
+ * 		straight to the next instruction, quantum expiry, burst
+ * 		completion or boost. The output is identical.
+ * 	--quanta=<q1,q2,...>: one time quantum per level, highest
+ * 		priority first (default `2,4,8`).
+ * 	--boost-interval=<ticks>: boost period, 0 disables boosting
+ * 		(default `25`).
+ * 	--config=<file>: read the settings above from a file holding
+ * 		`key = value` lines with the keys `quanta`, `levels` and
+ * 		`boost_interval` (`#` starts a comment). `levels = N`
+ * 		alone gives the quanta 2, 4, 8, ... Flags given after
+ * 		--config override the file.
+ * 	--cpus=<n>: simulate `n` CPUs, each with its own set of MLFQ
+ * 		queues (default `1`). A task's bursts go back to the CPU
+ * 		it last used unless that CPU is clearly busier than the
+ * 		least loaded one, and an idle CPU steals the next task of
+ * 		the busiest CPU. Tick lines carry a `cpu=` field, EXIT
+ * 		lines a `mig=` count, and a per-CPU summary follows.
+ * 	--global-boost: with several CPUs, boost all of them at the
+ * 		same tick. By default CPU `i` boosts `i * interval / n`
+ * 		ticks later than CPU 0, spreading the boosts out.
+ * 	--log=<file>: instead of printing, write a compact binary
+ * 		event log (`-` => stdout). Records are varint-coded with
+ * 		tick deltas, and runs of ticks on the same task take a
+ * 		single record. `./decode_log <file>` turns the log back
+ * 		into the exact text output, and fails on a log cut short.
+ * 	--summary: print only aggregate statistics at the end.
+ * 	--policy=<name>: scheduling policy, `mlfq` (default), `cfs`,
+ * 		`stride`, `lottery` or `edf`. `cfs` runs the task with the least
+ * 		virtual runtime, which grows more slowly for tasks of
+ * 		higher weight. `stride` and `lottery` share the CPU in
+ * 		proportion to the tasks' tickets, by the smallest pass
+ * 		or by a random draw; EXIT lines are then followed by a
+ * 		SHARE line giving the fraction of the busy ticks the task
+ * 		got while runnable against the fraction its tickets
+ * 		entitled it to. `edf` runs the burst with the earliest
+ * 		deadline and preempts for an earlier one; bursts without
+ * 		a deadline run after all others, in arrival order. Tick
+ * 		lines show `queue=0` except for mlfq.
+ * 	--min-granularity=<ticks>, --sched-latency=<ticks>,
+ * 	--sleeper-bonus=<ticks>: CFS tunables (defaults `2`, `12` and
+ * 		`6`): the shortest slice (and the lead a waking task needs
+ * 		to preempt), the period shared out among queued tasks by
+ * 		weight, and how much credit a waking task may keep.
+ * 	--slice=<ticks>: stride and lottery slice (default `1`).
+ * 	--seed=<n>: seed of the lottery draws (default `1`).
+ * 	--cbs: under edf, serve each task by a constant bandwidth server:
+ * 		a burst using up its budget gets its deadline postponed by
+ * 		a period and a new budget.
+ * 	--metrics=<file>: at the end of the run, write the metrics to
+ * 		the file (`-` => stdout, after the other output): wait
+ * 		and turnaround times per task and response times per
+ * 		burst (first run minus arrival) with p50/p90/p99/p999,
+ * 		context switches, preemptions, slice expiries, demotions
+ * 		and boosts, deadline misses and lateness percentiles,
+ * 		and the queued tasks per level every few
+ * 		ticks. Times are kept in
+ * 		log-scale histograms and the series is thinned as it
+ * 		grows, so the memory used does not grow with the run.
+ * 	--metrics-format=json|csv: format of the metrics (default
+ * 		`json`).
+ * 	--sample-interval=<ticks>: initial queue length sampling
+ * 		period (default `100`, 0 => no series).
+ * 	--devices=<n>: I/O devices (default `1`).
+ * 	--io-sched=fifo|elevator: order in which a device serves its
+ * 		queued requests (default `fifo`). `elevator` (LOOK) sweeps
+ * 		across the positions, taking the nearest request ahead of
+ * 		the head and reversing when there is none.
+ * 	--seek-rate=<n>: positions the device head crosses per tick;
+ * 		seeking to a request then adds to its service time
+ * 		(default `0`: seeks are free).
+ * 	--switch-cost=<ticks>: ticks a CPU loses switching to another
+ * 		task (default `0`). They come before the task's quantum
+ * 		and show as SWITCH lines.
+ * 	--cache-penalty=<ticks>: further ticks lost refilling the cache
+ * 		of a task switched to (default `0`). The penalty is in
+ * 		proportion to the time since the task last ran on that CPU,
+ * 		in full after --cache-decay ticks (default `20`) or on
+ * 		another CPU. Turnaround times include the lost ticks, and a
+ * 		cost summary gives the efficiency, useful ticks over
+ * 		useful plus lost ticks.
+ * 	--groups=<file>: schedule by task group, reading the groups from
+ * 		a file of `<group>,<weight>[,<quota>,<period>]` lines (`#`
+ * 		starts a comment), weights 1..262144. Groups run from 0 to
+ * 		the largest id given; others get weight `1024` and no quota. Each CPU runs
+ * 		the group that has had the least CPU time for its weight,
+ * 		and within it the task the policy picks; a task of another
+ * 		group does not preempt. A group with a quota gets at most
+ * 		`quota` ticks of CPU time, over all CPUs, in every `period`
+ * 		ticks (starting at tick 1): then it is throttled until its
+ * 		next period. A group summary gives each group's CPU time,
+ * 		its share against its weight's share among the groups that
+ * 		ran, and the ticks it spent throttled.
  * 
  * Input: Test Case file
  * ---------------------
@@ -25,6 +125,37 @@
  * 	2) Special Case:
  * 	     burst_time =  0 -- Task Creation
  * 	     burst_time = -1 -- Task Termination
+ * 	3) A burst for a task whose previous burst is still pending
+ * 		replaces that burst; the task keeps its place.
+ * 	4) A creation line may carry a fourth field: the task's nice
+ * 		level (-20..19, default 0) which sets its CFS weight, or
+ * 		its tickets for stride and lottery (default 100):
+ *
+ * 	<event_tick>,<task_id>,0,<nice | tickets>[,<group>]
+ *
+ * 		A fifth field puts the task in a group (default 0), under
+ * 		--groups.
+ *
+ * 	5) A burst line may carry a relative deadline, a CBS period
+ * 		(default: the deadline) and a CBS budget per period
+ * 		(default: the burst time). The burst is due by the end of
+ * 		tick `event_tick + deadline - 1`; a burst finishing later
+ * 		is reported with a MISS line, under every policy. A
+ * 		Deadline summary line (misses, CPU utilization) and the
+ * 		lateness percentiles follow the run:
+ *
+ * 	<event_tick>,<task_id>,<burst_time>,<deadline>[,<period>[,<budget>]]
+ *
+ * 	6) burst_time = -2 is an I/O request of `length` ticks of service
+ * 		on a device (default 0) at a position (default 0), for the
+ * 		elevator. It is queued at the device once the task's
+ * 		pending CPU burst is done; until it completes the task is
+ * 		blocked, and a CPU burst arriving meanwhile waits for it.
+ * 		The task is ready again from the tick after the last tick
+ * 		of service. IO and IODONE lines report the request, and an
+ * 		I/O summary follows the run:
+ *
+ * 	<event_tick>,<task_id>,-2,<length>[,<device>[,<position>]]
  * 
  * 
  * Assumptions: (For Multi-Level Feedback Queue)
@@ -35,8 +166,11 @@
  * 	3) Arrival tick, Burst tick and termination tick for the same  
  * 		Task will never overlap. But the arrival/exit of one  
  * 		Task may overlap with another Task.
- * 	4) Tasks will be labelled from 1 to 10.
- * 	5) The event_ticks in the test files will be in sorted order.
+ * 	4) Tasks may carry any int id, negative ones included; they
+ * 		are kept in a hashed task table, so only live tasks take up
+ * 		memory.
+ * 	5) The event_ticks in the test files will be in sorted order,
+ * 		starting at 1; any other input is rejected.
  * 	6) Once a Task is assigned a queue, it will always continue to 
  * 		run in that queue for any new future bursts (Unless further 
  * 		demoted, or returned to queue 1 by a boost).
@@ -45,6 +179,9 @@
  * 	8) Task arrival/termination/boosting does not consume CPU cycles.
  * 	9) A task is enqueued into one of the queues only if it requires
  * 		CPU bursts.
+ * 	10) A task that gives up the CPU before its quantum ends (its
+ * 		burst is done, e.g. to do I/O) keeps its level, and gets
+ * 		a full quantum when it runs again.
  * 	
  * Output:
  * -----------------------
@@ -55,510 +192,572 @@
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <unistd.h>
-#include <pthread.h>
 #include <string.h>
-#include <stdbool.h>
-#include "queue.h"
+#include <limits.h>
+#include <getopt.h>
+#include "sim.h"
+#include "loader.h"
 
 
 /* 
  * Some constants related to assignment description.
  */
-#define MAX_INPUT_LINE 100
-#define MAX_TASKS 10
-#define BOOST_INTERVAL 25
+#define MAX_CONFIG_LINE 1024
+#define DEFAULT_BOOST_INTERVAL 25
+#define DEFAULT_MIN_GRANULARITY 2
+#define DEFAULT_SCHED_LATENCY 12
+#define DEFAULT_SLEEPER_BONUS 6
+#define DEFAULT_SLICE 1
+#define DEFAULT_SEED 1
+#define DEFAULT_SAMPLE_INTERVAL 100
+#define DEFAULT_DEVICES 1
+#define DEFAULT_CACHE_DECAY 20
 
 /*
- * MLFQ has three queues: Q1=2 ticks, Q2=4 ticks, Q3=8 ticks
+ * By default the MLFQ has three queues: Q1=2 ticks, Q2=4 ticks,
+ * Q3=8 ticks
  */
-const int QUEUE_TIME_QUANTUMS[] = { 2, 4, 8 };
-
-/* Global Queues for MLFQ */
-Queue_t *queue_1;
-Queue_t *queue_2;
-Queue_t *queue_3;
-
-/* Global Task Table (up to 10 tasks) */
-Task_t task_table[MAX_TASKS];
-
-/* Currently running task + the time slice left for it */
-Task_t *current_task = NULL;
-int remaining_quantum = 0;
+const int DEFAULT_QUEUE_TIME_QUANTUMS[] = { 2, 4, 8 };
+
+/* Simulation settings, from the command line and config file */
+SimOptions_t options = {
+    .sched_class    = &mlfq_sched_class,
+    .sched_config   = {
+        .num_levels      = 0,       // 0 => DEFAULT_QUEUE_TIME_QUANTUMS
+        .quanta          = NULL,
+        .min_granularity = DEFAULT_MIN_GRANULARITY,
+        .sched_latency   = DEFAULT_SCHED_LATENCY,
+        .sleeper_bonus   = DEFAULT_SLEEPER_BONUS,
+        .slice           = DEFAULT_SLICE,
+        .seed            = DEFAULT_SEED,
+    },
+    .boost_interval = DEFAULT_BOOST_INTERVAL,
+    .num_cpus       = 1,
+    .global_boost   = 0,
+    .event_driven   = 0,
+    .output_mode    = OUTPUT_TEXT,
+    .sample_interval = DEFAULT_SAMPLE_INTERVAL,
+    .num_devices    = DEFAULT_DEVICES,
+    .io_sched       = IO_FIFO,
+    .seek_rate      = 0,
+    .switch_cost    = 0,
+    .cache_penalty  = 0,
+    .cache_decay    = DEFAULT_CACHE_DECAY,
+};
+
+/* Command line settings */
+const char *input_file = NULL;
+const char *log_file = NULL;
+const char *metrics_file = NULL;
+MetricsFormat_t metrics_format = METRICS_JSON;
 
 /*
- * validate_args():
- *   We need exactly one command line arg: the input file name.
+ * usage():
+ *   Print the command line synopsis and quit.
  */
-void validate_args(int argc, char *argv[]) {
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s <input_file>\n", argv[0]);
-        exit(1);
-    }
+void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--event-driven] [--config=<file>] "
+                    "[--quanta=<q1,q2,...>] [--boost-interval=<ticks>] "
+                    "[--cpus=<n>] [--global-boost] [--log=<file> | --summary] "
+                    "[--policy=mlfq|cfs|stride|lottery|edf] [--min-granularity=<ticks>] "
+                    "[--sched-latency=<ticks>] [--sleeper-bonus=<ticks>] "
+                    "[--slice=<ticks>] [--seed=<n>] [--cbs] "
+                    "[--metrics=<file>] [--metrics-format=json|csv] "
+                    "[--sample-interval=<ticks>] [--devices=<n>] "
+                    "[--io-sched=fifo|elevator] [--seek-rate=<n>] "
+                    "[--switch-cost=<ticks>] [--cache-penalty=<ticks>] "
+                    "[--cache-decay=<ticks>] [--groups=<file>] "
+                    "<input_file>\n", prog);
+    exit(1);
 }
 
 /*
- * initialize_vars():
- *   Sets up empty queues and resets the task table.
+ * set_quanta():
+ *   Parses a comma-separated list of positive quanta; the number of
+ *   entries becomes the number of MLFQ levels.
  */
-void initialize_vars() {
-    queue_1 = init_queue();
-    queue_2 = init_queue();
-    queue_3 = init_queue();
-
-    for (int i = 0; i < MAX_TASKS; i++) {
-        task_table[i].id                   = 0;  // 0 => "unused"
-        task_table[i].burst_time           = 0;
-        task_table[i].remaining_burst_time = 0;
-        task_table[i].current_queue        = 0;
-        task_table[i].total_wait_time      = 0;
-        task_table[i].total_execution_time = 0;
-        task_table[i].next                 = NULL;
+void set_quanta(const char *list) {
+    int count = 1;
+    for (const char *c = list; *c; c++) {
+        if (*c == ',') count++;
     }
 
-    current_task      = NULL;
-    remaining_quantum = 0;
-}
-
-/*
- * Function: read_instruction
- * --------------------------
- *  Reads a single line from the input file and stores the 
- *  appropriate values in the instruction pointer provided. In case
- *  `EOF` is encountered, the `is_eof` flag is set.
- *
- *  fp: File pointer to the input test file
- *  instruction: Pointer to store the read instruction details
- */
-
-void read_instruction(FILE *fp, Instruction_t *instruction) {
-    char line[MAX_INPUT_LINE];
-    if (fgets(line, sizeof(line), fp) == NULL) {
-        instruction->event_tick = -1;
-        instruction->is_eof     = true;
-        return;
-    }
-
-    int vars_read = sscanf(line, "%d,%d,%d",
-                           &instruction->event_tick,
-                           &instruction->task_id,
-                           &instruction->burst_time);
-    if (vars_read != 3) {
-        fprintf(stderr, "Malformed input line: %s\n", line);
-        exit(1);
+    int *quanta = (int*) emalloc(count * sizeof(int));
+    const char *p = list;
+    for (int i = 0; i < count; i++) {
+        char *end;
+        long q = strtol(p, &end, 10);
+        if (end == p || q <= 0 || q > INT_MAX || (*end != ',' && *end != '\0')) {
+            fprintf(stderr, "Invalid quanta list: %s\n", list);
+            exit(1);
+        }
+        quanta[i] = (int) q;
+        p = end + 1;
     }
 
-    instruction->is_eof = false;
-    if (instruction->event_tick < 0 || instruction->task_id < 0) {
-        fprintf(stderr, "Incorrect file input.\n");
-        exit(1);
-    }
+    free(options.sched_config.quanta);
+    options.sched_config.quanta = quanta;
+    options.sched_config.num_levels = count;
 }
 
 /*
- * Function: get_queue_by_id
- * -------------------------
- *  Returns the Queue associated with the given `queue_id`.
- *
- *  queue_id: Integer Queue identifier.
+ * parse_ticks():
+ *   Parses a non-negative number of ticks for the setting `what`.
  */
-
-Queue_t *get_queue_by_id(int queue_id) {
-    switch (queue_id) {
-        case 1: return queue_1;
-        case 2: return queue_2;
-        case 3: return queue_3;
+int parse_ticks(const char *what, const char *value) {
+    char *end;
+    long ticks = strtol(value, &end, 10);
+    if (end == value || *end != '\0' || ticks < 0 || ticks > INT_MAX) {
+        fprintf(stderr, "Invalid %s: %s\n", what, value);
+        exit(1);
     }
-    return NULL; // Should not happen if queue_id is 1..3
+    return (int) ticks;
 }
 
 /*
- * remove_task_from_queue():
- *   Remove a given Task_t pointer from a queue, if present.
+ * set_levels():
+ *   Use `value` queues with doubling quanta 2, 4, 8, ...
  */
-void remove_task_from_queue(Queue_t *q, Task_t *t) {
-    if (is_empty(q)) return;
-
-    if (q->start == t) {
-        q->start = t->next;
-        if (q->start == NULL) {
-            q->end = NULL;
-        }
-        t->next = NULL;
-        return;
+void set_levels(const char *value) {
+    int levels = parse_ticks("number of levels", value);
+    if (levels <= 0 || levels > 30) {
+        fprintf(stderr, "Invalid number of levels: %s\n", value);
+        exit(1);
     }
 
-    Task_t *prev = q->start;
-    while (prev->next && prev->next != t) {
-        prev = prev->next;
-    }
-    if (prev->next == t) {
-        prev->next = t->next;
-        if (prev->next == NULL) {
-            q->end = prev;
-        }
-        t->next = NULL;
+    free(options.sched_config.quanta);
+    options.sched_config.quanta = (int*) emalloc(levels * sizeof(int));
+    for (int i = 0; i < levels; i++) {
+        options.sched_config.quanta[i] = 2 << i;
     }
+    options.sched_config.num_levels = levels;
 }
 
 /*
- * remove_task_from_all_queues():
- *   Remove the task from Q1, Q2, Q3 if it appears.
+ * set_boost_interval():
+ *   Parses the boost period; 0 turns boosting off.
  */
-void remove_task_from_all_queues(Task_t *t) {
-    remove_task_from_queue(queue_1, t);
-    remove_task_from_queue(queue_2, t);
-    remove_task_from_queue(queue_3, t);
+void set_boost_interval(const char *value) {
+    options.boost_interval = parse_ticks("boost interval", value);
 }
 
 /*
- * 	 preempt_if_higher_priority_arrived():
- *   If the currently running task is in a lower queue (queue_2 or queue_3)
- *   and a new task arrives in a strictly higher queue (queue_1 < current_task->queue),
- *   we must preempt. The assignment states we do *not* preempt if the new arrival
- *   has the *same* priority, but we *do* if it's strictly higher.
- *
- *   Called each time a new task arrives with burst_time>0, *before* we enqueue it,
- *   so that the new higher-priority task can run immediately at this tick.
+ * set_policy():
+ *   Selects the scheduling policy by name.
  */
-void preempt_if_higher_priority_arrived(Task_t *new_task) {
-    // If no current_task, no preemption needed
-    if (current_task == NULL) return;
-
-    // If new arrival is higher priority (smaller queue ID) than current
-    if (new_task->current_queue < current_task->current_queue) {
-        // Preempt current_task:
-        // 1) Put current_task at back of its queue
-        enqueue(get_queue_by_id(current_task->current_queue), current_task);
-        // 2) Clear current_task so scheduler can pick new arrival
-        current_task = NULL;
-        remaining_quantum = 0;
+void set_policy(const char *name) {
+    options.sched_class = find_sched_class(name);
+    if (options.sched_class == NULL) {
+        fprintf(stderr, "Unknown policy: %s\n", name);
+        exit(1);
     }
 }
 
 /*
- * Function: handle_instruction
- * ----------------------------
- *  Processes the input instruction, depending on the instruction
- *  type:
- *      a. New Task (burst_time == 0)
- *      b. Task Completion (burst_time == -1)
- *      c. Task Burst (burst_time == <int>)
- *
- *  NOTE: 
- *	a. This method performs NO task scheduling, NO Preemption and NO
- *  	Updation of Task priorities/levels. These tasks would be   
- *		handled by the `scheduler`.
- *	b. A task once demoted to a level, retains that level for all 
- *		future bursts unless it is further demoted or boosted.
- *
- *  instruction: Input instruction
- *  tick: Clock tick (ONLY For Print statements)
+ * set_io_sched():
+ *   Selects the device queue discipline by name.
  */
- 
-void handle_instruction(Instruction_t *instruction, int tick) {
-    int task_id = instruction->task_id;
-    Task_t *t   = &task_table[task_id];
-
-    if (instruction->burst_time == 0) {
-        // NEW task
-        t->id                   = task_id;
-        t->burst_time           = 0;
-        t->remaining_burst_time = 0;
-        t->current_queue        = 1;  // always starts in top queue
-        t->total_wait_time      = 0;
-        t->total_execution_time = 0;
-        t->next                 = NULL;
-
-        printf("[%05d] id=%04d NEW\n", tick, task_id);
-
-    } else if (instruction->burst_time == -1) {
-        // EXIT
-        int waiting_time     = t->total_wait_time;
-        int turn_around_time = t->total_wait_time + t->total_execution_time;
-
-        printf("[%05d] id=%04d EXIT wt=%d tat=%d\n",
-               tick, task_id, waiting_time, turn_around_time);
-
-        // Remove from queues
-        remove_task_from_all_queues(t);
-
-        // If this was the current running task, relinquish CPU
-        if (current_task && current_task->id == task_id) {
-            current_task = NULL;
-            remaining_quantum = 0;
-        }
-
-        // Zero out the structure
-        t->id = 0;
-        t->burst_time = 0;
-        t->remaining_burst_time = 0;
-        t->current_queue = 0;
-        t->total_wait_time = 0;
-        t->total_execution_time = 0;
-        t->next = NULL;
-
+void set_io_sched(const char *name) {
+    if (strcmp(name, "fifo") == 0) {
+        options.io_sched = IO_FIFO;
+    } else if (strcmp(name, "elevator") == 0) {
+        options.io_sched = IO_ELEVATOR;
     } else {
-        // A CPU burst requirement: new_task needs CPU time
-        t->burst_time           = instruction->burst_time;
-        t->remaining_burst_time = instruction->burst_time;
-
-        /*
-         * (NEW) Preempt if the new task is strictly higher priority
-         * than the currently running task. The assignment states
-         * no preemption if same priority, but does imply preemption
-         * for higher priority.
-         */
-        preempt_if_higher_priority_arrived(t);
-
-        // Now queue the new CPU burst
-        enqueue(get_queue_by_id(t->current_queue), t);
+        fprintf(stderr, "Unknown I/O scheduler: %s\n", name);
+        exit(1);
     }
 }
 
 /*
- * Function: peek_priority_task
- * ----------------------------
- *  Returns a reference to the Task with the highest priority.
- *  Does NOT dequeue the task.
+ * set_devices():
+ *   Parses the number of I/O devices, at least one.
  */
-
-Task_t *peek_priority_task() {
-    if (!is_empty(queue_1)) return queue_1->start;
-    if (!is_empty(queue_2)) return queue_2->start;
-    if (!is_empty(queue_3)) return queue_3->start;
-    return NULL;
+void set_devices(const char *value) {
+    options.num_devices = parse_ticks("number of devices", value);
+    if (options.num_devices <= 0) {
+        fprintf(stderr, "Invalid number of devices: %s\n", value);
+        exit(1);
+    }
 }
 
 /*
- * Function: decrease_task_level
- * -----------------------------
- *  Updates the task to lower its level(Queue) by 1.
+ * trim():
+ *   Strips leading and trailing whitespace in place.
  */
-void decrease_task_level(Task_t *task) {
-	task->current_queue = task->current_queue == 3 ? 3 : task->current_queue + 1;
+char *trim(char *str) {
+    while (*str == ' ' || *str == '\t') str++;
+
+    char *end = str + strlen(str);
+    while (end > str && (end[-1] == ' ' || end[-1] == '\t'
+                         || end[-1] == '\n' || end[-1] == '\r')) {
+        end--;
+    }
+    *end = '\0';
+
+    return str;
 }
 
 /*
- * Function: boost
- * -----------------------------
- *  If the current tick is a multiple of the BOOST_INTERVAL, perform a boost
- *  on all tasks in Queue 3, followed by a boost on all tasks in Queue
- *  2.  A boost is done by dequeuing the task from its current queue 
- *  and queuing it into Queue 1.  At the end of this process, all tasks
- *  with remaining CPU bursts should be in Queue 1.  The current task
- *  should be unaffected, except that its remaining quantum should be
- *  set to a maximum of 2 (or left unchanged if it's less than two). 
- *  Boosts do not take CPU time.
+ * load_groups():
+ *   Reads the task groups from a file of
+ *   `<group>,<weight>[,<quota>,<period>]` lines.
  */
+void load_groups(const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "Groups file \"%s\" does not exist.\n", path);
+        exit(1);
+    }
 
+    GroupSpec_t *specs = NULL;
+    int count = 0;
+    char line[MAX_CONFIG_LINE];
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        char *comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+
+        char *text = trim(line);
+        if (*text == '\0') continue;
+
+        int id, weight, quota = 0, period = 0;
+        char extra;
+        int fields = sscanf(text, "%d , %d , %d , %d %c", &id, &weight, &quota, &period, &extra);
+        if ((fields != 2 && fields != 4) || id < 0 || id >= INT_MAX || weight <= 0 || weight > GROUP_MAX_WEIGHT
+            || quota < 0 || period < 0 || (quota > 0 && period == 0)) {
+            fprintf(stderr, "Malformed group line: %s\n", text);
+            exit(1);
+        }
 
-void boost(int tick) {
-    if (tick % BOOST_INTERVAL != 0) {
-        return;
+        if (id >= count) {
+            GroupSpec_t *grown = (GroupSpec_t*) emalloc((size_t) (id + 1) * sizeof(GroupSpec_t));
+            if (count > 0) {
+                memcpy(grown, specs, count * sizeof(GroupSpec_t));
+                deallocate(specs);
+            }
+            for (int i = count; i <= id; i++) {
+                grown[i].weight = GROUP_DEFAULT_WEIGHT;
+                grown[i].quota  = 0;
+                grown[i].period = 0;
+            }
+            specs = grown;
+            count = id + 1;
+        }
+        specs[id].weight = weight;
+        specs[id].quota  = quota;
+        specs[id].period = period;
     }
+    fclose(fp);
 
-    // Move tasks from queue_3 -> queue_1
-    while (!is_empty(queue_3)) {
-        Task_t *tmp = dequeue(queue_3);
-        tmp->current_queue = 1;
-        enqueue(queue_1, tmp);
+    if (count == 0) {
+        fprintf(stderr, "Groups file \"%s\" defines no group.\n", path);
+        exit(1);
     }
-    // Move tasks from queue_2 -> queue_1
-    while (!is_empty(queue_2)) {
-        Task_t *tmp = dequeue(queue_2);
-        tmp->current_queue = 1;
-        enqueue(queue_1, tmp);
+    free((void*) options.groups);
+    options.groups = specs;
+    options.num_groups = count;
+}
+
+/*
+ * load_config():
+ *   Reads `key = value` settings from the given config file.
+ */
+void load_config(const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "Config file \"%s\" does not exist.\n", path);
+        exit(1);
     }
 
-    // If current_task is running on Q2 or Q3 with more than 2 left, clamp it
-    if (current_task && current_task->current_queue > 1) {
-        current_task->current_queue = 1;
-        if (remaining_quantum > 2) {
-            remaining_quantum = 2;
+    char line[MAX_CONFIG_LINE];
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        char *comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+
+        char *key = trim(line);
+        if (*key == '\0') continue;
+
+        char *eq = strchr(key, '=');
+        if (eq == NULL) {
+            fprintf(stderr, "Malformed config line: %s\n", key);
+            exit(1);
+        }
+        *eq = '\0';
+        char *value = trim(eq + 1);
+        key = trim(key);
+
+        if (strcmp(key, "quanta") == 0) {
+            set_quanta(value);
+        } else if (strcmp(key, "levels") == 0) {
+            set_levels(value);
+        } else if (strcmp(key, "boost_interval") == 0) {
+            set_boost_interval(value);
+        } else if (strcmp(key, "policy") == 0) {
+            set_policy(value);
+        } else if (strcmp(key, "min_granularity") == 0) {
+            options.sched_config.min_granularity = parse_ticks("minimum granularity", value);
+        } else if (strcmp(key, "sched_latency") == 0) {
+            options.sched_config.sched_latency = parse_ticks("scheduling latency", value);
+        } else if (strcmp(key, "sleeper_bonus") == 0) {
+            options.sched_config.sleeper_bonus = parse_ticks("sleeper bonus", value);
+        } else if (strcmp(key, "slice") == 0) {
+            options.sched_config.slice = parse_ticks("slice", value);
+        } else if (strcmp(key, "seed") == 0) {
+            options.sched_config.seed = parse_ticks("seed", value);
+        } else if (strcmp(key, "cbs") == 0) {
+            options.sched_config.cbs = parse_ticks("cbs switch", value) != 0;
+        } else if (strcmp(key, "devices") == 0) {
+            set_devices(value);
+        } else if (strcmp(key, "io_sched") == 0) {
+            set_io_sched(value);
+        } else if (strcmp(key, "seek_rate") == 0) {
+            options.seek_rate = parse_ticks("seek rate", value);
+        } else if (strcmp(key, "switch_cost") == 0) {
+            options.switch_cost = parse_ticks("switch cost", value);
+        } else if (strcmp(key, "cache_penalty") == 0) {
+            options.cache_penalty = parse_ticks("cache penalty", value);
+        } else if (strcmp(key, "cache_decay") == 0) {
+            options.cache_decay = parse_ticks("cache decay", value);
+        } else if (strcmp(key, "groups") == 0) {
+            load_groups(value);
+        } else {
+            fprintf(stderr, "Unknown config key: %s\n", key);
+            exit(1);
         }
     }
 
-    printf("[%05d] BOOST\n", tick);
+    fclose(fp);
 }
 
 /*
- * Function: scheduler
- * -------------------
- *  Schedules the task having the highest priority to be the current 
- *  task. Also, for the currently executing task, decreases the task    
- *	level on completion of the current time quantum.
- *
- *  NOTE:
- *  a. The task to be currently executed is `dequeued` from one of the
- *  	queues.
- *  b. On Pre-emption of a task by another task, the preempted task 
- *  	is `enqueued` to the end of its associated queue.
+ * validate_args():
+ *   Parses the optional flags; exactly one input file name must
+ *   remain.
  */
+void validate_args(int argc, char *argv[]) {
+    static const struct option long_options[] = {
+        { "event-driven",   no_argument,       NULL, 'e' },
+        { "config",         required_argument, NULL, 'c' },
+        { "quanta",         required_argument, NULL, 'q' },
+        { "boost-interval", required_argument, NULL, 'b' },
+        { "cpus",           required_argument, NULL, 'p' },
+        { "global-boost",   no_argument,       NULL, 'g' },
+        { "log",            required_argument, NULL, 'l' },
+        { "summary",        no_argument,       NULL, 's' },
+        { "policy",         required_argument, NULL, 'P' },
+        { "min-granularity", required_argument, NULL, 'G' },
+        { "sched-latency",  required_argument, NULL, 'L' },
+        { "sleeper-bonus",  required_argument, NULL, 'S' },
+        { "slice",          required_argument, NULL, 'Q' },
+        { "seed",           required_argument, NULL, 'R' },
+        { "cbs",            no_argument,       NULL, 'C' },
+        { "metrics",        required_argument, NULL, 'm' },
+        { "metrics-format", required_argument, NULL, 'F' },
+        { "sample-interval", required_argument, NULL, 'I' },
+        { "devices",        required_argument, NULL, 'D' },
+        { "io-sched",       required_argument, NULL, 'O' },
+        { "seek-rate",      required_argument, NULL, 'K' },
+        { "switch-cost",    required_argument, NULL, 'W' },
+        { "cache-penalty",  required_argument, NULL, 'H' },
+        { "cache-decay",    required_argument, NULL, 'Y' },
+        { "groups",         required_argument, NULL, 'T' },
+        { NULL,             0,                 NULL,  0  }
+    };
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "ec:q:b:p:gl:sP:G:L:S:Q:R:Cm:F:I:D:O:K:W:H:Y:T:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'e':
+                options.event_driven = 1;
+                break;
+            case 'c':
+                load_config(optarg);
+                break;
+            case 'q':
+                set_quanta(optarg);
+                break;
+            case 'b':
+                set_boost_interval(optarg);
+                break;
+            case 'p':
+                options.num_cpus = parse_ticks("number of CPUs", optarg);
+                if (options.num_cpus <= 0) {
+                    fprintf(stderr, "Invalid number of CPUs: %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'g':
+                options.global_boost = 1;
+                break;
+            case 'l':
+                options.output_mode = OUTPUT_LOG;
+                log_file = optarg;
+                break;
+            case 's':
+                options.output_mode = OUTPUT_SUMMARY;
+                break;
+            case 'P':
+                set_policy(optarg);
+                break;
+            case 'G':
+                options.sched_config.min_granularity = parse_ticks("minimum granularity", optarg);
+                break;
+            case 'L':
+                options.sched_config.sched_latency = parse_ticks("scheduling latency", optarg);
+                break;
+            case 'S':
+                options.sched_config.sleeper_bonus = parse_ticks("sleeper bonus", optarg);
+                break;
+            case 'Q':
+                options.sched_config.slice = parse_ticks("slice", optarg);
+                break;
+            case 'R':
+                options.sched_config.seed = parse_ticks("seed", optarg);
+                break;
+            case 'C':
+                options.sched_config.cbs = 1;
+                break;
+            case 'm':
+                metrics_file = optarg;
+                break;
+            case 'F':
+                if (strcmp(optarg, "json") == 0) {
+                    metrics_format = METRICS_JSON;
+                } else if (strcmp(optarg, "csv") == 0) {
+                    metrics_format = METRICS_CSV;
+                } else {
+                    fprintf(stderr, "Unknown metrics format: %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'I':
+                options.sample_interval = parse_ticks("sample interval", optarg);
+                break;
+            case 'D':
+                set_devices(optarg);
+                break;
+            case 'O':
+                set_io_sched(optarg);
+                break;
+            case 'K':
+                options.seek_rate = parse_ticks("seek rate", optarg);
+                break;
+            case 'W':
+                options.switch_cost = parse_ticks("switch cost", optarg);
+                break;
+            case 'H':
+                options.cache_penalty = parse_ticks("cache penalty", optarg);
+                break;
+            case 'Y':
+                options.cache_decay = parse_ticks("cache decay", optarg);
+                break;
+            case 'T':
+                load_groups(optarg);
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
 
-void scheduler() {
-    if (current_task != NULL && remaining_quantum > 0) {
-        // still have time quantum left, so keep running
-        return;
+    if (optind != argc - 1) {
+        usage(argv[0]);
     }
+    input_file = argv[optind];
 
-    // We need a new current_task
-    current_task = NULL;
-    remaining_quantum = 0;
-
-    for (int q_id = 1; q_id <= 3; q_id++) {
-        Queue_t *q = get_queue_by_id(q_id);
-        while (!is_empty(q)) {
-            Task_t *front = q->start;
-            // If front is invalid, discard it
-            if (front->id == 0 || front->remaining_burst_time <= 0) {
-                dequeue(q);
-                continue;
-            }
-            // Found a valid candidate
-            current_task = dequeue(q);
-            remaining_quantum = QUEUE_TIME_QUANTUMS[current_task->current_queue - 1];
-            return;
+    if (options.sched_config.num_levels == 0) {
+        options.sched_config.num_levels = sizeof(DEFAULT_QUEUE_TIME_QUANTUMS) / sizeof(int);
+        options.sched_config.quanta = (int*) emalloc(sizeof(DEFAULT_QUEUE_TIME_QUANTUMS));
+        for (int i = 0; i < options.sched_config.num_levels; i++) {
+            options.sched_config.quanta[i] = DEFAULT_QUEUE_TIME_QUANTUMS[i];
         }
     }
-    // If we get here, all queues empty => current_task stays NULL => IDLE
+    if (options.sched_config.min_granularity <= 0) {
+        options.sched_config.min_granularity = 1;
+    }
+    if (options.sched_config.slice <= 0) {
+        options.sched_config.slice = 1;
+    }
 }
 
-
 /*
- * Function: execute_task
- * ----------------------
- *  Executes the current task (By updating the associated remaining
- *  times). Sets the current_task to NULL on completion of the
- *	current burst.
- *
- *  tick: Clock tick (ONLY For Print statements)
+ * loader_source():
+ *   InstructionSource_t over a Loader_t.
  */
-
-void execute_task(int tick) {
-    if (current_task) {
-        // 1) Use one CPU tick
-        current_task->remaining_burst_time--;
-        remaining_quantum--;
-
-        // 2) This tick => execution time
-        current_task->total_execution_time++;
-
-        // 3) Print
-        int used_so_far = current_task->burst_time - current_task->remaining_burst_time;
-        printf("[%05d] id=%04d req=%d used=%d queue=%d\n",
-               tick,
-               current_task->id,
-               current_task->burst_time,
-               used_so_far,
-               current_task->current_queue);
-
-        // 4) Check done or quantum expiry
-        if (current_task->remaining_burst_time <= 0) {
-            // finished
-            current_task = NULL;
-        } else if (remaining_quantum == 0) {
-            // demote + requeue
-            decrease_task_level(current_task);
-            enqueue(get_queue_by_id(current_task->current_queue), current_task);
-            current_task = NULL;
-        }
-    } else {
-        // CPU idle
-        printf("[%05d] IDLE\n", tick);
-    }
+int loader_source(void *loader, Instruction_t *instruction) {
+    return next_instruction((Loader_t*) loader, instruction);
 }
 
 /*
- * Function: update_task_metrics
- * -----------------------------
- * 	Increments the waiting time/execution time for the tasks 
- * 	that are currently scheduled (In the queue). These values would  
- * 	be later used for the computation of the task waiting time and  
- *	turnaround time.
+ * write_metrics():
+ *   Writes the metrics of the finished run to `metrics_file`.
  */
-
-void update_task_metrics() {
-    for (int i = 0; i < MAX_TASKS; i++) {
-        if (task_table[i].id == 0) continue;  // unused entry
-        if (task_table[i].remaining_burst_time > 0) {
-            // If not current running task => waiting
-            if (!current_task || (current_task->id != task_table[i].id)) {
-                task_table[i].total_wait_time++;
-            }
-        }
+void write_metrics(Sim_t *sim) {
+    FILE *fp = strcmp(metrics_file, "-") == 0 ? stdout : fopen(metrics_file, "w");
+    if (!fp) {
+        fprintf(stderr, "Cannot write metrics file \"%s\".\n", metrics_file);
+        exit(1);
+    }
+    write_sim_metrics(sim, fp, metrics_format);
+    if (fp != stdout) {
+        fclose(fp);
     }
 }
 
 /*
  * main():
- *   The simulation loop:
- *     - read instructions for this tick
- *     - possibly boost
- *     - scheduler picks a task if none or quantum used up
- *     - update wait times
- *     - execute current task
- *     - stop if instructions finished, all queues empty, no current task
+ *   Opens the input and runs the simulation tick by tick, or event
+ *   by event with `--event-driven`.
  */
 int main(int argc, char *argv[]) {
     validate_args(argc, argv);
-    initialize_vars();
+    Sim_t *sim = init_sim(&options);
 
-    FILE *fp = fopen(argv[1], "r");
-    if (!fp) {
-        fprintf(stderr, "File \"%s\" does not exist.\n", argv[1]);
+    Loader_t *loader = open_loader(input_file);
+    if (!loader) {
+        fprintf(stderr, "File \"%s\" does not exist.\n", input_file);
         exit(1);
     }
 
-    Instruction_t *curr_instruction = (Instruction_t*) malloc(sizeof(Instruction_t));
-    read_instruction(fp, curr_instruction);
-    if (curr_instruction->is_eof) {
+    if (!set_sim_input(sim, loader_source, loader)) {
         fprintf(stderr, "Error: The input file is empty.\n");
         exit(1);
     }
 
-    int tick = 1;
-    int is_inst_complete = 0;  // false
-
-    while (1) {
-        // Handle all instructions that match this tick
-        while (curr_instruction->event_tick == tick) {
-            handle_instruction(curr_instruction, tick);
-
-            // read next line
-            read_instruction(fp, curr_instruction);
-            if (curr_instruction->is_eof) {
-                is_inst_complete = 1; // true
-                break;
-            }
-        }
-
-        // Possibly boost
-        boost(tick);
-
-        // Let scheduler pick a task if needed
-        scheduler();
-
-        // Update wait times for tasks not running
-        update_task_metrics();
-
-        // Run 1 CPU tick
-        execute_task(tick);
+    static char stdout_buffer[EVENT_LOG_BUFFER];
+    setvbuf(stdout, stdout_buffer, _IOFBF, sizeof(stdout_buffer));
+    if (options.output_mode == OUTPUT_LOG) {
+        sim->event_log = open_event_log(log_file);
+    }
 
-        // Stop if instructions complete, all queues empty, no current task
-        if (is_inst_complete && is_empty(queue_1) && is_empty(queue_2)
-            && is_empty(queue_3) && (current_task == NULL)) {
-            break;
-        }
+    run_sim(sim);
 
-        tick++;
+    if (options.output_mode == OUTPUT_SUMMARY) {
+        print_run_summary(sim);
+    } else if (sim_has_deadlines(sim)) {
+        print_deadline_summary(sim);
+    }
+    if (options.num_cpus > 1) {
+        print_smp_summary(sim);
+    }
+    if (sim->io_requests > 0) {
+        print_io_summary(sim);
+    }
+    if (options.switch_cost > 0 || options.cache_penalty > 0) {
+        print_cost_summary(sim);
+    }
+    if (options.num_groups > 0) {
+        print_group_summary(sim);
+    }
+    if (metrics_file != NULL) {
+        write_metrics(sim);
+    }
+    if (options.output_mode == OUTPUT_LOG) {
+        close_event_log(sim->event_log);
     }
 
-    fclose(fp);
-    deallocate(curr_instruction);
-    deallocate(queue_1);
-    deallocate(queue_2);
-    deallocate(queue_3);
+    close_loader(loader);
+    free_sim(sim);
+    free(options.sched_config.quanta);
+    free((void*) options.groups);
 
     return 0;
 }
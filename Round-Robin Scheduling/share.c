@@ -0,0 +1,85 @@
+/*
+ * share.c
+ *
+ * Achieved vs. target CPU share of the proportional-share policies.
+ */
+
+#include "share.h"
+
+/*
+ * Initialize the clock of an empty run queue.
+ */
+void init_share_clock(ShareClock_t *sc) {
+    sc->clock   = 0;
+    sc->busy    = 0;
+    sc->tickets = 0;
+}
+
+/*
+ * Initialize the share accounting of a NEW task.
+ */
+void init_share_task(Task_t *t) {
+    t->share_joined   = 0;
+    t->share_mark     = 0;
+    t->busy_mark      = 0;
+    t->entitled_ticks = 0;
+    t->runnable_ticks = 0;
+}
+
+/*
+ * The task becomes runnable on this run queue.
+ */
+void share_join(ShareClock_t *sc, Task_t *t) {
+    if (t->share_joined) {
+        return;
+    }
+    t->share_joined = 1;
+    t->share_mark   = sc->clock;
+    t->busy_mark    = sc->busy;
+    sc->tickets    += t->weight;
+}
+
+/*
+ * The task stops being runnable here: settle what it was entitled to.
+ */
+void share_leave(ShareClock_t *sc, Task_t *t) {
+    if (!t->share_joined) {
+        return;
+    }
+    t->share_joined    = 0;
+    t->entitled_ticks += t->weight * (sc->clock - t->share_mark);
+    t->runnable_ticks += sc->busy - t->busy_mark;
+    sc->tickets       -= t->weight;
+}
+
+/*
+ * `ticks` busy ticks went by with the current set of runnable tasks.
+ */
+void share_advance(ShareClock_t *sc, int ticks) {
+    if (sc->tickets > 0) {
+        sc->clock += (double) ticks / sc->tickets;
+    }
+    sc->busy += ticks;
+}
+
+/*
+ * Fractions of the busy ticks during which the task was runnable that
+ * it got and that it was entitled to. Returns 0 if it never was
+ * runnable while the CPU was busy.
+ */
+int share_report(const ShareClock_t *sc, const Task_t *t,
+                 double *achieved, double *target) {
+    double entitled = t->entitled_ticks;
+    long long runnable = t->runnable_ticks;
+
+    if (t->share_joined) {
+        entitled += t->weight * (sc->clock - t->share_mark);
+        runnable += sc->busy - t->busy_mark;
+    }
+    if (runnable <= 0) {
+        return 0;
+    }
+    *achieved = (double) t->total_execution_time / runnable;
+    *target   = entitled / runnable;
+    return 1;
+}
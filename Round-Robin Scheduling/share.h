@@ -0,0 +1,31 @@
+#ifndef _SHARE_H_
+#define _SHARE_H_
+
+#include "queue.h"
+
+/*
+ * Bookkeeping of proportional-share policies, for reporting the CPU
+ * share a task achieved against the share its tickets entitle it to.
+ *
+ * Each run queue keeps a clock that advances by ticks / tickets for
+ * every busy tick, `tickets` being the total of its runnable (queued
+ * or running) tasks. A runnable task is then entitled to its tickets
+ * times the clock's advance, which is settled lazily when it joins or
+ * leaves the run queue, like the wait time of the simulator.
+ */
+typedef struct ShareClock ShareClock_t;
+struct ShareClock {
+    double      clock;
+    long long   busy;               // Busy ticks so far
+    long long   tickets;            // Tickets of the runnable tasks
+};
+
+void init_share_clock(ShareClock_t *);
+void init_share_task(Task_t *);
+
+void share_join(ShareClock_t *, Task_t *);
+void share_leave(ShareClock_t *, Task_t *);
+void share_advance(ShareClock_t *, int);
+int share_report(const ShareClock_t *, const Task_t *, double *, double *);
+
+#endif
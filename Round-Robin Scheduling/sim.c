@@ -0,0 +1,1693 @@
+/*
+ * sim.c
+ *
+ * The simulation proper: instruction handling, the per-CPU schedulers,
+ * boosts, work stealing and the run totals, all kept in a Sim_t. The
+ * input format and the command line are described in schedule.c.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdbool.h>
+#include <limits.h>
+#include "sim.h"
+
+#define MAX_TEXT_LINE 1024
+
+/*
+ * Bursts return to the CPU a task last used unless that CPU holds
+ * more than this many tasks above the least loaded one.
+ */
+#define AFFINITY_IMBALANCE 1
+
+/*
+ * add_sample():
+ *   Appends a value, growing the array as needed.
+ */
+static void add_sample(IntSamples_t *s, int value) {
+    if (s->count == s->capacity) {
+        int capacity = s->capacity ? 2 * s->capacity : 1024;
+        int *grown = (int*) emalloc(capacity * sizeof(int));
+        if (s->count > 0) {
+            memcpy(grown, s->values, s->count * sizeof(int));
+        }
+        free(s->values);
+        s->values = grown;
+        s->capacity = capacity;
+    }
+    s->values[s->count++] = value;
+}
+
+/*
+ * compare_ints():
+ *   qsort() order of ints.
+ */
+static int compare_ints(const void *a, const void *b) {
+    int x = *(const int*) a, y = *(const int*) b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * sample_percentile():
+ *   Nearest-rank percentile `p` of the samples, which it sorts.
+ */
+int sample_percentile(IntSamples_t *s, int p) {
+    if (s->count == 0) {
+        return 0;
+    }
+    qsort(s->values, s->count, sizeof(int), compare_ints);
+    int rank = (int) (((long long) p * s->count + 99) / 100);
+    return s->values[rank > 0 ? rank - 1 : 0];
+}
+
+/*
+ * init_sim():
+ *   Sets up the CPUs with empty queues and an empty task table. With
+ *   task groups, the CPUs' run queues are those of the group class
+ *   over the configured policy.
+ */
+Sim_t *init_sim(const SimOptions_t *options) {
+    Sim_t *sim = (Sim_t*) emalloc(sizeof(Sim_t));
+    memset(sim, 0, sizeof(Sim_t));
+    sim->opt = *options;
+
+    if (sim->opt.num_groups > 0) {
+        sim->groups = init_group_table(sim->opt.groups, sim->opt.num_groups, sim->opt.sched_class);
+        init_group_class(&sim->group_class, sim->opt.sched_class);
+        sim->opt.sched_class = &sim->group_class;
+        sim->opt.sched_config.groups = sim->groups;
+    }
+
+    int num_cpus = sim->opt.num_cpus;
+    sim->cpus = (Cpu_t*) emalloc(num_cpus * sizeof(Cpu_t));
+    for (int i = 0; i < num_cpus; i++) {
+        Cpu_t *cpu = &sim->cpus[i];
+        cpu->id                = i;
+        cpu->rq                = sim->opt.sched_class->init_rq(&sim->opt.sched_config);
+        cpu->current_task      = NULL;
+        cpu->remaining_quantum = 0;
+        cpu->boost_offset      = sim->opt.global_boost ? 0
+                                 : (int) ((long long) i * sim->opt.boost_interval / num_cpus);
+        cpu->busy_ticks        = 0;
+        cpu->steals            = 0;
+        cpu->affine_wakeups    = 0;
+        cpu->last_task_id      = -1;
+        cpu->switch_left       = 0;
+        cpu->lost_ticks        = 0;
+    }
+
+    sim->devices = (Device_t**) emalloc(sim->opt.num_devices * sizeof(Device_t*));
+    for (int i = 0; i < sim->opt.num_devices; i++) {
+        sim->devices[i] = init_device(i, sim->opt.io_sched, sim->opt.seek_rate);
+    }
+
+    init_histogram(&sim->wait_hist);
+    init_histogram(&sim->turnaround_hist);
+    init_histogram(&sim->response_hist);
+    init_histogram(&sim->io_wait_hist);
+
+    QueueSeries_t *series = &sim->queue_series;
+    series->interval  = sim->opt.sample_interval;
+    series->next_tick = sim->opt.sample_interval;
+    series->levels    = sim->opt.sched_class->queue_lengths ? sim->opt.sched_config.num_levels : 1;
+    series->count     = 0;
+    if (series->interval > 0) {
+        series->ticks   = (int*) emalloc(QUEUE_SERIES_CAPACITY * sizeof(int));
+        series->lengths = (int*) emalloc((size_t) QUEUE_SERIES_CAPACITY * series->levels * sizeof(int));
+        series->scratch = (int*) emalloc(series->levels * sizeof(int));
+    }
+
+    sim->task_table = init_task_table();
+    return sim;
+}
+
+/*
+ * free_sim():
+ *   Releases the simulation; the input and the event log stay open.
+ */
+void free_sim(Sim_t *sim) {
+    for (int i = 0; i < sim->opt.num_cpus; i++) {
+        sim->opt.sched_class->free_rq(sim->cpus[i].rq);
+    }
+    deallocate(sim->cpus);
+    if (sim->groups) {
+        free_group_table(sim->groups);
+    }
+    for (int i = 0; i < sim->opt.num_devices; i++) {
+        free_device(sim->devices[i]);
+    }
+    deallocate(sim->devices);
+    free_task_table(sim->task_table);
+    free(sim->lateness.values);
+    free(sim->queue_series.ticks);
+    free(sim->queue_series.lengths);
+    free(sim->queue_series.scratch);
+    deallocate(sim);
+}
+
+/*
+ * Function: read_instruction
+ * --------------------------
+ *  Takes the next instruction from the input and stores the 
+ *  appropriate values in the instruction pointer provided. In case
+ *  `EOF` is encountered, the `is_eof` flag is set. Ticks start at 1
+ *  and never go back: an earlier one would never be handled.
+ *
+ *  instruction: Pointer to store the read instruction details
+ */
+
+static void read_instruction(Sim_t *sim, Instruction_t *instruction) {
+    if (!sim->next_instruction(sim->input, instruction)) {
+        instruction->event_tick = -1;
+        instruction->is_eof     = true;
+        return;
+    }
+
+    if (instruction->event_tick < 1 || instruction->event_tick < sim->input_tick) {
+        fprintf(stderr, "Incorrect file input.\n");
+        exit(1);
+    }
+    sim->input_tick = instruction->event_tick;
+}
+
+/*
+ * emit():
+ *   Sends one output event to stdout or the event log; nothing is
+ *   emitted in summary mode.
+ */
+static void emit(Sim_t *sim, EventType_t type, int tick, int cpu, int task,
+          int arg1, int arg2, int arg3, int queue) {
+    if (sim->opt.output_mode == OUTPUT_SUMMARY) {
+        return;
+    }
+
+    Event_t event;
+    memset(&event, 0, sizeof(event));
+    event.tick  = tick;
+    event.task  = task;
+    event.arg1  = arg1;
+    event.arg2  = arg2;
+    event.arg3  = arg3;
+    event.cpu   = (int16_t) cpu;
+    event.queue = (uint16_t) queue;
+    event.type  = (uint8_t) type;
+
+    if (sim->opt.output_mode == OUTPUT_LOG) {
+        log_event(sim->event_log, &event);
+    } else {
+        print_event(stdout, &event, 0);
+    }
+}
+
+/*
+ * emit_text():
+ *   printf() for report lines, which go to the event log as TEXT
+ *   records when logging.
+ */
+static void emit_text(Sim_t *sim, const char *format, ...) {
+    va_list args;
+
+    if (sim->opt.output_mode != OUTPUT_LOG) {
+        va_start(args, format);
+        vprintf(format, args);
+        va_end(args);
+        return;
+    }
+
+    char line[MAX_TEXT_LINE];
+    va_start(args, format);
+    int n = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (n >= (int) sizeof(line)) {
+        n = sizeof(line) - 1;
+    }
+    log_text(sim->event_log, line, n);
+}
+
+/*
+ * make_ready():
+ *   Queue the task on the run queue of the given CPU (for the MLFQ,
+ *   on its current level). Wait time is not counted tick by tick;
+ *   instead the task remembers the tick from which it is waiting and
+ *   the scheduler adds the difference when the task is dequeued (or
+ *   EXIT does, should it leave while queued). `wakeup` marks a new
+ *   burst as opposed to a preempted or expired task.
+ */
+static void make_ready(Sim_t *sim, Cpu_t *cpu, Task_t *t, int ready_tick, int wakeup) {
+    t->ready_tick = ready_tick;
+    t->cpu = cpu->id;
+    sim->opt.sched_class->enqueue(cpu->rq, t, wakeup);
+}
+
+/*
+ * remove_task_from_all_queues():
+ *   Remove the task from whichever queue holds it. A task is only
+ *   queued while it has burst left and is neither running nor blocked
+ *   on I/O, and always on the CPU recorded in `cpu`.
+ */
+static void remove_task_from_all_queues(Sim_t *sim, Task_t *t) {
+    if (t->cpu < 0) {
+        return;
+    }
+    Cpu_t *cpu = &sim->cpus[t->cpu];
+    if (t == cpu->current_task || t->remaining_burst_time <= 0 || t->io_device >= 0) {
+        return;
+    }
+    sim->opt.sched_class->remove(cpu->rq, t);
+}
+
+/*
+ * cpu_load():
+ *   Number of tasks queued on or running on the CPU.
+ */
+static int cpu_load(Sim_t *sim, Cpu_t *cpu) {
+    return sim->opt.sched_class->nr_queued(cpu->rq) + (cpu->current_task != NULL);
+}
+
+/*
+ * select_cpu():
+ *   Pick the CPU for a new burst: the CPU the task used last, unless
+ *   it is more than AFFINITY_IMBALANCE tasks busier than the least
+ *   loaded CPU (or the task never ran), in which case the least
+ *   loaded CPU. Moving off the last CPU counts as a migration.
+ */
+static Cpu_t *select_cpu(Sim_t *sim, Task_t *t) {
+    Cpu_t *idlest = &sim->cpus[0];
+    for (int i = 1; i < sim->opt.num_cpus; i++) {
+        if (cpu_load(sim, &sim->cpus[i]) < cpu_load(sim, idlest)) {
+            idlest = &sim->cpus[i];
+        }
+    }
+
+    if (t->cpu < 0) {
+        return idlest;
+    }
+
+    Cpu_t *last = &sim->cpus[t->cpu];
+    if (cpu_load(sim, last) <= cpu_load(sim, idlest) + AFFINITY_IMBALANCE) {
+        last->affine_wakeups++;
+        return last;
+    }
+
+    t->migrations++;
+    sim->total_migrations++;
+    sim->opt.sched_class->migrate(last->rq, idlest->rq, t);
+    return idlest;
+}
+
+/*
+ * 	 preempt_if_higher_priority_arrived():
+ *   If the task running on `cpu` is in a lower queue (below queue 1)
+ *   and a new task arrives in a strictly higher queue (new->queue < current_task->queue),
+ *   we must preempt. The assignment states we do *not* preempt if the new arrival
+ *   has the *same* priority, but we *do* if it's strictly higher. Other policies
+ *   decide through their `preempts` hook.
+ *
+ *   Called each time a new task arrives with burst_time>0, right after it is
+ *   queued, so that the new higher-priority task can run immediately at this tick.
+ */
+static void preempt_if_higher_priority_arrived(Sim_t *sim, Cpu_t *cpu, Task_t *new_task, int tick) {
+    // If no current_task, no preemption needed
+    if (cpu->current_task == NULL) return;
+
+    // If new arrival is higher priority (e.g. smaller queue ID) than current
+    if (sim->opt.sched_class->preempts(cpu->rq, cpu->current_task, new_task)) {
+        // Preempt current_task:
+        sim->preemptions++;
+        // 1) Put current_task at back of its queue
+        make_ready(sim, cpu, cpu->current_task, tick, 0);
+        // 2) Clear current_task so scheduler can pick new arrival
+        cpu->current_task = NULL;
+        cpu->remaining_quantum = 0;
+        cpu->switch_left = 0;
+    }
+}
+
+/*
+ * wake_task():
+ *   Queue the task's new CPU burst on the CPU chosen for it, ready
+ *   from `tick` on, and let it preempt the running task if it should.
+ */
+static void wake_task(Sim_t *sim, Task_t *t, int tick) {
+    Cpu_t *cpu = select_cpu(sim, t);
+
+    // Queue the new CPU burst
+    make_ready(sim, cpu, t, tick, 1);
+
+    /*
+     * (NEW) Preempt if the new task is strictly higher priority
+     * than the currently running task. The assignment states
+     * no preemption if same priority, but does imply preemption
+     * for higher priority.
+     */
+    preempt_if_higher_priority_arrived(sim, cpu, t, tick);
+}
+
+/*
+ * submit_io():
+ *   Queue the task's held I/O request at its device from `tick` on.
+ *   The task is blocked until the request completes.
+ */
+static void submit_io(Sim_t *sim, Task_t *t, int tick) {
+    t->io_device      = t->io_held_device;
+    t->io_length      = t->io_held_length;
+    t->io_position    = t->io_held_position;
+    t->io_submit_tick = tick;
+    t->io_held_length = 0;
+
+    device_submit(sim->devices[t->io_device], t);
+    sim->io_requests++;
+    if (sim->opt.output_mode != OUTPUT_SUMMARY) {
+        emit_text(sim, "[%05d] id=%04d IO dev=%d len=%d pos=%d\n",
+                  tick, t->id, t->io_device, t->io_length, t->io_position);
+    }
+}
+
+/*
+ * complete_io():
+ *   The task's request finished service in tick `done_tick`. A held
+ *   request goes to its device next; otherwise a CPU burst held
+ *   during the I/O becomes ready from the following tick.
+ */
+static void complete_io(Sim_t *sim, Device_t *dev, Task_t *t, int done_tick) {
+    dev->current = NULL;
+    dev->served++;
+    t->io_device = -1;
+    if (sim->opt.output_mode != OUTPUT_SUMMARY) {
+        emit_text(sim, "[%05d] id=%04d IODONE dev=%d\n", done_tick, t->id, dev->id);
+    }
+
+    if (t->io_held_length > 0) {
+        submit_io(sim, t, done_tick + 1);
+    } else if (t->remaining_burst_time > 0) {
+        wake_task(sim, t, done_tick + 1);
+    }
+}
+
+/*
+ * dispatch_devices():
+ *   Every idle device starts on its next queued request at `tick`.
+ */
+static void dispatch_devices(Sim_t *sim, int tick) {
+    for (int i = 0; i < sim->opt.num_devices; i++) {
+        Task_t *t = device_start(sim->devices[i]);
+        if (t != NULL) {
+            histogram_record(&sim->io_wait_hist, tick - t->io_submit_tick);
+        }
+    }
+}
+
+/*
+ * set_deadline():
+ *   Takes the optional deadline, CBS period and CBS budget of a burst
+ *   from its instruction.
+ */
+static void set_deadline(Sim_t *sim, Task_t *t, Instruction_t *instruction, int tick) {
+    int n = instruction->num_params;
+
+    t->rel_deadline = n > 0 ? instruction->params[0] : 0;
+    t->period       = n > 1 ? instruction->params[1] : t->rel_deadline;
+    t->max_budget   = n > 2 ? instruction->params[2] : t->burst_time;
+    if (t->rel_deadline < 0 || t->period < 0 || t->max_budget < 0
+        || (t->rel_deadline > 0 && (t->period == 0 || t->max_budget == 0))) {
+        fprintf(stderr, "Invalid deadline for task %d at tick %d.\n", t->id, tick);
+        exit(1);
+    }
+
+    if (t->rel_deadline == 0) {
+        t->deadline = -1;
+    } else {
+        long long due = (long long) tick + t->rel_deadline - 1;
+        t->deadline = due < INT_MAX ? (int) due : INT_MAX;
+    }
+}
+
+/*
+ * record_deadline():
+ *   A burst with a deadline finished in tick `finish_tick`: note its
+ *   lateness (negative if early) and report a miss.
+ */
+static void record_deadline(Sim_t *sim, Task_t *t, int finish_tick) {
+    int late = finish_tick - t->deadline;
+
+    add_sample(&sim->lateness, late);
+    t->deadline = -1;
+
+    if (late > 0) {
+        sim->deadline_misses++;
+        if (sim->opt.output_mode != OUTPUT_SUMMARY) {
+            emit_text(sim, "[%05d] id=%04d MISS late=%d\n", finish_tick, t->id, late);
+        }
+    }
+}
+
+/*
+ * report_share():
+ *   For proportional-share policies, the CPU share an exiting task
+ *   achieved while runnable against its target share.
+ */
+static void report_share(Sim_t *sim, Task_t *t, int tick) {
+    double achieved, target;
+
+    if (sim->opt.sched_class->share == NULL || t->cpu < 0
+        || !sim->opt.sched_class->share(sim->cpus[t->cpu].rq, t, &achieved, &target)) {
+        return;
+    }
+
+    double error = achieved > target ? achieved - target : target - achieved;
+    sim->share_tasks++;
+    sim->sum_share_error += error;
+    if (error > sim->max_share_error) {
+        sim->max_share_error = error;
+    }
+
+    if (sim->opt.output_mode != OUTPUT_SUMMARY) {
+        emit_text(sim, "[%05d] id=%04d SHARE got=%.1f%% want=%.1f%%\n",
+                  tick, t->id, 100.0 * achieved, 100.0 * target);
+    }
+}
+
+/*
+ * Function: handle_instruction
+ * ----------------------------
+ *  Processes the input instruction, depending on the instruction
+ *  type:
+ *      a. New Task (burst_time == 0)
+ *      b. Task Completion (burst_time == -1)
+ *      c. Task Burst (burst_time == <int>)
+ *      d. I/O Request (burst_time == -2)
+ *
+ *  NOTE: 
+ *	a. This method performs NO task scheduling, NO Preemption and NO
+ *  	Updation of Task priorities/levels. These tasks would be   
+ *		handled by the `scheduler`.
+ *	b. A task once demoted to a level, retains that level for all 
+ *		future bursts unless it is further demoted or boosted.
+ *
+ *  instruction: Input instruction
+ *  tick: Clock tick (ONLY For Print statements)
+ */
+ 
+static void handle_instruction(Sim_t *sim, Instruction_t *instruction, int tick) {
+    int task_id = instruction->task_id;
+    Task_t *t;
+
+    if (instruction->burst_time == 0) {
+        // NEW task
+        t = task_table_insert(sim->task_table, task_id);
+        t->id                   = task_id;
+        t->burst_time           = 0;
+        t->remaining_burst_time = 0;
+        t->total_wait_time      = 0;
+        t->total_execution_time = 0;
+        t->cpu                  = -1;
+        t->migrations           = 0;
+        t->arrival_tick         = tick;
+        t->responded            = 1;
+        t->total_switch_time    = 0;
+        t->last_run_tick        = 0;
+        t->last_run_cpu         = -1;
+        t->deadline             = -1;
+        t->rel_deadline         = 0;
+        t->io_device            = -1;
+        t->io_held_length       = 0;
+        t->group                = instruction->num_params > 1 ? instruction->params[1] : 0;
+        t->next                 = NULL;
+        if (sim->groups == NULL) {
+            t->group = 0;
+        } else if (t->group < 0 || t->group >= sim->opt.num_groups) {
+            fprintf(stderr, "Invalid group %d for task %d.\n", t->group, task_id);
+            exit(1);
+        }
+        sim->opt.sched_class->init_task(t, instruction->num_params > 0 ? instruction->params[0] : 0);
+
+        emit(sim, EVENT_NEW, tick, -1, task_id, 0, 0, 0, 0);
+        return;
+    }
+
+    t = task_table_lookup(sim->task_table, task_id);
+    if (t == NULL) {
+        fprintf(stderr, "Instruction for unknown task %d.\n", task_id);
+        exit(1);
+    }
+
+    if (instruction->burst_time == -1) {
+        // EXIT
+        Cpu_t *cpu = t->cpu < 0 ? NULL : &sim->cpus[t->cpu];
+        int is_running = cpu != NULL && cpu->current_task == t;
+
+        if (!is_running && t->remaining_burst_time > 0 && t->io_device < 0) {
+            // Still queued: settle the wait time accrued so far
+            t->total_wait_time += tick - t->ready_tick;
+        }
+        if (t->remaining_burst_time > 0 && t->deadline >= 0) {
+            sim->dropped_deadlines++;
+        }
+        int waiting_time     = t->total_wait_time;
+        int turn_around_time = t->total_wait_time + t->total_execution_time + t->total_switch_time;
+
+        emit(sim, EVENT_EXIT, tick, -1, task_id, waiting_time, turn_around_time,
+             sim->opt.num_cpus > 1 ? t->migrations : -1, 0);
+
+        sim->exited_tasks++;
+        sim->sum_wait_time += waiting_time;
+        sim->sum_turnaround_time += turn_around_time;
+        if (waiting_time > sim->max_wait_time) {
+            sim->max_wait_time = waiting_time;
+        }
+        if (turn_around_time > sim->max_turnaround_time) {
+            sim->max_turnaround_time = turn_around_time;
+        }
+        histogram_record(&sim->wait_hist, waiting_time);
+        histogram_record(&sim->turnaround_hist, turn_around_time);
+
+        report_share(sim, t, tick);
+
+        // Remove from queues, and drop its I/O
+        remove_task_from_all_queues(sim, t);
+        if (t->io_device >= 0) {
+            device_cancel(sim->devices[t->io_device], t);
+        }
+
+        // If this was the current running task, relinquish CPU
+        if (is_running) {
+            if (sim->opt.sched_class->block) {
+                sim->opt.sched_class->block(cpu->rq, t);
+            }
+            cpu->current_task = NULL;
+            cpu->remaining_quantum = 0;
+            cpu->switch_left = 0;
+        }
+
+        // Hand the record back to the task table
+        task_table_remove(sim->task_table, t);
+
+    } else if (instruction->burst_time == -2) {
+        // I/O request: after the pending CPU burst and I/O, if any
+        t->io_held_length   = instruction->num_params > 0 ? instruction->params[0] : 0;
+        t->io_held_device   = instruction->num_params > 1 ? instruction->params[1] : 0;
+        t->io_held_position = instruction->num_params > 2 ? instruction->params[2] : 0;
+        if (t->io_held_length <= 0 || t->io_held_device < 0
+            || t->io_held_device >= sim->opt.num_devices || t->io_held_position < 0) {
+            fprintf(stderr, "Invalid I/O request for task %d at tick %d.\n", task_id, tick);
+            exit(1);
+        }
+
+        if (t->io_device < 0 && t->remaining_burst_time <= 0) {
+            submit_io(sim, t, tick);
+        }
+
+    } else if (instruction->burst_time < -2) {
+        fprintf(stderr, "Invalid burst %d for task %d at tick %d.\n",
+                instruction->burst_time, task_id, tick);
+        exit(1);
+
+    } else {
+        // A CPU burst requirement: new_task needs CPU time
+        int pending = t->remaining_burst_time > 0;
+        t->burst_time           = instruction->burst_time;
+        t->remaining_burst_time = instruction->burst_time;
+        if (pending && t->deadline >= 0) {
+            sim->dropped_deadlines++;
+        }
+        set_deadline(sim, t, instruction, tick);
+
+        if (pending) {
+            // Still queued or running: the new burst replaces the old one in place
+            return;
+        }
+        t->arrival_tick = tick;
+        t->responded    = 0;
+
+        if (t->io_device >= 0) {
+            // Blocked on I/O: held until the request completes
+            return;
+        }
+        wake_task(sim, t, tick);
+    }
+}
+
+/*
+ * Function: output_cpu
+ * --------------------
+ *  CPU id to show on tick lines: only given with several CPUs.
+ */
+
+static int output_cpu(Sim_t *sim, Cpu_t *cpu) {
+    return sim->opt.num_cpus > 1 ? cpu->id : -1;
+}
+
+/*
+ * Function: is_boost_tick
+ * -----------------------
+ *  True if the CPU boosts at the given tick.
+ */
+
+static int is_boost_tick(Sim_t *sim, Cpu_t *cpu, int tick) {
+    return sim->opt.boost_interval > 0 && tick % sim->opt.boost_interval == cpu->boost_offset;
+}
+
+/*
+ * Function: next_boost_tick
+ * -------------------------
+ *  First tick after `tick` at which the CPU boosts (INT_MAX if never).
+ */
+
+static int next_boost_tick(Sim_t *sim, Cpu_t *cpu, int tick) {
+    if (sim->opt.boost_interval <= 0 || sim->opt.sched_class->boost == NULL) {
+        return INT_MAX;
+    }
+    int since = ((tick - cpu->boost_offset) % sim->opt.boost_interval + sim->opt.boost_interval) % sim->opt.boost_interval;
+    if (tick > INT_MAX - (sim->opt.boost_interval - since)) {
+        return INT_MAX;
+    }
+    return tick + sim->opt.boost_interval - since;
+}
+
+/*
+ * Function: boost
+ * -----------------------------
+ *  If the current tick is a boost tick of a CPU, perform a boost
+ *  on all tasks in its lowest queue, followed by the next lowest
+ *  and so on up to Queue 2.  A boost moves the tasks of a queue to
+ *  the end of Queue 1; whole queues are spliced, so the cost does not
+ *  depend on the number of tasks.  At the end of this process, all
+ *  tasks with remaining CPU bursts should be in Queue 1.  The current
+ *  task should be unaffected, except that its remaining quantum should
+ *  be set to a maximum of the Queue 1 quantum (or left unchanged if
+ *  it's less than that).  Boosts do not take CPU time.
+ */
+
+
+static void boost(Sim_t *sim, int tick) {
+    int boosted = 0;
+
+    if (sim->opt.sched_class->boost == NULL) {
+        return;
+    }
+
+    for (int i = 0; i < sim->opt.num_cpus; i++) {
+        Cpu_t *cpu = &sim->cpus[i];
+        if (!is_boost_tick(sim, cpu, tick)) {
+            continue;
+        }
+
+        // If current_task is running below Q1 with more than a Q1 quantum left, clamp it
+        sim->opt.sched_class->boost(cpu->rq, cpu->current_task, &cpu->remaining_quantum);
+
+        if (sim->opt.num_cpus > 1 && !sim->opt.global_boost) {
+            emit(sim, EVENT_BOOST, tick, cpu->id, 0, 0, 0, 0, 0);
+            sim->total_boosts++;
+        }
+        boosted = 1;
+    }
+
+    if (boosted && (sim->opt.num_cpus == 1 || sim->opt.global_boost)) {
+        emit(sim, EVENT_BOOST, tick, -1, 0, 0, 0, 0, 0);
+        sim->total_boosts++;
+    }
+}
+
+/*
+ * Function: switch_overhead
+ * -------------------------
+ *  Ticks lost switching the CPU to the task: the switch cost, plus
+ *  the cache penalty in proportion to how cold the task's cache is.
+ *  The cache cools linearly while the task is off the CPU, from warm
+ *  right after it ran to cold after `cache_decay` ticks; it is cold
+ *  on a CPU it did not run on last.
+ */
+
+static int switch_overhead(Sim_t *sim, Cpu_t *cpu, Task_t *task, int tick) {
+    long long penalty = sim->opt.cache_penalty;
+    int decay = sim->opt.cache_decay;
+
+    if (penalty > 0 && task->last_run_cpu == cpu->id && decay > 0) {
+        long long off = tick - task->last_run_tick - 1;
+        if (off < decay) {
+            penalty = (penalty * off + decay - 1) / decay;
+        }
+    }
+    return sim->opt.switch_cost + (int) penalty;
+}
+
+/*
+ * Function: run_task
+ * ------------------
+ *  Makes the (already dequeued) task the current task of the CPU,
+ *  charging it the ticks it spent waiting. The first run of a burst
+ *  gives its response time; a task other than the one the CPU ran
+ *  last costs a context switch, and the switch overhead is spent
+ *  before the task's quantum starts.
+ */
+
+static void run_task(Sim_t *sim, Cpu_t *cpu, Task_t *task, int tick) {
+    cpu->current_task = task;
+    cpu->remaining_quantum = sim->opt.sched_class->time_slice(cpu->rq, task);
+    task->total_wait_time += tick - task->ready_tick;
+    task->cpu = cpu->id;
+
+    if (!task->responded) {
+        histogram_record(&sim->response_hist, tick - task->arrival_tick);
+        task->responded = 1;
+    }
+    if (task->id != cpu->last_task_id) {
+        sim->context_switches++;
+        cpu->last_task_id = task->id;
+        cpu->switch_left = switch_overhead(sim, cpu, task, tick);
+    }
+}
+
+/*
+ * Function: dequeue_runnable
+ * --------------------------
+ *  Dequeues the next task of the run queue that still needs the CPU,
+ *  discarding invalid entries. Returns NULL if there is none.
+ */
+
+static Task_t *dequeue_runnable(Sim_t *sim, void *rq) {
+    Task_t *front;
+    while ((front = sim->opt.sched_class->pick_next(rq)) != NULL) {
+        // If front is invalid, discard it
+        if (front->remaining_burst_time > 0) {
+            return front;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Function: scheduler
+ * -------------------
+ *  Schedules the task having the highest priority to be the current 
+ *  task of the CPU. Also, for the currently executing task, decreases
+ *	the task level on completion of the current time quantum.
+ *
+ *  NOTE:
+ *  a. The task to be currently executed is `dequeued` from one of the
+ *  	queues.
+ *  b. On Pre-emption of a task by another task, the preempted task 
+ *  	is `enqueued` to the end of its associated queue.
+ *  c. The dequeued task is charged the ticks it spent waiting.
+ *
+ *  tick: Clock tick at which the task is picked
+ */
+
+static void scheduler(Sim_t *sim, Cpu_t *cpu, int tick) {
+    if (cpu->current_task != NULL && cpu->remaining_quantum > 0) {
+        // still have time quantum left, so keep running
+        return;
+    }
+
+    // We need a new current_task
+    cpu->current_task = NULL;
+    cpu->remaining_quantum = 0;
+
+    Task_t *next = dequeue_runnable(sim, cpu->rq);
+    if (next != NULL) {
+        run_task(sim, cpu, next, tick);
+    }
+    // Otherwise all queues empty => current_task stays NULL => IDLE
+}
+
+/*
+ * Function: balance
+ * -----------------
+ *  Work stealing: every CPU left idle by the scheduler takes the next
+ *  task of the CPU with the most queued tasks. Stolen tasks count as
+ *  migrations. Stops as soon as no CPU has anything queued.
+ */
+
+static void balance(Sim_t *sim, int tick) {
+    for (int i = 0; i < sim->opt.num_cpus; i++) {
+        Cpu_t *cpu = &sim->cpus[i];
+        if (cpu->current_task != NULL) {
+            continue;
+        }
+
+        Cpu_t *busiest = NULL;
+        for (int j = 0; j < sim->opt.num_cpus; j++) {
+            int queued = sim->opt.sched_class->nr_queued(sim->cpus[j].rq);
+            if (queued > 0
+                && (busiest == NULL || queued > sim->opt.sched_class->nr_queued(busiest->rq))) {
+                busiest = &sim->cpus[j];
+            }
+        }
+        if (busiest == NULL) {
+            return;
+        }
+
+        Task_t *stolen = dequeue_runnable(sim, busiest->rq);
+        if (stolen == NULL) {
+            continue;
+        }
+        sim->opt.sched_class->migrate(busiest->rq, cpu->rq, stolen);
+        stolen->migrations++;
+        sim->total_migrations++;
+        cpu->steals++;
+        run_task(sim, cpu, stolen, tick);
+    }
+}
+
+/*
+ * Function: schedule_all
+ * ----------------------
+ *  Runs the scheduler on every CPU, then lets idle CPUs steal work.
+ */
+
+static void schedule_all(Sim_t *sim, int tick) {
+    for (int i = 0; i < sim->opt.num_cpus; i++) {
+        scheduler(sim, &sim->cpus[i], tick);
+    }
+    if (sim->opt.num_cpus > 1) {
+        balance(sim, tick);
+    }
+}
+
+/*
+ * Function: thin_queue_series
+ * ---------------------------
+ *  Makes room in a full queue length series: keeps the samples at
+ *  multiples of twice the interval, which becomes the new interval.
+ */
+
+static void thin_queue_series(QueueSeries_t *series) {
+    int levels = series->levels;
+    int kept = 0;
+
+    series->interval *= 2;
+    for (int i = 0; i < series->count; i++) {
+        if (series->ticks[i] % series->interval != 0) {
+            continue;
+        }
+        series->ticks[kept] = series->ticks[i];
+        memmove(&series->lengths[kept * levels], &series->lengths[i * levels], levels * sizeof(int));
+        kept++;
+    }
+    series->count = kept;
+
+    long long next = ((long long) series->next_tick + series->interval - 1) / series->interval * series->interval;
+    series->next_tick = next < INT_MAX ? (int) next : INT_MAX;
+}
+
+/*
+ * Function: sample_queues
+ * -----------------------
+ *  Records the queue lengths for every sample tick in the stretch
+ *  [tick, tick + ticks - 1]. The queues do not change during a
+ *  stretch, so the samples are the same tick by tick or event by
+ *  event.
+ */
+
+static void sample_queues(Sim_t *sim, int tick, int ticks) {
+    QueueSeries_t *series = &sim->queue_series;
+    long long last = (long long) tick + ticks - 1;
+
+    if (series->interval <= 0 || series->next_tick > last) {
+        return;
+    }
+
+    // Sum the lengths over the CPUs once for the whole stretch
+    int levels = series->levels;
+    int total[levels];
+    memset(total, 0, sizeof(total));
+    for (int c = 0; c < sim->opt.num_cpus; c++) {
+        void *rq = sim->cpus[c].rq;
+        if (sim->opt.sched_class->queue_lengths) {
+            sim->opt.sched_class->queue_lengths(rq, series->scratch);
+            for (int l = 0; l < levels; l++) {
+                total[l] += series->scratch[l];
+            }
+        } else {
+            total[0] += sim->opt.sched_class->nr_queued(rq);
+        }
+    }
+
+    while (series->next_tick <= last) {
+        if (series->count == QUEUE_SERIES_CAPACITY) {
+            thin_queue_series(series);
+            continue;
+        }
+        series->ticks[series->count] = series->next_tick;
+        memcpy(&series->lengths[series->count * levels], total, sizeof(total));
+        series->count++;
+        if (series->next_tick > INT_MAX - series->interval) {
+            series->next_tick = INT_MAX;
+            break;
+        }
+        series->next_tick += series->interval;
+    }
+}
+
+/*
+ * Function: account_overlap
+ * -------------------------
+ *  Adds a stretch to the ticks in which CPUs and devices are busy
+ *  together or alone.
+ */
+
+static void account_overlap(Sim_t *sim, int ticks) {
+    int cpu_busy = 0, io_busy = 0;
+    for (int c = 0; c < sim->opt.num_cpus && !cpu_busy; c++) {
+        cpu_busy = sim->cpus[c].current_task != NULL;
+    }
+    for (int d = 0; d < sim->opt.num_devices && !io_busy; d++) {
+        io_busy = sim->devices[d]->current != NULL;
+    }
+
+    if (cpu_busy && io_busy) {
+        sim->overlap_ticks += ticks;
+    } else if (cpu_busy) {
+        sim->cpu_only_ticks += ticks;
+    } else if (io_busy) {
+        sim->io_only_ticks += ticks;
+    }
+}
+
+/*
+ * Function: throttle_running
+ * --------------------------
+ *  Takes the running tasks of throttled groups off their CPUs, back
+ *  to their queues (without expiring), ready from `ready_tick`.
+ */
+
+static void throttle_running(Sim_t *sim, int ready_tick) {
+    for (int c = 0; c < sim->opt.num_cpus; c++) {
+        Cpu_t *cpu = &sim->cpus[c];
+        Task_t *task = cpu->current_task;
+        if (task == NULL || !sim->groups->groups[task->group].throttled) {
+            continue;
+        }
+        make_ready(sim, cpu, task, ready_tick, 0);
+        cpu->current_task = NULL;
+        cpu->remaining_quantum = 0;
+        cpu->switch_left = 0;
+    }
+}
+
+/*
+ * Function: quota_ticks
+ * ---------------------
+ *  Ticks the running tasks can go on from `tick` before one of their
+ *  groups uses up its quota or starts a new period (INT_MAX if none
+ *  has a quota).
+ */
+
+static int quota_ticks(Sim_t *sim, int tick) {
+    int ticks = INT_MAX;
+    for (int c = 0; c < sim->opt.num_cpus; c++) {
+        Task_t *task = sim->cpus[c].current_task;
+        if (task == NULL) {
+            continue;
+        }
+        Group_t *g = &sim->groups->groups[task->group];
+        if (g->spec.quota == 0 || g->throttled) {
+            continue;
+        }
+        int running = 0;
+        for (int d = 0; d < sim->opt.num_cpus; d++) {
+            Task_t *other = sim->cpus[d].current_task;
+            running += other != NULL && other->group == task->group;
+        }
+        int left = group_quota_ticks(sim->groups, task->group, tick, running);
+        if (left < ticks) {
+            ticks = left;
+        }
+    }
+    return ticks;
+}
+
+/*
+ * Function: execute_ticks
+ * -----------------------
+ *  Executes the current task of every CPU for `ticks` consecutive
+ *  ticks (By updating the associated remaining times), or idles the
+ *  CPU for that long. Sets the current_task to NULL on completion of
+ *	the current burst. A CPU still paying the overhead of a switch
+ *	loses the ticks instead. Tasks of a group that used up its quota
+ *	leave the CPU. The devices serve their requests alongside. The
+ *	caller guarantees that the bursts, the time quanta, the switch
+ *	overheads, the group quotas and the I/O requests in service last
+ *	at least `ticks` ticks.
+ *
+ *  tick: First clock tick of the stretch (ONLY For Print statements)
+ *  ticks: Number of ticks to run
+ */
+
+static void execute_ticks(Sim_t *sim, int tick, int ticks) {
+    sample_queues(sim, tick, ticks);
+    account_overlap(sim, ticks);
+
+    // 1) Report the stretch: one record per CPU in the log, one line
+    //    per tick and CPU on stdout
+    if (sim->opt.output_mode != OUTPUT_SUMMARY) {
+        Event_t stretch[sim->opt.num_cpus];
+        memset(stretch, 0, sizeof(stretch));
+        for (int c = 0; c < sim->opt.num_cpus; c++) {
+            Task_t *task = sim->cpus[c].current_task;
+            Event_t *event = &stretch[c];
+
+            event->tick  = tick;
+            event->cpu   = (int16_t) output_cpu(sim, &sim->cpus[c]);
+            event->arg3  = ticks;
+            if (task && sim->cpus[c].switch_left > 0) {
+                event->type  = EVENT_SWITCH;
+                event->task  = task->id;
+            } else if (task) {
+                event->type  = EVENT_RUN;
+                event->task  = task->id;
+                event->arg1  = task->burst_time;
+                event->arg2  = task->burst_time - task->remaining_burst_time + 1;
+                event->queue = (uint16_t) sim->opt.sched_class->level(task);
+            } else {
+                // CPU idle
+                event->type  = EVENT_IDLE;
+                event->task  = 0;
+                event->arg1  = 0;
+                event->arg2  = 0;
+                event->queue = 0;
+            }
+        }
+
+        if (sim->opt.output_mode == OUTPUT_LOG) {
+            for (int c = 0; c < sim->opt.num_cpus; c++) {
+                log_event(sim->event_log, &stretch[c]);
+            }
+        } else {
+            for (int i = 0; i < ticks; i++) {
+                for (int c = 0; c < sim->opt.num_cpus; c++) {
+                    print_event(stdout, &stretch[c], i);
+                }
+            }
+        }
+    }
+
+    int throttled = 0;
+    for (int c = 0; c < sim->opt.num_cpus; c++) {
+        Cpu_t *cpu = &sim->cpus[c];
+        Task_t *task = cpu->current_task;
+        if (task == NULL) {
+            continue;
+        }
+
+        if (cpu->switch_left > 0) {
+            // Switching to the task: lost ticks, its quantum has not started
+            cpu->switch_left -= ticks;
+            cpu->lost_ticks += ticks;
+            task->total_switch_time += ticks;
+            continue;
+        }
+
+        // 2) Use the CPU ticks; they count as execution time
+        task->last_run_tick = tick + ticks - 1;
+        task->last_run_cpu = cpu->id;
+        task->remaining_burst_time -= ticks;
+        cpu->remaining_quantum -= ticks;
+        task->total_execution_time += ticks;
+        cpu->busy_ticks += ticks;
+        sim->opt.sched_class->charge(cpu->rq, task, ticks);
+        if (sim->groups && group_account(sim->groups, task->group, tick, ticks)) {
+            throttled = 1;
+        }
+
+        // 3) Check done or quantum expiry
+        if (task->remaining_burst_time <= 0) {
+            // finished
+            if (task->deadline >= 0) {
+                record_deadline(sim, task, tick + ticks - 1);
+            }
+            if (sim->opt.sched_class->block) {
+                sim->opt.sched_class->block(cpu->rq, task);
+            }
+            cpu->current_task = NULL;
+            if (task->io_held_length > 0) {
+                // It yields to do I/O, keeping its level
+                submit_io(sim, task, tick + ticks);
+            }
+        } else if (cpu->remaining_quantum == 0) {
+            // demote + requeue; it waits from the next tick on
+            int level = sim->opt.sched_class->level(task);
+            sim->opt.sched_class->expire(cpu->rq, task);
+            sim->expiries++;
+            if (sim->opt.sched_class->level(task) > level) {
+                sim->demotions++;
+            }
+            make_ready(sim, cpu, task, tick + ticks, 0);
+            cpu->current_task = NULL;
+        }
+    }
+    if (throttled) {
+        throttle_running(sim, tick + ticks);
+    }
+
+    // 4) Serve I/O; tasks done with their I/O are ready from the next tick
+    for (int d = 0; d < sim->opt.num_devices; d++) {
+        Device_t *dev = sim->devices[d];
+        if (dev->current == NULL) {
+            continue;
+        }
+        dev->remaining -= ticks;
+        dev->busy_ticks += ticks;
+        if (dev->remaining == 0) {
+            complete_io(sim, dev, dev->current, tick + ticks - 1);
+        }
+    }
+
+    sim->last_tick = tick + ticks - 1;
+}
+
+/*
+ * Function: execute_task
+ * ----------------------
+ *  Executes the current tasks for a single tick.
+ *
+ *  tick: Clock tick (ONLY For Print statements)
+ */
+
+static void execute_task(Sim_t *sim, int tick) {
+    execute_ticks(sim, tick, 1);
+}
+
+/*
+ * Function: is_simulation_done
+ * ----------------------------
+ *  True once every instruction has been handled and there is no
+ *  task left to run on any CPU or device.
+ */
+
+static int is_simulation_done(Sim_t *sim, int is_inst_complete) {
+    if (!is_inst_complete) {
+        return 0;
+    }
+    for (int i = 0; i < sim->opt.num_cpus; i++) {
+        if (sim->opt.sched_class->nr_queued(sim->cpus[i].rq) > 0 || sim->cpus[i].current_task != NULL) {
+            return 0;
+        }
+    }
+    for (int i = 0; i < sim->opt.num_devices; i++) {
+        if (sim->devices[i]->current != NULL || sim->devices[i]->queued > 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Function: handle_instructions
+ * -----------------------------
+ *  Handles every instruction due at `tick`, reading ahead to the
+ *  first instruction of a later tick. Returns true once the input
+ *  is exhausted.
+ */
+
+static int handle_instructions(Sim_t *sim, int tick) {
+    Instruction_t *instruction = &sim->instruction;
+
+    while (instruction->event_tick == tick) {
+        handle_instruction(sim, instruction, tick);
+
+        // read next line
+        read_instruction(sim, instruction);
+        if (instruction->is_eof) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Function: run_per_tick
+ * ----------------------
+ *  The simulation loop, one tick per iteration:
+ *     - read instructions for this tick
+ *     - possibly boost
+ *     - scheduler picks a task if none or quantum used up
+ *     - idle devices start on their next I/O request
+ *     - execute current task and I/O
+ *     - stop if instructions finished, all queues empty, no current task
+ */
+
+static void run_per_tick(Sim_t *sim) {
+    int tick = 1;
+    int is_inst_complete = 0;  // false
+
+    while (1) {
+        // Handle all instructions that match this tick
+        if (!is_inst_complete) {
+            is_inst_complete = handle_instructions(sim, tick);
+        }
+
+        // Possibly boost, and start the new quota periods
+        boost(sim, tick);
+        if (sim->groups) {
+            group_refill(sim->groups, tick);
+        }
+
+        // Let scheduler pick a task if needed
+        schedule_all(sim, tick);
+        dispatch_devices(sim, tick);
+
+        // Run 1 CPU tick
+        execute_task(sim, tick);
+
+        // Stop if instructions complete, all queues empty, no current task
+        if (is_simulation_done(sim, is_inst_complete)) {
+            break;
+        }
+
+        tick++;
+    }
+}
+
+/*
+ * Function: run_event_driven
+ * --------------------------
+ *  Same simulation as run_per_tick(), but after each decision point
+ *  the clock jumps to the next tick at which something can change:
+ *  the next instruction, the next boost or quota period, or the end of
+ *  a current burst, time quantum, switch overhead, group quota or I/O
+ *  request. In between, the scheduler would keep every current task
+ *  (and an idle CPU finds nothing to steal, since all queues drained
+ *  at the last decision point, but for tasks of throttled groups), so
+ *  the whole stretch is executed at once.
+ */
+
+static void run_event_driven(Sim_t *sim) {
+    int tick = 1;
+    int is_inst_complete = 0;  // false
+
+    while (1) {
+        if (!is_inst_complete) {
+            is_inst_complete = handle_instructions(sim, tick);
+        }
+        boost(sim, tick);
+        if (sim->groups) {
+            group_refill(sim->groups, tick);
+        }
+        schedule_all(sim, tick);
+        dispatch_devices(sim, tick);
+
+        // Ticks until the next instruction, boost or quota period
+        int next_event = INT_MAX;
+        for (int i = 0; i < sim->opt.num_cpus; i++) {
+            int next_boost = next_boost_tick(sim, &sim->cpus[i], tick);
+            if (next_boost < next_event) {
+                next_event = next_boost;
+            }
+        }
+        if (!is_inst_complete && sim->instruction.event_tick < next_event) {
+            next_event = sim->instruction.event_tick;
+        }
+        if (sim->groups && group_next_refill(sim->groups) < next_event) {
+            next_event = group_next_refill(sim->groups);
+        }
+        int ticks = next_event - tick;
+
+        // ... or until a burst, quantum or I/O request runs out
+        int any_running = 0;
+        for (int d = 0; d < sim->opt.num_devices; d++) {
+            Device_t *dev = sim->devices[d];
+            if (dev->current == NULL) {
+                continue;
+            }
+            any_running = 1;
+            if (dev->remaining < ticks) {
+                ticks = dev->remaining;
+            }
+        }
+        for (int i = 0; i < sim->opt.num_cpus; i++) {
+            Cpu_t *cpu = &sim->cpus[i];
+            if (cpu->current_task == NULL) {
+                continue;
+            }
+            any_running = 1;
+            if (cpu->switch_left > 0 && cpu->switch_left < ticks) {
+                ticks = cpu->switch_left;
+            }
+            if (cpu->remaining_quantum < ticks) {
+                ticks = cpu->remaining_quantum;
+            }
+            if (cpu->current_task->remaining_burst_time < ticks) {
+                ticks = cpu->current_task->remaining_burst_time;
+            }
+        }
+        if (sim->groups && quota_ticks(sim, tick) < ticks) {
+            ticks = quota_ticks(sim, tick);
+        }
+        if (!any_running && is_inst_complete) {
+            // Nothing left to run: the final IDLE tick ends the run
+            ticks = 1;
+        }
+        if (ticks < 1) {
+            ticks = 1;
+        }
+
+        execute_ticks(sim, tick, ticks);
+        tick += ticks - 1;
+
+        if (is_simulation_done(sim, is_inst_complete)) {
+            break;
+        }
+
+        tick++;
+    }
+}
+
+/*
+ * print_smp_summary():
+ *   Per-CPU utilization, steals and affinity, plus migration and
+ *   mean wait/turnaround totals. Only printed with several CPUs.
+ */
+void print_smp_summary(Sim_t *sim) {
+    emit_text(sim, "SMP summary: cpus=%d ticks=%d migrations=%d\n",
+              sim->opt.num_cpus, sim->last_tick, sim->total_migrations);
+    for (int i = 0; i < sim->opt.num_cpus; i++) {
+        Cpu_t *cpu = &sim->cpus[i];
+        emit_text(sim, "cpu=%02d busy=%d util=%.1f%% steals=%d affine=%d\n",
+                  cpu->id, cpu->busy_ticks,
+                  sim->last_tick > 0 ? 100.0 * cpu->busy_ticks / sim->last_tick : 0.0,
+                  cpu->steals, cpu->affine_wakeups);
+    }
+    emit_text(sim, "tasks=%d mean_wt=%.2f mean_tat=%.2f\n", sim->exited_tasks,
+           sim->exited_tasks > 0 ? (double) sim->sum_wait_time / sim->exited_tasks : 0.0,
+           sim->exited_tasks > 0 ? (double) sim->sum_turnaround_time / sim->exited_tasks : 0.0);
+}
+
+/*
+ * print_io_summary():
+ *   Per-device utilization and request counts, how much CPU and I/O
+ *   work overlapped, and the queueing delay of the requests. Printed
+ *   when there was any I/O.
+ */
+void print_io_summary(Sim_t *sim) {
+    long long ticks = sim->last_tick > 0 ? sim->last_tick : 1;
+    const Histogram_t *wait = &sim->io_wait_hist;
+
+    emit_text(sim, "I/O summary: devices=%d sched=%s requests=%d\n", sim->opt.num_devices,
+              sim->opt.io_sched == IO_ELEVATOR ? "elevator" : "fifo", sim->io_requests);
+    for (int i = 0; i < sim->opt.num_devices; i++) {
+        Device_t *dev = sim->devices[i];
+        emit_text(sim, "dev=%02d served=%d busy=%lld util=%.1f%%\n",
+                  dev->id, dev->served, dev->busy_ticks, 100.0 * dev->busy_ticks / ticks);
+    }
+    emit_text(sim, "overlap=%lld (%.1f%%) cpu_only=%lld io_only=%lld\n",
+              sim->overlap_ticks, 100.0 * sim->overlap_ticks / ticks,
+              sim->cpu_only_ticks, sim->io_only_ticks);
+    emit_text(sim, "io_wait mean=%.2f p50=%d p99=%d max=%d\n", histogram_mean(wait),
+              histogram_percentile(wait, 50), histogram_percentile(wait, 99), wait->max);
+}
+
+/*
+ * print_cost_summary():
+ *   Ticks lost to context switches against the useful ticks, overall
+ *   and per CPU. Efficiency is useful ticks over busy (useful + lost)
+ *   ticks. Printed when switches cost anything.
+ */
+void print_cost_summary(Sim_t *sim) {
+    long long useful = 0, lost = 0;
+    for (int i = 0; i < sim->opt.num_cpus; i++) {
+        useful += sim->cpus[i].busy_ticks;
+        lost += sim->cpus[i].lost_ticks;
+    }
+
+    emit_text(sim, "Cost summary: switches=%d useful=%lld lost=%lld efficiency=%.1f%%\n",
+              sim->context_switches, useful, lost,
+              useful + lost > 0 ? 100.0 * useful / (useful + lost) : 100.0);
+    if (sim->opt.num_cpus == 1) {
+        return;
+    }
+    for (int i = 0; i < sim->opt.num_cpus; i++) {
+        Cpu_t *cpu = &sim->cpus[i];
+        long long busy = cpu->busy_ticks + cpu->lost_ticks;
+        emit_text(sim, "cpu=%02d useful=%d lost=%lld efficiency=%.1f%%\n",
+                  cpu->id, cpu->busy_ticks, cpu->lost_ticks,
+                  busy > 0 ? 100.0 * cpu->busy_ticks / busy : 100.0);
+    }
+}
+
+/*
+ * print_group_summary():
+ *   CPU time per task group against its weight's share among the
+ *   groups that ran, with the ticks it spent throttled.
+ */
+void print_group_summary(Sim_t *sim) {
+    GroupTable_t *table = sim->groups;
+    long long used = 0, weights = 0;
+    int throttles = 0;
+
+    group_finish(table, sim->last_tick);
+    for (int i = 0; i < table->num_groups; i++) {
+        Group_t *g = &table->groups[i];
+        used += g->used_ticks;
+        throttles += g->throttles;
+        if (g->used_ticks > 0) {
+            weights += g->spec.weight;
+        }
+    }
+
+    emit_text(sim, "Group summary: groups=%d used=%lld throttles=%d\n",
+              table->num_groups, used, throttles);
+    for (int i = 0; i < table->num_groups; i++) {
+        Group_t *g = &table->groups[i];
+        if (g->used_ticks == 0 && g->throttles == 0) {
+            continue;
+        }
+        emit_text(sim, "group=%d weight=%d quota=%d/%d used=%lld share=%.1f%% target=%.1f%% "
+                       "throttled=%lld throttles=%d\n",
+                  i, g->spec.weight, g->spec.quota, g->spec.period, g->used_ticks,
+                  used > 0 ? 100.0 * g->used_ticks / used : 0.0,
+                  weights > 0 && g->used_ticks > 0 ? 100.0 * g->spec.weight / weights : 0.0,
+                  g->throttled_ticks, g->throttles);
+    }
+}
+
+/*
+ * print_deadline_summary():
+ *   Deadline misses, CPU utilization and the lateness distribution of
+ *   the bursts that had a deadline.
+ */
+void print_deadline_summary(Sim_t *sim) {
+    IntSamples_t *lateness = &sim->lateness;
+    long long busy = 0;
+    for (int i = 0; i < sim->opt.num_cpus; i++) {
+        busy += sim->cpus[i].busy_ticks;
+    }
+    long long capacity = (long long) sim->last_tick * sim->opt.num_cpus;
+
+    emit_text(sim, "Deadline summary: deadlines=%d misses=%d miss_rate=%.2f%% dropped=%d util=%.1f%%\n",
+              lateness->count, sim->deadline_misses,
+              lateness->count > 0 ? 100.0 * sim->deadline_misses / lateness->count : 0.0,
+              sim->dropped_deadlines, capacity > 0 ? 100.0 * busy / capacity : 0.0);
+    if (lateness->count == 0) {
+        return;
+    }
+
+    int p50 = sample_percentile(lateness, 50);
+    emit_text(sim, "lateness min=%d p50=%d p90=%d p99=%d max=%d\n",
+              lateness->values[0], p50, sample_percentile(lateness, 90),
+              sample_percentile(lateness, 99), lateness->values[lateness->count - 1]);
+}
+
+/*
+ * print_distribution():
+ *   One summary line with the percentiles of a histogram.
+ */
+static void print_distribution(const char *name, const Histogram_t *h) {
+    printf("%s count=%lld mean=%.2f p50=%d p90=%d p99=%d p999=%d max=%d\n",
+           name, h->count, histogram_mean(h), histogram_percentile(h, 50),
+           histogram_percentile(h, 90), histogram_percentile(h, 99),
+           histogram_percentile(h, 99.9), h->max);
+}
+
+/*
+ * print_run_summary():
+ *   Aggregate statistics printed by `--summary`.
+ */
+void print_run_summary(Sim_t *sim) {
+    long long busy = 0;
+    for (int i = 0; i < sim->opt.num_cpus; i++) {
+        busy += sim->cpus[i].busy_ticks;
+    }
+    long long capacity = (long long) sim->last_tick * sim->opt.num_cpus;
+
+    printf("ticks=%d busy=%lld idle=%lld util=%.1f%% boosts=%d\n",
+           sim->last_tick, busy, capacity - busy,
+           capacity > 0 ? 100.0 * busy / capacity : 0.0, sim->total_boosts);
+    printf("tasks=%d mean_wt=%.2f max_wt=%d mean_tat=%.2f max_tat=%d\n",
+           sim->exited_tasks,
+           sim->exited_tasks > 0 ? (double) sim->sum_wait_time / sim->exited_tasks : 0.0,
+           sim->max_wait_time,
+           sim->exited_tasks > 0 ? (double) sim->sum_turnaround_time / sim->exited_tasks : 0.0,
+           sim->max_turnaround_time);
+    print_distribution("wait", &sim->wait_hist);
+    print_distribution("turnaround", &sim->turnaround_hist);
+    print_distribution("response", &sim->response_hist);
+    printf("switches=%d preemptions=%d expiries=%d demotions=%d\n",
+           sim->context_switches, sim->preemptions, sim->expiries, sim->demotions);
+    if (sim->share_tasks > 0) {
+        printf("shares=%d mean_err=%.2f%% max_err=%.2f%%\n", sim->share_tasks,
+               100.0 * sim->sum_share_error / sim->share_tasks, 100.0 * sim->max_share_error);
+    }
+    if (sim_has_deadlines(sim)) {
+        print_deadline_summary(sim);
+    }
+}
+
+/*
+ * sim_has_deadlines():
+ *   Whether any burst of the run had a deadline.
+ */
+int sim_has_deadlines(Sim_t *sim) {
+    return sim->lateness.count + sim->dropped_deadlines > 0;
+}
+
+/*
+ * lateness_stats():
+ *   Minimum, maximum and p50/p90/p99 of the lateness, all 0 without
+ *   deadlines.
+ */
+static void lateness_stats(Sim_t *sim, int stats[5]) {
+    IntSamples_t *lateness = &sim->lateness;
+
+    stats[2] = sample_percentile(lateness, 50);
+    stats[3] = sample_percentile(lateness, 90);
+    stats[4] = sample_percentile(lateness, 99);
+    stats[0] = lateness->count > 0 ? lateness->values[0] : 0;
+    stats[1] = lateness->count > 0 ? lateness->values[lateness->count - 1] : 0;
+}
+
+/*
+ * write_distribution_json():
+ *   A histogram as a JSON object member.
+ */
+static void write_distribution_json(FILE *fp, const char *name, const Histogram_t *h) {
+    fprintf(fp, "  \"%s\": {\"count\": %lld, \"mean\": %.2f, \"min\": %d, \"max\": %d, "
+                "\"p50\": %d, \"p90\": %d, \"p99\": %d, \"p999\": %d},\n",
+            name, h->count, histogram_mean(h), h->min, h->max,
+            histogram_percentile(h, 50), histogram_percentile(h, 90),
+            histogram_percentile(h, 99), histogram_percentile(h, 99.9));
+}
+
+/*
+ * write_distribution_csv():
+ *   A histogram as `name_stat,value` rows.
+ */
+static void write_distribution_csv(FILE *fp, const char *name, const Histogram_t *h) {
+    fprintf(fp, "%s_count,%lld\n%s_mean,%.2f\n%s_min,%d\n%s_max,%d\n",
+            name, h->count, name, histogram_mean(h), name, h->min, name, h->max);
+    fprintf(fp, "%s_p50,%d\n%s_p90,%d\n%s_p99,%d\n%s_p999,%d\n",
+            name, histogram_percentile(h, 50), name, histogram_percentile(h, 90),
+            name, histogram_percentile(h, 99), name, histogram_percentile(h, 99.9));
+}
+
+/*
+ * write_sim_metrics():
+ *   Exports the run metrics: the totals and event counts, the wait,
+ *   turnaround and response time distributions, deadline misses and
+ *   lateness, and the queue length series. JSON gives one object; CSV gives `name,value` rows, a
+ *   blank line, then a `tick,q1,q2,...` table.
+ */
+void write_sim_metrics(Sim_t *sim, FILE *fp, MetricsFormat_t format) {
+    QueueSeries_t *series = &sim->queue_series;
+    long long busy = 0, lost = 0;
+    for (int i = 0; i < sim->opt.num_cpus; i++) {
+        busy += sim->cpus[i].busy_ticks;
+        lost += sim->cpus[i].lost_ticks;
+    }
+    double efficiency = busy + lost > 0 ? (double) busy / (busy + lost) : 1.0;
+    int late[5];
+    lateness_stats(sim, late);
+
+    if (format == METRICS_CSV) {
+        fprintf(fp, "name,value\n");
+        fprintf(fp, "policy,%s\ncpus,%d\nticks,%d\nbusy,%lld\nlost,%lld\nefficiency,%.4f\ntasks,%d\n",
+                sim->opt.sched_class->name, sim->opt.num_cpus, sim->last_tick, busy, lost,
+                efficiency, sim->exited_tasks);
+        fprintf(fp, "context_switches,%d\npreemptions,%d\nexpiries,%d\ndemotions,%d\n"
+                    "boosts,%d\nmigrations,%d\n",
+                sim->context_switches, sim->preemptions, sim->expiries, sim->demotions,
+                sim->total_boosts, sim->total_migrations);
+        write_distribution_csv(fp, "wait", &sim->wait_hist);
+        write_distribution_csv(fp, "turnaround", &sim->turnaround_hist);
+        write_distribution_csv(fp, "response", &sim->response_hist);
+        fprintf(fp, "io_requests,%d\ncpu_io_overlap,%lld\n", sim->io_requests, sim->overlap_ticks);
+        write_distribution_csv(fp, "io_wait", &sim->io_wait_hist);
+        fprintf(fp, "deadlines,%d\ndeadline_misses,%d\ndropped_deadlines,%d\n",
+                sim->lateness.count, sim->deadline_misses, sim->dropped_deadlines);
+        fprintf(fp, "lateness_min,%d\nlateness_max,%d\nlateness_p50,%d\nlateness_p90,%d\n"
+                    "lateness_p99,%d\n",
+                late[0], late[1], late[2], late[3], late[4]);
+
+        fprintf(fp, "\ntick");
+        for (int l = 1; l <= series->levels; l++) {
+            fprintf(fp, ",q%d", l);
+        }
+        fprintf(fp, "\n");
+        for (int i = 0; i < series->count; i++) {
+            fprintf(fp, "%d", series->ticks[i]);
+            for (int l = 0; l < series->levels; l++) {
+                fprintf(fp, ",%d", series->lengths[i * series->levels + l]);
+            }
+            fprintf(fp, "\n");
+        }
+        return;
+    }
+
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"policy\": \"%s\",\n  \"cpus\": %d,\n  \"ticks\": %d,\n"
+                "  \"busy\": %lld,\n  \"lost\": %lld,\n  \"efficiency\": %.4f,\n  \"tasks\": %d,\n",
+            sim->opt.sched_class->name, sim->opt.num_cpus, sim->last_tick, busy, lost,
+            efficiency, sim->exited_tasks);
+    fprintf(fp, "  \"context_switches\": %d,\n  \"preemptions\": %d,\n  \"expiries\": %d,\n"
+                "  \"demotions\": %d,\n  \"boosts\": %d,\n  \"migrations\": %d,\n",
+            sim->context_switches, sim->preemptions, sim->expiries, sim->demotions,
+            sim->total_boosts, sim->total_migrations);
+    write_distribution_json(fp, "wait", &sim->wait_hist);
+    write_distribution_json(fp, "turnaround", &sim->turnaround_hist);
+    write_distribution_json(fp, "response", &sim->response_hist);
+    fprintf(fp, "  \"io_requests\": %d,\n  \"cpu_io_overlap\": %lld,\n",
+            sim->io_requests, sim->overlap_ticks);
+    write_distribution_json(fp, "io_wait", &sim->io_wait_hist);
+    fprintf(fp, "  \"deadlines\": %d,\n  \"deadline_misses\": %d,\n  \"dropped_deadlines\": %d,\n",
+            sim->lateness.count, sim->deadline_misses, sim->dropped_deadlines);
+    fprintf(fp, "  \"lateness\": {\"min\": %d, \"max\": %d, \"p50\": %d, \"p90\": %d, \"p99\": %d},\n",
+            late[0], late[1], late[2], late[3], late[4]);
+
+    fprintf(fp, "  \"queue_length\": {\"interval\": %d, \"levels\": %d, \"samples\": [",
+            series->interval, series->levels);
+    for (int i = 0; i < series->count; i++) {
+        fprintf(fp, "%s\n    [%d", i > 0 ? "," : "", series->ticks[i]);
+        for (int l = 0; l < series->levels; l++) {
+            fprintf(fp, ", %d", series->lengths[i * series->levels + l]);
+        }
+        fprintf(fp, "]");
+    }
+    fprintf(fp, "%s]}\n}\n", series->count > 0 ? "\n  " : "");
+}
+
+/*
+ * set_sim_input():
+ *   Attaches the instruction source and reads the first instruction.
+ *   Returns 0 if the input is empty.
+ */
+int set_sim_input(Sim_t *sim, InstructionSource_t next_instruction, void *input) {
+    sim->next_instruction = next_instruction;
+    sim->input = input;
+    read_instruction(sim, &sim->instruction);
+    return !sim->instruction.is_eof;
+}
+
+/*
+ * run_sim():
+ *   Runs the simulation to the end of its input, tick by tick or
+ *   event by event.
+ */
+void run_sim(Sim_t *sim) {
+    if (sim->opt.event_driven) {
+        run_event_driven(sim);
+    } else {
+        run_per_tick(sim);
+    }
+}
@@ -0,0 +1,181 @@
+#ifndef _SIM_H_
+#define _SIM_H_
+
+#include <stdio.h>
+#include "queue.h"
+#include "policy.h"
+#include "event_log.h"
+#include "task_table.h"
+#include "histogram.h"
+#include "device.h"
+#include "group.h"
+
+/*
+ * The scheduling simulator behind `schedule` and `tune`. All state of
+ * a run lives in its Sim_t, so independent simulations can run side by
+ * side, one per thread.
+ */
+
+/* Where the simulation output goes */
+typedef enum {
+    OUTPUT_TEXT,        // Text lines on stdout
+    OUTPUT_LOG,         // Binary event log
+    OUTPUT_SUMMARY      // Aggregate statistics only
+} OutputMode_t;
+
+/* File format of the exported metrics */
+typedef enum {
+    METRICS_JSON,
+    METRICS_CSV
+} MetricsFormat_t;
+
+/*
+ * Settings of a simulation. `sched_config.quanta` and `groups` belong
+ * to the caller and must outlive the simulation.
+ */
+typedef struct SimOptions SimOptions_t;
+struct SimOptions {
+    const SchedClass_t  *sched_class;
+    SchedConfig_t       sched_config;
+    int                 boost_interval;     // 0 => no boosts
+    int                 num_cpus;
+    int                 global_boost;       // Boost all CPUs at the same tick
+    int                 event_driven;       // Jump from decision to decision
+    OutputMode_t        output_mode;
+    int                 sample_interval;    // Ticks between queue length samples, 0 => none
+    int                 num_devices;        // I/O devices
+    IoSched_t           io_sched;
+    int                 seek_rate;          // Positions per tick of device seeks, 0 => free
+    int                 switch_cost;        // Ticks lost on every context switch
+    int                 cache_penalty;      // Further ticks lost switching to a cold task
+    int                 cache_decay;        // Ticks off the CPU until a task is cold
+    const GroupSpec_t   *groups;            // Task groups, `num_groups` of them
+    int                 num_groups;         // 0 => no group scheduling
+};
+
+/*
+ * Growable array of ints, for percentiles.
+ */
+typedef struct IntSamples IntSamples_t;
+struct IntSamples {
+    int         *values;
+    int         count;
+    int         capacity;
+};
+
+/*
+ * One simulated CPU: its run queue, the currently running task + the
+ * time slice left for it, and counters for the SMP summary.
+ */
+typedef struct Cpu Cpu_t;
+struct Cpu {
+    int         id;
+    void        *rq;                // Run queue of sched_class
+    Task_t      *current_task;
+    int         remaining_quantum;
+    int         boost_offset;       // Boosts when tick % boost_interval == offset
+
+    int         busy_ticks;
+    int         steals;             // Tasks pulled from other CPUs
+    int         affine_wakeups;     // Bursts placed back on this CPU
+    int         last_task_id;       // Task the CPU ran last, -1 => none yet
+    int         switch_left;        // Switch overhead left before current_task runs
+    long long   lost_ticks;         // Spent on switch overhead
+};
+
+/*
+ * Queued tasks per level over the run, summed over the CPUs and
+ * sampled every `interval` ticks. The capacity is fixed: once it is
+ * full, every other sample is dropped and the interval doubles.
+ */
+#define QUEUE_SERIES_CAPACITY 1024
+
+typedef struct QueueSeries QueueSeries_t;
+struct QueueSeries {
+    int         interval;
+    int         next_tick;          // Next tick to sample
+    int         levels;
+    int         count;
+    int         *ticks;             // QUEUE_SERIES_CAPACITY entries
+    int         *lengths;           // `levels` entries per sample
+    int         *scratch;           // One CPU's lengths
+};
+
+/*
+ * Reads the next instruction into the given one; returns 0 at the end
+ * of the input.
+ */
+typedef int (*InstructionSource_t)(void *, Instruction_t *);
+
+typedef struct Sim Sim_t;
+struct Sim {
+    SimOptions_t        opt;
+    EventLog_t          *event_log;         // OUTPUT_LOG only
+
+    /* Input */
+    InstructionSource_t next_instruction;
+    void                *input;
+    Instruction_t       instruction;        // Next instruction to handle
+    int                 input_tick;         // Tick of the last instruction read
+
+    /* CPUs (opt.num_cpus of them), devices and the task table (task id -> Task_t) */
+    Cpu_t               *cpus;
+    Device_t            **devices;
+    TaskTable_t         *task_table;
+
+    /* Run totals for the summaries */
+    int                 last_tick;
+    int                 exited_tasks;
+    int                 total_migrations;
+    int                 total_boosts;
+    int                 max_wait_time;
+    int                 max_turnaround_time;
+    long long           sum_wait_time;
+    long long           sum_turnaround_time;
+    int                 share_tasks;        // Tasks with a CPU share report
+    double              sum_share_error;    // Of |achieved - target| share
+    double              max_share_error;
+    int                 deadline_misses;
+    int                 dropped_deadlines;  // Bursts with a deadline cut short by EXIT or a new burst
+    IntSamples_t        lateness;           // Of each finished burst with a deadline
+
+    /* Distributions and event counts for the metrics export */
+    Histogram_t         wait_hist;          // Per exited task
+    Histogram_t         turnaround_hist;
+    Histogram_t         response_hist;      // Per burst: first run - arrival
+    int                 context_switches;   // A CPU started a task other than its last one
+    int                 preemptions;        // A new burst took the CPU from the running task
+    int                 expiries;           // Slices used up
+    int                 demotions;          // Expiries that lowered the task's level
+    QueueSeries_t       queue_series;
+
+    /* I/O */
+    int                 io_requests;        // Requests queued at a device
+    Histogram_t         io_wait_hist;       // Ticks from queueing to service, per request
+    long long           overlap_ticks;      // A CPU and a device both busy
+    long long           cpu_only_ticks;
+    long long           io_only_ticks;
+
+    /* Group scheduling: sched_class wraps the configured policy */
+    SchedClass_t        group_class;
+    GroupTable_t        *groups;            // NULL without groups
+};
+
+Sim_t *init_sim(const SimOptions_t *);
+void free_sim(Sim_t *);
+
+int set_sim_input(Sim_t *, InstructionSource_t, void *);
+void run_sim(Sim_t *);
+
+void print_run_summary(Sim_t *);
+void print_smp_summary(Sim_t *);
+void print_io_summary(Sim_t *);
+void print_cost_summary(Sim_t *);
+void print_group_summary(Sim_t *);
+void print_deadline_summary(Sim_t *);
+int sim_has_deadlines(Sim_t *);
+void write_sim_metrics(Sim_t *, FILE *, MetricsFormat_t);
+
+int sample_percentile(IntSamples_t *, int);
+
+#endif
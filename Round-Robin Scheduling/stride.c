@@ -0,0 +1,181 @@
+/*
+ * stride.c
+ *
+ * Stride scheduling (C. A. Waldspurger and W. E. Weihl, "Stride
+ * Scheduling: Deterministic Proportional-Share Resource Management",
+ * 1995): each task advances its pass by a stride inversely
+ * proportional to its tickets for every tick it runs, and the task
+ * with the smallest pass runs next.
+ */
+
+#include <stdlib.h>
+#include "policy.h"
+#include "heap.h"
+#include "share.h"
+
+#define STRIDE1             (1 << 20)   // Stride of a task holding 1 ticket
+#define DEFAULT_TICKETS     100
+
+typedef struct StrideRq StrideRq_t;
+struct StrideRq {
+    TaskHeap_t              passes;         // Queued tasks by pass
+    long long               min_pass;       // Monotonic floor of the queue's passes
+    ShareClock_t            share;
+    const SchedConfig_t     *config;
+};
+
+static long long stride_of(Task_t *t) {
+    return STRIDE1 / t->weight;
+}
+
+/*
+ * Advance min_pass to the smaller of `pass` and the lowest queued
+ * pass, never moving it backwards.
+ */
+static void update_min_pass(StrideRq_t *rq, long long pass) {
+    Task_t *lowest = heap_top(&rq->passes);
+    if (lowest != NULL && lowest->vruntime < pass) {
+        pass = lowest->vruntime;
+    }
+    if (pass > rq->min_pass) {
+        rq->min_pass = pass;
+    }
+}
+
+static void *stride_init_rq(const SchedConfig_t *config) {
+    StrideRq_t *rq = (StrideRq_t*) emalloc(sizeof(StrideRq_t));
+    init_heap(&rq->passes);
+    init_share_clock(&rq->share);
+    rq->min_pass = 0;
+    rq->config   = config;
+    return rq;
+}
+
+static void stride_free_rq(void *rq) {
+    free_heap(&((StrideRq_t*) rq)->passes);
+    deallocate(rq);
+}
+
+/*
+ * `tickets` <= 0 means the default number of tickets.
+ */
+static void stride_init_task(Task_t *t, int tickets) {
+    t->weight   = tickets > 0 ? (tickets < STRIDE1 ? tickets : STRIDE1) : DEFAULT_TICKETS;
+    t->vruntime = -1;
+    t->rq_index = -1;
+    init_share_task(t);
+}
+
+/*
+ * A new task enters one stride after min_pass, as if it had just run
+ * a tick. A waking task keeps its pass unless it fell behind
+ * min_pass: time spent blocked earns no credit.
+ */
+static void stride_enqueue(void *q, Task_t *t, int wakeup) {
+    StrideRq_t *rq = (StrideRq_t*) q;
+
+    if (t->vruntime < 0) {
+        t->vruntime = rq->min_pass + stride_of(t);
+    } else if (wakeup && t->vruntime < rq->min_pass) {
+        t->vruntime = rq->min_pass;
+    }
+    if (wakeup) {
+        share_join(&rq->share, t);
+    }
+
+    t->sched_key = t->vruntime;
+    heap_push(&rq->passes, t);
+}
+
+static Task_t *stride_pick_next(void *q) {
+    StrideRq_t *rq = (StrideRq_t*) q;
+    Task_t *t = heap_pop(&rq->passes);
+    if (t != NULL) {
+        update_min_pass(rq, t->vruntime);
+    }
+    return t;
+}
+
+static void stride_remove(void *q, Task_t *t) {
+    StrideRq_t *rq = (StrideRq_t*) q;
+    heap_remove(&rq->passes, t);
+    share_leave(&rq->share, t);
+}
+
+static int stride_nr_queued(void *q) {
+    return ((StrideRq_t*) q)->passes.size;
+}
+
+static int stride_time_slice(void *q, Task_t *t) {
+    return ((StrideRq_t*) q)->config->slice;
+}
+
+static void stride_charge(void *q, Task_t *t, int ticks) {
+    StrideRq_t *rq = (StrideRq_t*) q;
+    t->vruntime += stride_of(t) * ticks;
+    update_min_pass(rq, t->vruntime);
+    share_advance(&rq->share, ticks);
+}
+
+static void stride_expire(void *q, Task_t *t) {
+}
+
+/*
+ * Nothing preempts: a woken task competes at the end of the slice.
+ */
+static int stride_preempts(void *q, Task_t *curr, Task_t *woken) {
+    return 0;
+}
+
+static void stride_block(void *q, Task_t *t) {
+    share_leave(&((StrideRq_t*) q)->share, t);
+}
+
+/*
+ * Passes only compare within one queue: carry the task's lead or lag
+ * relative to min_pass over to the new queue.
+ */
+static void stride_migrate(void *from, void *to, Task_t *t) {
+    StrideRq_t *src = (StrideRq_t*) from;
+    StrideRq_t *dst = (StrideRq_t*) to;
+
+    if (t->vruntime >= 0) {
+        t->vruntime += dst->min_pass - src->min_pass;
+        if (t->vruntime < 0) {
+            t->vruntime = 0;
+        }
+    }
+    if (t->share_joined) {
+        share_leave(&src->share, t);
+        share_join(&dst->share, t);
+    }
+}
+
+static int stride_level(Task_t *t) {
+    return 0;
+}
+
+static int stride_share(void *q, Task_t *t, double *achieved, double *target) {
+    return share_report(&((StrideRq_t*) q)->share, t, achieved, target);
+}
+
+const SchedClass_t stride_sched_class = {
+    .name       = "stride",
+    .init_rq    = stride_init_rq,
+    .free_rq    = stride_free_rq,
+    .init_task  = stride_init_task,
+    .enqueue    = stride_enqueue,
+    .pick_next  = stride_pick_next,
+    .remove     = stride_remove,
+    .nr_queued  = stride_nr_queued,
+    .time_slice = stride_time_slice,
+    .charge     = stride_charge,
+    .expire     = stride_expire,
+    .preempts   = stride_preempts,
+    .boost      = NULL,
+    .block      = stride_block,
+    .migrate    = stride_migrate,
+    .level      = stride_level,
+    .share      = stride_share,
+    .queue_lengths = NULL,
+};
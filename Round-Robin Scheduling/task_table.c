@@ -0,0 +1,255 @@
+/*
+ * task_table.c
+ *
+ * Task id -> Task_t map backed by a slab allocator. The map uses
+ * linear probing with backward-shift deletion (no tombstones), as
+ * described in Knuth, "The Art of Computer Programming", Vol. 3,
+ * Section 6.4, Algorithm R.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "task_table.h"
+
+#define INITIAL_CAPACITY 16
+
+/*
+ * Spread the id bits over the table (Fibonacci hashing).
+ */
+static size_t slot_of(TaskTable_t *table, int id) {
+    uint32_t h = (uint32_t) id * 2654435769u;
+    h ^= h >> 16;
+    return (size_t) h & (table->capacity - 1);
+}
+
+/*
+ * Allocate an array of `n` empty hash slots.
+ */
+static Task_t **alloc_slots(size_t n) {
+    Task_t **slots = (Task_t**) emalloc(n * sizeof(Task_t*));
+    for (size_t i = 0; i < n; i++) {
+        slots[i] = NULL;
+    }
+    return slots;
+}
+
+/*
+ * Rehash the map into `capacity` slots.
+ */
+static void resize(TaskTable_t *table, size_t capacity) {
+    Task_t **old = table->slots;
+    size_t old_capacity = table->capacity;
+
+    table->capacity = capacity;
+    table->slots = alloc_slots(table->capacity);
+
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old[i] == NULL) continue;
+        size_t s = slot_of(table, old[i]->id);
+        while (table->slots[s] != NULL) {
+            s = (s + 1) & (table->capacity - 1);
+        }
+        table->slots[s] = old[i];
+    }
+    free(old);
+}
+
+/*
+ * Slab list operations.
+ */
+static void slab_push(TaskSlab_t **list, TaskSlab_t *slab) {
+    slab->prev = NULL;
+    slab->next = *list;
+    if (*list != NULL) {
+        (*list)->prev = slab;
+    }
+    *list = slab;
+}
+
+static void slab_unlink(TaskSlab_t **list, TaskSlab_t *slab) {
+    if (slab->prev != NULL) {
+        slab->prev->next = slab->next;
+    } else {
+        *list = slab->next;
+    }
+    if (slab->next != NULL) {
+        slab->next->prev = slab->prev;
+    }
+}
+
+static void free_slabs(TaskSlab_t *slab) {
+    while (slab != NULL) {
+        TaskSlab_t *next = slab->next;
+        free(slab);
+        slab = next;
+    }
+}
+
+/*
+ * Hand out a Task_t record from a slab with one to spare, falling
+ * back on the spare slab and then on a new one.
+ */
+static Task_t *alloc_task(TaskTable_t *table) {
+    TaskSlab_t *slab = table->partial;
+    if (slab == NULL) {
+        slab = table->spare;
+        table->spare = NULL;
+        if (slab == NULL) {
+            slab = (TaskSlab_t*) emalloc(sizeof(TaskSlab_t));
+            slab->free_list = NULL;
+            slab->used      = 0;
+            slab->live      = 0;
+        }
+        slab_push(&table->partial, slab);
+    }
+
+    Task_t *t;
+    if (slab->free_list != NULL) {
+        t = slab->free_list;
+        slab->free_list = t->next;
+    } else {
+        t = &slab->tasks[slab->used++];
+    }
+    t->slab = slab;
+
+    if (++slab->live == TASK_SLAB_SIZE) {
+        slab_unlink(&table->partial, slab);
+        slab_push(&table->full, slab);
+    }
+    return t;
+}
+
+/*
+ * Return a record to its slab. An empty slab becomes the spare, or is
+ * freed if there already is one.
+ */
+static void free_task(TaskTable_t *table, Task_t *t) {
+    TaskSlab_t *slab = t->slab;
+
+    if (slab->live-- == TASK_SLAB_SIZE) {
+        slab_unlink(&table->full, slab);
+        slab_push(&table->partial, slab);
+    }
+    t->next = slab->free_list;
+    slab->free_list = t;
+
+    if (slab->live == 0) {
+        slab_unlink(&table->partial, slab);
+        if (table->spare == NULL) {
+            slab->free_list = NULL;
+            slab->used      = 0;
+            table->spare    = slab;
+        } else {
+            free(slab);
+        }
+    }
+}
+
+/*
+ * Initialize an empty task table.
+ */
+TaskTable_t *init_task_table() {
+    TaskTable_t *table = (TaskTable_t*) emalloc(sizeof(TaskTable_t));
+    table->capacity = INITIAL_CAPACITY;
+    table->slots    = alloc_slots(table->capacity);
+    table->count    = 0;
+    table->partial  = NULL;
+    table->full     = NULL;
+    table->spare    = NULL;
+
+    return table;
+}
+
+/*
+ * Release the table, its slabs and every task still in it.
+ */
+void free_task_table(TaskTable_t *table) {
+    free_slabs(table->partial);
+    free_slabs(table->full);
+    free(table->spare);
+    free(table->slots);
+    free(table);
+}
+
+/*
+ * Returns the task with the given id, or NULL if there is none.
+ */
+Task_t *task_table_lookup(TaskTable_t *table, int id) {
+    size_t s = slot_of(table, id);
+
+    while (table->slots[s] != NULL) {
+        if (table->slots[s]->id == id) {
+            return table->slots[s];
+        }
+        s = (s + 1) & (table->capacity - 1);
+    }
+    return NULL;
+}
+
+/*
+ * Returns the task with the given id, creating a zeroed record for
+ * it if the id is not in the table yet.
+ */
+Task_t *task_table_insert(TaskTable_t *table, int id) {
+    Task_t *t = task_table_lookup(table, id);
+    if (t != NULL) {
+        return t;
+    }
+
+    if (2 * (table->count + 1) > table->capacity) {
+        resize(table, table->capacity * 2);
+    }
+
+    t = alloc_task(table);
+    t->id                   = id;
+    t->burst_time           = 0;
+    t->remaining_burst_time = 0;
+    t->current_queue        = 0;
+    t->total_wait_time      = 0;
+    t->total_execution_time = 0;
+    t->next                 = NULL;
+    t->prev                 = NULL;
+
+    size_t s = slot_of(table, id);
+    while (table->slots[s] != NULL) {
+        s = (s + 1) & (table->capacity - 1);
+    }
+    table->slots[s] = t;
+    table->count++;
+
+    return t;
+}
+
+/*
+ * Unmap the task and return its record to the pool. The caller must
+ * already have taken the task off every queue.
+ */
+void task_table_remove(TaskTable_t *table, Task_t *task) {
+    size_t mask = table->capacity - 1;
+    size_t s = slot_of(table, task->id);
+
+    while (table->slots[s] != task) {
+        assert(table->slots[s] != NULL);
+        s = (s + 1) & mask;
+    }
+
+    // Backward-shift the rest of the probe run into the hole
+    size_t hole = s;
+    for (size_t i = (hole + 1) & mask; table->slots[i] != NULL; i = (i + 1) & mask) {
+        size_t home = slot_of(table, table->slots[i]->id);
+        // Move the entry unless its home lies cyclically in (hole, i]
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            table->slots[hole] = table->slots[i];
+            hole = i;
+        }
+    }
+    table->slots[hole] = NULL;
+    table->count--;
+
+    free_task(table, task);
+
+    if (table->capacity > INITIAL_CAPACITY && 8 * table->count < table->capacity) {
+        resize(table, table->capacity / 2);
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef _TASK_TABLE_H_
+#define _TASK_TABLE_H_
+
+#include "queue.h"
+
+/*
+ * Number of Task_t records carved out of each slab. A slab is freed
+ * once none of its records is in use (one empty slab is kept back so
+ * a task coming and going at a slab boundary does not thrash).
+ */
+#define TASK_SLAB_SIZE 1024
+
+typedef struct TaskSlab TaskSlab_t;
+struct TaskSlab {
+    TaskSlab_t  *prev;
+    TaskSlab_t  *next;
+    Task_t      *free_list;     // Recycled records, chained through `next`
+    size_t      used;           // Records handed out from `tasks` so far
+    size_t      live;           // Records in use
+    Task_t      tasks[TASK_SLAB_SIZE];
+};
+
+/*
+ * Task table keyed by task id (any int). Records come from a slab pool
+ * and are found through an open-addressing hash map, which doubles
+ * when more than half full and halves when less than an eighth full,
+ * so memory follows the number of live tasks rather than the largest
+ * task id or the peak number of tasks.
+ */
+typedef struct TaskTable TaskTable_t;
+struct TaskTable {
+    Task_t      **slots;        // Hash map (linear probing), NULL => empty
+    size_t      capacity;       // Always a power of two
+    size_t      count;          // Live tasks
+
+    TaskSlab_t  *partial;       // Slabs with a record to spare
+    TaskSlab_t  *full;          // Slabs with every record in use
+    TaskSlab_t  *spare;         // The empty slab kept back, if any
+};
+
+TaskTable_t *init_task_table();
+void free_task_table(TaskTable_t *);
+
+Task_t *task_table_lookup(TaskTable_t *, int);
+Task_t *task_table_insert(TaskTable_t *, int);
+void task_table_remove(TaskTable_t *, Task_t *);
+
+#endif
@@ -0,0 +1,869 @@
+/*
+ * tune.c
+ *
+ * Parameter tuner for the MLFQ: searches the time quanta and the boost
+ * interval for the settings that minimise the wait or turnaround time
+ * over one or more workload traces. Every (setting, trace) pair is an
+ * independent simulation; they run in parallel on a pool of threads.
+ *
+ * Usage:
+ * 	./tune [options] <trace_file>...
+ *
+ * 	--search=grid|random|descent: how to explore the space
+ * 		(default `grid`).
+ * 		grid: every number of levels, first quantum (powers of
+ * 			two in range) and growth factor 1..4 between levels,
+ * 			times every boost interval in range by --boost-step.
+ * 		random: --samples settings with independently drawn,
+ * 			non-decreasing quanta and boost interval.
+ * 		descent: coordinate descent from the default 2,4,8 / 25:
+ * 			tries every value of one coordinate (number of
+ * 			levels, each quantum, boost interval) at a time,
+ * 			keeping the best, until a round brings no gain.
+ * 	--objective=mean_wt|p99_wt|mean_tat|p99_tat|overhead: what to
+ * 		minimise (default `mean_wt`). `overhead` is the share of
+ * 		the busy CPU time lost to context switches, in percent.
+ * 		Metrics are averaged over the traces.
+ * 	--levels=<min>-<max>: number of levels (default `2-4`).
+ * 	--quantum=<min>-<max>: range of each quantum (default `1-32`).
+ * 	--boost=<min>-<max>: range of the boost interval, 0 meaning no
+ * 		boost (default `10-100`).
+ * 	--boost-step=<n>: grid and descent step of the boost interval
+ * 		(default `10`).
+ * 	--samples=<n>: settings tried by the random search (default `200`).
+ * 	--seed=<n>: seed of the random search (default `1`).
+ * 	--threads=<n>: worker threads (default: one per online CPU).
+ * 	--cpus=<n>: simulated CPUs per run (default `1`).
+ * 	--devices=<n>: simulated I/O devices per run, FIFO (default `1`).
+ * 	--switch-cost=<ticks>, --cache-penalty=<ticks>,
+ * 	--cache-decay=<ticks>: context switch cost model of the runs, as
+ * 		for ./schedule (defaults `0`, `0` and `20`). With a cost,
+ * 		short quanta pay for their switches in the wait and
+ * 		turnaround times, so the search stops favouring them.
+ * 	--top=<n>: settings listed (default `10`).
+ *
+ * Output: the best settings by the objective, one per line, then the
+ * 	best setting for each of the five metrics and, for reference, the
+ * 	default setting.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "sim.h"
+#include "loader.h"
+
+#define MAX_TUNE_LEVELS 8
+#define MAX_DESCENT_ROUNDS 20
+
+typedef enum {
+    SEARCH_GRID,
+    SEARCH_RANDOM,
+    SEARCH_DESCENT
+} Search_t;
+
+typedef enum {
+    METRIC_MEAN_WT,
+    METRIC_P99_WT,
+    METRIC_MEAN_TAT,
+    METRIC_P99_TAT,
+    METRIC_OVERHEAD,
+    NUM_METRICS
+} Metric_t;
+
+static const char *METRIC_NAMES[NUM_METRICS] = {
+    "mean_wt", "p99_wt", "mean_tat", "p99_tat", "overhead"
+};
+
+/*
+ * A workload trace, read into memory once and shared by all runs.
+ */
+typedef struct Trace Trace_t;
+struct Trace {
+    const char      *path;
+    Instruction_t   *instructions;
+    int             count;
+};
+
+/*
+ * Read position of one run in a trace (its InstructionSource_t).
+ */
+typedef struct TraceCursor TraceCursor_t;
+struct TraceCursor {
+    const Trace_t   *trace;
+    int             next;
+};
+
+/*
+ * One point of the search space and its metrics, averaged over the
+ * traces.
+ */
+typedef struct Setting Setting_t;
+struct Setting {
+    int         num_levels;
+    int         quanta[MAX_TUNE_LEVELS];
+    int         boost_interval;
+    double      metrics[NUM_METRICS];
+};
+
+/*
+ * One simulation: a setting run on a trace.
+ */
+typedef struct Job Job_t;
+struct Job {
+    const Setting_t *setting;
+    const Trace_t   *trace;
+    double          metrics[NUM_METRICS];
+};
+
+/*
+ * Fixed pool of worker threads taking the jobs of a batch in turn.
+ */
+typedef struct Pool Pool_t;
+struct Pool {
+    pthread_t       *threads;
+    int             num_threads;
+
+    pthread_mutex_t lock;
+    pthread_cond_t  work_ready;         // A batch was posted (or shutdown)
+    pthread_cond_t  work_done;          // The last job of the batch finished
+
+    Job_t           *jobs;
+    int             num_jobs;
+    int             next_job;           // First job not yet taken
+    int             pending;            // Jobs not yet finished
+    int             shutdown;
+};
+
+/* Command line settings */
+Search_t search = SEARCH_GRID;
+Metric_t objective = METRIC_MEAN_WT;
+int min_levels = 2, max_levels = 4;
+int min_quantum = 1, max_quantum = 32;
+int min_boost = 10, max_boost = 100;
+int boost_step = 10;
+int num_samples = 200;
+unsigned long long rng = 1;
+int num_threads = 0;
+int num_cpus = 1;
+int num_devices = 1;
+int switch_cost = 0, cache_penalty = 0, cache_decay = 20;
+int top = 10;
+
+/* The traces */
+Trace_t *traces;
+int num_traces;
+
+/*
+ * usage():
+ *   Print the command line synopsis and quit.
+ */
+void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--search=grid|random|descent] "
+                    "[--objective=mean_wt|p99_wt|mean_tat|p99_tat|overhead] "
+                    "[--levels=<min>-<max>] [--quantum=<min>-<max>] "
+                    "[--boost=<min>-<max>] [--boost-step=<n>] [--samples=<n>] "
+                    "[--seed=<n>] [--threads=<n>] [--cpus=<n>] [--devices=<n>] [--top=<n>] "
+                    "[--switch-cost=<ticks>] [--cache-penalty=<ticks>] [--cache-decay=<ticks>] "
+                    "<trace_file>...\n", prog);
+    exit(1);
+}
+
+/*
+ * parse_count():
+ *   Parses a non-negative integer for the setting `what`.
+ */
+int parse_count(const char *what, const char *value) {
+    char *end;
+    long n = strtol(value, &end, 10);
+    if (end == value || *end != '\0' || n < 0 || n > INT_MAX) {
+        fprintf(stderr, "Invalid %s: %s\n", what, value);
+        exit(1);
+    }
+    return (int) n;
+}
+
+/*
+ * parse_range():
+ *   Parses `<min>-<max>` with 0 <= min <= max.
+ */
+void parse_range(const char *what, const char *value, int *min, int *max) {
+    char *end;
+    long lo = strtol(value, &end, 10);
+    if (end == value || *end != '-') {
+        fprintf(stderr, "Invalid %s range: %s\n", what, value);
+        exit(1);
+    }
+    const char *rest = end + 1;
+    long hi = strtol(rest, &end, 10);
+    if (end == rest || *end != '\0' || lo < 0 || hi < lo || hi > INT_MAX) {
+        fprintf(stderr, "Invalid %s range: %s\n", what, value);
+        exit(1);
+    }
+    *min = (int) lo;
+    *max = (int) hi;
+}
+
+/*
+ * validate_args():
+ *   Parses the optional flags; at least one trace file must remain.
+ *   Returns the index of the first trace file in argv.
+ */
+int validate_args(int argc, char *argv[]) {
+    static const struct option long_options[] = {
+        { "search",     required_argument, NULL, 'm' },
+        { "objective",  required_argument, NULL, 'o' },
+        { "levels",     required_argument, NULL, 'l' },
+        { "quantum",    required_argument, NULL, 'q' },
+        { "boost",      required_argument, NULL, 'b' },
+        { "boost-step", required_argument, NULL, 'B' },
+        { "samples",    required_argument, NULL, 'n' },
+        { "seed",       required_argument, NULL, 'r' },
+        { "threads",    required_argument, NULL, 't' },
+        { "cpus",       required_argument, NULL, 'p' },
+        { "devices",    required_argument, NULL, 'D' },
+        { "top",        required_argument, NULL, 'k' },
+        { "switch-cost", required_argument, NULL, 'W' },
+        { "cache-penalty", required_argument, NULL, 'H' },
+        { "cache-decay", required_argument, NULL, 'Y' },
+        { NULL,         0,                 NULL,  0  }
+    };
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "m:o:l:q:b:B:n:r:t:p:D:k:W:H:Y:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'm':
+                if (strcmp(optarg, "grid") == 0) {
+                    search = SEARCH_GRID;
+                } else if (strcmp(optarg, "random") == 0) {
+                    search = SEARCH_RANDOM;
+                } else if (strcmp(optarg, "descent") == 0) {
+                    search = SEARCH_DESCENT;
+                } else {
+                    fprintf(stderr, "Unknown search: %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'o': {
+                int found = 0;
+                for (int i = 0; i < NUM_METRICS; i++) {
+                    if (strcmp(optarg, METRIC_NAMES[i]) == 0) {
+                        objective = (Metric_t) i;
+                        found = 1;
+                    }
+                }
+                if (!found) {
+                    fprintf(stderr, "Unknown objective: %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            }
+            case 'l':
+                parse_range("levels", optarg, &min_levels, &max_levels);
+                if (min_levels < 1 || max_levels > MAX_TUNE_LEVELS) {
+                    fprintf(stderr, "Levels must be within 1-%d.\n", MAX_TUNE_LEVELS);
+                    exit(1);
+                }
+                break;
+            case 'q':
+                parse_range("quantum", optarg, &min_quantum, &max_quantum);
+                if (min_quantum < 1) {
+                    fprintf(stderr, "Quanta must be at least 1.\n");
+                    exit(1);
+                }
+                break;
+            case 'b':
+                parse_range("boost", optarg, &min_boost, &max_boost);
+                break;
+            case 'B':
+                boost_step = parse_count("boost step", optarg);
+                break;
+            case 'n':
+                num_samples = parse_count("number of samples", optarg);
+                break;
+            case 'r':
+                rng = (unsigned long long) parse_count("seed", optarg);
+                break;
+            case 't':
+                num_threads = parse_count("number of threads", optarg);
+                break;
+            case 'p':
+                num_cpus = parse_count("number of CPUs", optarg);
+                break;
+            case 'D':
+                num_devices = parse_count("number of devices", optarg);
+                break;
+            case 'k':
+                top = parse_count("top", optarg);
+                break;
+            case 'W':
+                switch_cost = parse_count("switch cost", optarg);
+                break;
+            case 'H':
+                cache_penalty = parse_count("cache penalty", optarg);
+                break;
+            case 'Y':
+                cache_decay = parse_count("cache decay", optarg);
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    if (optind >= argc || boost_step < 1 || num_cpus < 1 || num_devices < 1) {
+        usage(argv[0]);
+    }
+    if (num_threads <= 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = online > 0 ? (int) online : 1;
+    }
+    if (rng == 0) {
+        rng = 1;
+    }
+    return optind;
+}
+
+/*
+ * load_trace():
+ *   Reads a whole trace file into memory.
+ */
+void load_trace(Trace_t *trace, const char *path) {
+    Loader_t *loader = open_loader(path);
+    if (!loader) {
+        fprintf(stderr, "File \"%s\" does not exist.\n", path);
+        exit(1);
+    }
+
+    int capacity = 1024;
+    trace->path = path;
+    trace->count = 0;
+    trace->instructions = (Instruction_t*) emalloc(capacity * sizeof(Instruction_t));
+
+    Instruction_t instruction;
+    while (next_instruction(loader, &instruction)) {
+        if (trace->count == capacity) {
+            capacity *= 2;
+            Instruction_t *grown = (Instruction_t*) emalloc(capacity * sizeof(Instruction_t));
+            memcpy(grown, trace->instructions, trace->count * sizeof(Instruction_t));
+            free(trace->instructions);
+            trace->instructions = grown;
+        }
+        trace->instructions[trace->count++] = instruction;
+    }
+    close_loader(loader);
+
+    if (trace->count == 0) {
+        fprintf(stderr, "Error: The input file %s is empty.\n", path);
+        exit(1);
+    }
+}
+
+/*
+ * trace_source():
+ *   InstructionSource_t over a TraceCursor_t.
+ */
+int trace_source(void *input, Instruction_t *instruction) {
+    TraceCursor_t *cursor = (TraceCursor_t*) input;
+    if (cursor->next >= cursor->trace->count) {
+        return 0;
+    }
+    *instruction = cursor->trace->instructions[cursor->next++];
+    return 1;
+}
+
+/*
+ * run_job():
+ *   Simulates the job's setting on its trace, event-driven and
+ *   without output, and takes its metrics.
+ */
+void run_job(Job_t *job) {
+    const Setting_t *setting = job->setting;
+    int quanta[MAX_TUNE_LEVELS];
+    memcpy(quanta, setting->quanta, sizeof(quanta));
+
+    SimOptions_t options = {
+        .sched_class    = &mlfq_sched_class,
+        .sched_config   = {
+            .num_levels = setting->num_levels,
+            .quanta     = quanta,
+        },
+        .boost_interval = setting->boost_interval,
+        .num_cpus       = num_cpus,
+        .global_boost   = 0,
+        .event_driven   = 1,
+        .output_mode    = OUTPUT_SUMMARY,
+        .sample_interval = 0,
+        .num_devices    = num_devices,
+        .io_sched       = IO_FIFO,
+        .switch_cost    = switch_cost,
+        .cache_penalty  = cache_penalty,
+        .cache_decay    = cache_decay,
+    };
+
+    Sim_t *sim = init_sim(&options);
+    TraceCursor_t cursor = { job->trace, 0 };
+    set_sim_input(sim, trace_source, &cursor);
+    run_sim(sim);
+
+    int exited = sim->exited_tasks;
+    job->metrics[METRIC_MEAN_WT]  = exited > 0 ? (double) sim->sum_wait_time / exited : 0.0;
+    job->metrics[METRIC_MEAN_TAT] = exited > 0 ? (double) sim->sum_turnaround_time / exited : 0.0;
+    job->metrics[METRIC_P99_WT]   = histogram_percentile(&sim->wait_hist, 99);
+    job->metrics[METRIC_P99_TAT]  = histogram_percentile(&sim->turnaround_hist, 99);
+
+    long long useful = 0, lost = 0;
+    for (int i = 0; i < num_cpus; i++) {
+        useful += sim->cpus[i].busy_ticks;
+        lost += sim->cpus[i].lost_ticks;
+    }
+    job->metrics[METRIC_OVERHEAD] = useful + lost > 0 ? 100.0 * lost / (useful + lost) : 0.0;
+
+    free_sim(sim);
+}
+
+/*
+ * worker():
+ *   Thread body: runs jobs of the current batch until shutdown.
+ */
+void *worker(void *arg) {
+    Pool_t *pool = (Pool_t*) arg;
+
+    pthread_mutex_lock(&pool->lock);
+    while (1) {
+        while (!pool->shutdown && pool->next_job >= pool->num_jobs) {
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        }
+        if (pool->shutdown) {
+            break;
+        }
+        Job_t *job = &pool->jobs[pool->next_job++];
+        pthread_mutex_unlock(&pool->lock);
+
+        run_job(job);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0) {
+            pthread_cond_signal(&pool->work_done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+/*
+ * init_pool():
+ *   Starts the worker threads, idle until a batch is posted.
+ */
+void init_pool(Pool_t *pool, int threads) {
+    pool->num_threads = threads;
+    pool->threads     = (pthread_t*) emalloc(threads * sizeof(pthread_t));
+    pool->jobs        = NULL;
+    pool->num_jobs    = 0;
+    pool->next_job    = 0;
+    pool->pending     = 0;
+    pool->shutdown    = 0;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->work_done, NULL);
+
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&pool->threads[i], NULL, worker, pool) != 0) {
+            fprintf(stderr, "Cannot start worker thread.\n");
+            exit(1);
+        }
+    }
+}
+
+/*
+ * free_pool():
+ *   Stops and joins the workers.
+ */
+void free_pool(Pool_t *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->num_threads; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_cond_destroy(&pool->work_done);
+    deallocate(pool->threads);
+}
+
+/*
+ * run_batch():
+ *   Runs the jobs on the pool and waits for all of them.
+ */
+void run_batch(Pool_t *pool, Job_t *jobs, int count) {
+    if (count == 0) {
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    pool->jobs     = jobs;
+    pool->num_jobs = count;
+    pool->next_job = 0;
+    pool->pending  = count;
+    pthread_cond_broadcast(&pool->work_ready);
+    while (pool->pending > 0) {
+        pthread_cond_wait(&pool->work_done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/*
+ * evaluate():
+ *   Runs every setting on every trace and stores the metrics averaged
+ *   over the traces in the settings.
+ */
+void evaluate(Pool_t *pool, Setting_t *settings, int count) {
+    int num_jobs = count * num_traces;
+    Job_t *jobs = (Job_t*) emalloc((num_jobs > 0 ? num_jobs : 1) * sizeof(Job_t));
+
+    for (int s = 0; s < count; s++) {
+        for (int t = 0; t < num_traces; t++) {
+            jobs[s * num_traces + t].setting = &settings[s];
+            jobs[s * num_traces + t].trace   = &traces[t];
+        }
+    }
+    run_batch(pool, jobs, num_jobs);
+
+    for (int s = 0; s < count; s++) {
+        for (int m = 0; m < NUM_METRICS; m++) {
+            double sum = 0;
+            for (int t = 0; t < num_traces; t++) {
+                sum += jobs[s * num_traces + t].metrics[m];
+            }
+            settings[s].metrics[m] = sum / num_traces;
+        }
+    }
+    free(jobs);
+}
+
+/*
+ * next_random():
+ *   xorshift64* (S. Vigna, 2016) for the random search.
+ */
+unsigned long long next_random() {
+    rng ^= rng >> 12;
+    rng ^= rng << 25;
+    rng ^= rng >> 27;
+    return rng * 0x2545F4914F6CDD1DULL;
+}
+
+/*
+ * random_between():
+ *   Uniform integer in [lo, hi].
+ */
+int random_between(int lo, int hi) {
+    return lo + (int) (next_random() % ((unsigned long long) hi - lo + 1));
+}
+
+/*
+ * Settings of the search space, grown as they are generated.
+ */
+typedef struct SettingList SettingList_t;
+struct SettingList {
+    Setting_t   *items;
+    int         count;
+    int         capacity;
+};
+
+void add_setting(SettingList_t *list, const Setting_t *setting) {
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? 2 * list->capacity : 256;
+        Setting_t *grown = (Setting_t*) emalloc(capacity * sizeof(Setting_t));
+        if (list->count > 0) {
+            memcpy(grown, list->items, list->count * sizeof(Setting_t));
+        }
+        free(list->items);
+        list->items = grown;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = *setting;
+}
+
+/*
+ * grid_settings():
+ *   Geometric quanta q1 * g^i (q1 a power of two, g = 1..4) for every
+ *   number of levels, crossed with every boost interval by boost_step.
+ */
+void grid_settings(SettingList_t *list) {
+    for (int levels = min_levels; levels <= max_levels; levels++) {
+        for (int first = 1; first <= max_quantum; first *= 2) {
+            if (first < min_quantum) {
+                continue;
+            }
+            for (int growth = 1; growth <= 4; growth++) {
+                if (levels == 1 && growth > 1) {
+                    break;
+                }
+
+                Setting_t setting = { .num_levels = levels };
+                long long q = first;
+                int fits = 1;
+                for (int i = 0; i < levels; i++) {
+                    if (q > max_quantum) {
+                        fits = 0;
+                        break;
+                    }
+                    setting.quanta[i] = (int) q;
+                    q *= growth;
+                }
+                if (!fits) {
+                    continue;
+                }
+
+                for (int b = min_boost; b <= max_boost; b += boost_step) {
+                    setting.boost_interval = b;
+                    add_setting(list, &setting);
+                    if (b > INT_MAX - boost_step) {
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/*
+ * random_settings():
+ *   num_samples settings with sorted random quanta.
+ */
+void random_settings(SettingList_t *list) {
+    for (int n = 0; n < num_samples; n++) {
+        Setting_t setting = { .num_levels = random_between(min_levels, max_levels) };
+        for (int i = 0; i < setting.num_levels; i++) {
+            setting.quanta[i] = random_between(min_quantum, max_quantum);
+        }
+        // Lower levels get the longer quanta
+        for (int i = 1; i < setting.num_levels; i++) {
+            for (int j = i; j > 0 && setting.quanta[j] < setting.quanta[j - 1]; j--) {
+                int tmp = setting.quanta[j];
+                setting.quanta[j] = setting.quanta[j - 1];
+                setting.quanta[j - 1] = tmp;
+            }
+        }
+        setting.boost_interval = random_between(min_boost, max_boost);
+        add_setting(list, &setting);
+    }
+}
+
+int clamp(int value, int lo, int hi) {
+    return value < lo ? lo : value > hi ? hi : value;
+}
+
+/*
+ * default_setting():
+ *   The simulator's defaults (2,4,8 and 25), clamped into the space.
+ */
+Setting_t default_setting() {
+    static const int DEFAULT_QUANTA[] = { 2, 4, 8 };
+    Setting_t setting = { .num_levels = clamp(3, min_levels, max_levels) };
+
+    for (int i = 0; i < setting.num_levels; i++) {
+        int q = i < 3 ? DEFAULT_QUANTA[i] : DEFAULT_QUANTA[2] << (i - 2);
+        setting.quanta[i] = clamp(q, min_quantum, max_quantum);
+    }
+    setting.boost_interval = clamp(25, min_boost, max_boost);
+    return setting;
+}
+
+/*
+ * descent_candidates():
+ *   The settings differing from `best` in coordinate `coord` only:
+ *   0 is the number of levels (new levels double the last quantum),
+ *   1..levels the quanta (powers of two and the neighbours of the
+ *   current value), levels + 1 the boost interval.
+ */
+void descent_candidates(const Setting_t *best, int coord, SettingList_t *list) {
+    list->count = 0;
+
+    if (coord == 0) {
+        for (int levels = min_levels; levels <= max_levels; levels++) {
+            if (levels == best->num_levels) {
+                continue;
+            }
+            Setting_t setting = *best;
+            setting.num_levels = levels;
+            for (int i = best->num_levels; i < levels; i++) {
+                setting.quanta[i] = clamp(2 * setting.quanta[i - 1], min_quantum, max_quantum);
+            }
+            add_setting(list, &setting);
+        }
+    } else if (coord <= best->num_levels) {
+        int i = coord - 1;
+        int current = best->quanta[i];
+        for (long long q = 1; q <= max_quantum; q *= 2) {
+            if (q >= min_quantum && q != current) {
+                Setting_t setting = *best;
+                setting.quanta[i] = (int) q;
+                add_setting(list, &setting);
+            }
+        }
+        for (int delta = -1; delta <= 1; delta += 2) {
+            int q = current + delta;
+            if (q >= min_quantum && q <= max_quantum && (q & (q - 1)) != 0) {
+                Setting_t setting = *best;
+                setting.quanta[i] = q;
+                add_setting(list, &setting);
+            }
+        }
+    } else {
+        for (int b = min_boost; b <= max_boost; b += boost_step) {
+            if (b != best->boost_interval) {
+                Setting_t setting = *best;
+                setting.boost_interval = b;
+                add_setting(list, &setting);
+            }
+            if (b > INT_MAX - boost_step) {
+                break;
+            }
+        }
+    }
+}
+
+/*
+ * descent():
+ *   Coordinate descent on the objective; every setting evaluated along
+ *   the way ends up in `tried`.
+ */
+void descent(Pool_t *pool, SettingList_t *tried) {
+    Setting_t best = default_setting();
+    SettingList_t candidates = { NULL, 0, 0 };
+
+    evaluate(pool, &best, 1);
+    add_setting(tried, &best);
+
+    for (int round = 0; round < MAX_DESCENT_ROUNDS; round++) {
+        int improved = 0;
+        for (int coord = 0; coord <= best.num_levels + 1; coord++) {
+            descent_candidates(&best, coord, &candidates);
+            evaluate(pool, candidates.items, candidates.count);
+            for (int c = 0; c < candidates.count; c++) {
+                add_setting(tried, &candidates.items[c]);
+                if (candidates.items[c].metrics[objective] < best.metrics[objective]) {
+                    best = candidates.items[c];
+                    improved = 1;
+                }
+            }
+        }
+        if (!improved) {
+            break;
+        }
+    }
+    free(candidates.items);
+}
+
+/*
+ * compare_settings():
+ *   qsort() order by the objective, then the other metrics.
+ */
+int compare_settings(const void *a, const void *b) {
+    const Setting_t *x = (const Setting_t*) a;
+    const Setting_t *y = (const Setting_t*) b;
+
+    if (x->metrics[objective] != y->metrics[objective]) {
+        return x->metrics[objective] < y->metrics[objective] ? -1 : 1;
+    }
+    for (int m = 0; m < NUM_METRICS; m++) {
+        if (x->metrics[m] != y->metrics[m]) {
+            return x->metrics[m] < y->metrics[m] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * print_setting():
+ *   One result line.
+ */
+void print_setting(const char *label, const Setting_t *setting) {
+    printf("%s quanta=", label);
+    for (int i = 0; i < setting->num_levels; i++) {
+        printf(i > 0 ? ",%d" : "%d", setting->quanta[i]);
+    }
+    printf(" boost=%d mean_wt=%.2f p99_wt=%.1f mean_tat=%.2f p99_tat=%.1f overhead=%.2f%%\n",
+           setting->boost_interval,
+           setting->metrics[METRIC_MEAN_WT], setting->metrics[METRIC_P99_WT],
+           setting->metrics[METRIC_MEAN_TAT], setting->metrics[METRIC_P99_TAT],
+           setting->metrics[METRIC_OVERHEAD]);
+}
+
+/*
+ * main():
+ *   Loads the traces, runs the search and reports the best settings.
+ */
+int main(int argc, char *argv[]) {
+    int first_trace = validate_args(argc, argv);
+
+    num_traces = argc - first_trace;
+    traces = (Trace_t*) emalloc(num_traces * sizeof(Trace_t));
+    for (int t = 0; t < num_traces; t++) {
+        load_trace(&traces[t], argv[first_trace + t]);
+    }
+
+    Pool_t pool;
+    init_pool(&pool, num_threads);
+
+    SettingList_t tried = { NULL, 0, 0 };
+    if (search == SEARCH_GRID) {
+        grid_settings(&tried);
+        evaluate(&pool, tried.items, tried.count);
+    } else if (search == SEARCH_RANDOM) {
+        random_settings(&tried);
+        evaluate(&pool, tried.items, tried.count);
+    } else {
+        descent(&pool, &tried);
+    }
+
+    Setting_t reference = default_setting();
+    evaluate(&pool, &reference, 1);
+    free_pool(&pool);
+
+    if (tried.count == 0) {
+        fprintf(stderr, "Error: The search space is empty.\n");
+        exit(1);
+    }
+
+    printf("settings=%d traces=%d runs=%d threads=%d objective=%s\n",
+           tried.count, num_traces, tried.count * num_traces, num_threads,
+           METRIC_NAMES[objective]);
+
+    // Best per metric, before sorting by the objective
+    Setting_t best[NUM_METRICS];
+    for (int m = 0; m < NUM_METRICS; m++) {
+        best[m] = tried.items[0];
+        for (int s = 1; s < tried.count; s++) {
+            if (tried.items[s].metrics[m] < best[m].metrics[m]) {
+                best[m] = tried.items[s];
+            }
+        }
+    }
+
+    qsort(tried.items, tried.count, sizeof(Setting_t), compare_settings);
+    for (int s = 0; s < tried.count && s < top; s++) {
+        char label[32];
+        snprintf(label, sizeof(label), "rank=%d", s + 1);
+        print_setting(label, &tried.items[s]);
+    }
+    for (int m = 0; m < NUM_METRICS; m++) {
+        char label[32];
+        snprintf(label, sizeof(label), "best_%s", METRIC_NAMES[m]);
+        print_setting(label, &best[m]);
+    }
+    print_setting("default", &reference);
+
+    free(tried.items);
+    for (int t = 0; t < num_traces; t++) {
+        free(traces[t].instructions);
+    }
+    deallocate(traces);
+    return 0;
+}